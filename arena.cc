@@ -0,0 +1,70 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace {
+
+// The size of the first block an arena obtains. Each block after is
+// twice the size of the last, up to kMaxBlockSize, so that arenas of
+// small binaries stay small and those of large ones make few calls
+// to the heap.
+const size_t kMinBlockSize = 4096;
+const size_t kMaxBlockSize = 1 << 20;
+
+// Returns address rounded up to a multiple of alignment.
+inline static uintptr_t AlignUp(const uintptr_t address, const size_t alignment)
+{
+  return (address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+}
+
+} // namespace
+
+Arena::Arena()
+  : mutex_(),
+    blocks_(),
+    next_(nullptr),
+    end_(nullptr),
+    block_size_(kMinBlockSize),
+    usage_(0) { }
+
+Arena::~Arena()
+{
+  for (void *const block : blocks_) {
+    ::operator delete(block);
+  }
+}
+
+void *Arena::Allocate(const size_t size, const size_t alignment)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  uintptr_t start = AlignUp(reinterpret_cast<uintptr_t>(next_), alignment);
+  if (!next_ || start + size > reinterpret_cast<uintptr_t>(end_)) {
+    // Allocations too large for a regular block get a block of their
+    // own, leaving the current block to serve later small requests.
+    if (size > block_size_ / 4) {
+      void *const block = ::operator new(size);
+      blocks_.push_back(block);
+      usage_ += size;
+      return block;
+    }
+    void *const block = ::operator new(block_size_);
+    blocks_.push_back(block);
+    usage_ += block_size_;
+    next_ = static_cast<char*>(block);
+    end_ = next_ + block_size_;
+    block_size_ = std::min(2*block_size_, kMaxBlockSize);
+    start = AlignUp(reinterpret_cast<uintptr_t>(next_), alignment);
+  }
+  next_ = reinterpret_cast<char*>(start + size);
+  return reinterpret_cast<void*>(start);
+}
+
+size_t Arena::MemoryUsage() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return usage_;
+}
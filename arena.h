@@ -0,0 +1,137 @@
+#ifndef BINARY_MATCHER_ARENA_H
+#define BINARY_MATCHER_ARENA_H
+
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stddef.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Class that owns a region of memory that objects are allocated from
+// by bumping a pointer, and that is released all at once when the
+// arena is destroyed. Individual allocations are never freed.
+// Allocation is thread safe, so that components parsed concurrently
+// may share an arena.
+class Arena {
+public:
+  // Constructs an arena that has not yet allocated any memory.
+  Arena();
+
+  // Delete copy constructor and assignment.
+  Arena(const Arena&) = delete;
+  Arena &operator=(const Arena&) = delete;
+
+  // Releases all memory allocated from the arena.
+  // Objects allocated from the arena must have been destroyed.
+  ~Arena();
+
+  // Allocates size bytes aligned to alignment, which must be a power
+  // of two no greater than that of std::max_align_t.
+  void *Allocate(const size_t size, const size_t alignment);
+
+  // Constructs a T from args in memory allocated from the arena.
+  template <typename T, typename... Args>
+  T *New(Args&&... args)
+  {
+    return new (Allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+  }
+
+  // Returns the number of bytes the arena has obtained from the heap.
+  size_t MemoryUsage() const;
+
+private:
+  // Guards every member below.
+  mutable std::mutex mutex_;
+  // The blocks of memory obtained from the heap.
+  std::vector<void*> blocks_;
+  // The unallocated remainder of the most recent block.
+  char *next_;
+  char *end_;
+  // The size of the next block to be obtained.
+  size_t block_size_;
+  // The total size of the blocks.
+  size_t usage_;
+};
+
+// Allocator for standard containers that allocates from an Arena and
+// leaves deallocation to the arena's release. An allocator without an
+// arena uses the heap, so that containers not yet bound to an arena
+// (e.g. default-constructed members) behave as usual.
+template <typename T>
+class ArenaAllocator {
+public:
+  using value_type = T;
+
+  // Containers adopt the allocator, and so the arena, of those they
+  // are moved or swapped from.
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  ArenaAllocator() : arena_(nullptr) { }
+
+  explicit ArenaAllocator(Arena *const arena) : arena_(arena) { }
+
+  ArenaAllocator(const ArenaAllocator &other) : arena_(other.arena_) { }
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &other) : arena_(other.arena()) { }
+
+  ArenaAllocator &operator=(const ArenaAllocator &other)
+  {
+    arena_ = other.arena_;
+    return *this;
+  }
+
+  T *allocate(const size_t n)
+  {
+    if (!arena_) {
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T *const p, const size_t)
+  {
+    if (!arena_) {
+      ::operator delete(p);
+    }
+  }
+
+  // Returns the arena allocated from, or nullptr for the heap.
+  Arena *arena() const { return arena_; }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U> &other) const
+  {
+    return arena_ == other.arena();
+  }
+
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U> &other) const
+  {
+    return arena_ != other.arena();
+  }
+
+private:
+  Arena *arena_;
+};
+
+// A vector whose elements live in an Arena.
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+// Deleter for objects constructed with Arena::New, which destroys
+// the object but leaves its memory to the arena.
+template <typename T>
+struct ArenaDeleter {
+  void operator()(T *const p) const { p->~T(); }
+};
+
+// An owning pointer to an object constructed with Arena::New.
+template <typename T>
+using ArenaPtr = std::unique_ptr<T, ArenaDeleter<T>>;
+
+#endif // BINARY_MATCHER_ARENA_H
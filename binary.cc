@@ -1,30 +1,91 @@
 #include "elf/elf_binary.h"
 #include "binary.h"
+#include "binary_cache.h"
+#include "digest.h"
 #include "file.h"
+#include "file_loader.h"
+#include "status.h"
 
 #include <elf.h>
 #include <sstream>
 #include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// The number of bytes of a stream inspected before the rest is read:
+// enough to hold the headers that identify and describe a binary of
+// any handled format.
+const size_t kStreamPrefixSize = 0x100;
+
+// Checks that the first bytes of a stream hold a valid header of a
+// binary of a handled format, so that a stream that does not is
+// rejected without being read in full.
+static Status InspectStreamPrefix(const uint8_t *const prefix,
+                                  const size_t size)
+{
+  switch (Binary::GetBinaryType(prefix, size)) {
+    case Binary::Type::kElf:
+      return ElfBinary::CheckHeader(prefix, size);
+    case Binary::Type::kPexe: // FALLTHROUGH
+    case Binary::Type::kMach: // FALLTHROUGH
+    case Binary::Type::kUnknown: // FALLTHROUGH
+    default:
+      return Status(Status::Code::kUnsupported,
+                    "currently only handles ELF format files");
+  }
+}
+
+} // namespace
 
 const char *Binary::filename() const
 {
   return binary_->filename();
 }
 
+const File *Binary::file() const
+{
+  return binary_.get();
+}
+
 Binary::Type Binary::GetType() const
 {
   return Type::kUnknown;
 }
 
-Binary::Binary(const File *file) : binary_(file) { }
+Status Binary::StoreInCache(const BinaryCache&) const
+{
+  return Status(Status::Code::kUnsupported,
+                "binaries of this type are not cached");
+}
+
+ContentDigest Binary::Digest() const
+{
+  std::call_once(digest_once_, [this] {
+    digest_ = ComputeDigest(binary_->buffer(), binary_->size());
+  });
+  return digest_;
+}
+
+Binary::Binary(const File *file)
+  : binary_(file),
+    digest_once_(),
+    digest_() { }
 
 Binary::~Binary() { }
 
 Binary::Type Binary::GetBinaryType(const File *file)
+{
+  return GetBinaryType(file->buffer(), file->size());
+}
+
+Binary::Type Binary::GetBinaryType(const uint8_t *const buf, const size_t size)
 {
   // Check magic numbers to see if it's an ELF file.
-  const uint8_t *const buf = file->buffer();
-  if (file->size() >= 0x04
+  if (size >= 0x04
       && buf[EI_MAG0] == ELFMAG0
       && buf[EI_MAG1] == ELFMAG1
       && buf[EI_MAG2] == ELFMAG2
@@ -32,7 +93,7 @@ Binary::Type Binary::GetBinaryType(const File *file)
     return Binary::Type::kElf;
   }
   // Check magic numbers to see if it's a Portable Executable file.
-  if (file->size() >= 0x42
+  if (size >= 0x42
       && buf[0x00] == 'M'
       && buf[0x01] == 'Z'
       && buf[0x40] == 'P'
@@ -40,7 +101,7 @@ Binary::Type Binary::GetBinaryType(const File *file)
     return Binary::Type::kPexe;
   }
   // Check magic numbers to see if it's a MACH file.
-  if (file->size() >= 0x04
+  if (size >= 0x04
       && buf[0] == 0XFE
       && buf[1] == 0xED
       && buf[2] == 0xFA
@@ -51,25 +112,59 @@ Binary::Type Binary::GetBinaryType(const File *file)
   return Binary::Type::kUnknown;
 }
 
-Binary *Binary::ReadFromFile(const char *const binary_name)
+Result<Binary> Binary::ReadFromFile(const char *const binary_name,
+                                    const File::Options &options,
+                                    const BinaryCache *const cache)
 {
-  File *file = new File(binary_name);
+  return Parse(strcmp(binary_name, "-")
+      ? File::Open(binary_name, options)
+      : File::ReadStream(STDIN_FILENO, binary_name, kStreamPrefixSize,
+                         InspectStreamPrefix),
+      cache);
+}
 
-  Binary::Type type = GetBinaryType(file);
+void Binary::ReadFromFiles(const std::vector<const char*> &binary_names,
+                           const File::Options &options,
+                           const BinaryReady &ready,
+                           const BinaryCache *const cache)
+{
+  // stdin cannot be loaded alongside the files, so is read first.
+  std::vector<const char*> files;
+  std::vector<size_t> file_indices;
+  for (size_t i = 0; i < binary_names.size(); i++) {
+    if (!strcmp(binary_names[i], "-")) {
+      ready(i, ReadFromFile(binary_names[i], options, cache));
+    } else {
+      files.push_back(binary_names[i]);
+      file_indices.push_back(i);
+    }
+  }
+  LoadFiles(files, options,
+            [&ready, &file_indices, cache](const size_t i,
+                                           Result<File> file) {
+    ready(file_indices[i], Parse(std::move(file), cache));
+  });
+}
+
+Result<Binary> Binary::Parse(Result<File> file,
+                             const BinaryCache *const cache)
+{
+  if (!file.ok()) {
+    return file.status();
+  }
 
-  switch (type) {
+  switch (GetBinaryType(file.get())) {
     case Binary::Type::kElf: {
-      return ElfBinary::ParseFile(file);
+      return ElfBinary::ParseFile(file.release(), cache);
     }
     case Binary::Type::kPexe: // FALLTHROUGH
     case Binary::Type::kMach: // FALLTHROUGH
     case Binary::Type::kUnknown: // FALLTHROUGH
     default: {
-      fprintf(stderr, "Currently only handles ELF format files.\n");
-      exit(1);
+      return Status(Status::Code::kUnsupported,
+                    "currently only handles ELF format files");
     }
   }
-  return nullptr;
 }
 
 std::string Binary::ToString() const
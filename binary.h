@@ -1,10 +1,18 @@
 #ifndef BINARY_MATCHER_BINARY_H
 #define BINARY_MATCHER_BINARY_H
 
+#include "binary_cache.h"
+#include "digest.h"
+#include "file.h"
+#include "status.h"
+
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
 #include <string>
-
-class File;
+#include <vector>
 
 // A type representing a generic binary file.
 // This class is subtyped for various types of
@@ -21,10 +29,38 @@ public:
   // binary file, returns kUnknown.
   static Type GetBinaryType(const File *f);
 
-  // Reads a binary from the given file.
-  // If this is impossible (e.g. the file is empty,
-  // or otherwise not an binary), returns nullptr.
-  static Binary *ReadFromFile(const char *const f);
+  // Determines what type of binary the size bytes at buf begin,
+  // as GetBinaryType does for a file.
+  static Type GetBinaryType(const uint8_t *const buf, const size_t size);
+
+  // Reads a binary from the given file, mapped as the options direct.
+  // The file "-" is stdin, which is read in full into memory, and may
+  // be a pipe; a stream that does not begin with a valid header is
+  // rejected without reading the rest of it.
+  // If this is impossible (e.g. the file cannot be read, is empty,
+  // or is otherwise not a binary of a handled format), returns a
+  // status describing why, and never ends the process.
+  // If a cache is given, components of the binary stored in it are
+  // read from it rather than parsed (see StoreInCache).
+  static Result<Binary> ReadFromFile(
+      const char *const f,
+      const File::Options &options = File::Options(),
+      const BinaryCache *const cache = nullptr);
+
+  // Function receiving a binary read by ReadFromFiles: the position of
+  // its name among those read, and the binary, or the status
+  // describing why it could not be read.
+  using BinaryReady
+      = std::function<void(size_t index, Result<Binary> binary)>;
+
+  // Reads binaries from each of the given files, as ReadFromFile does,
+  // loading many files at once (see LoadFiles). Calls ready with each
+  // binary as soon as it has been read, so in the order the files
+  // finish loading rather than the order of their names.
+  static void ReadFromFiles(const std::vector<const char*> &fs,
+                            const File::Options &options,
+                            const BinaryReady &ready,
+                            const BinaryCache *const cache = nullptr);
 
   // Empty destructor.
   virtual ~Binary();
@@ -33,9 +69,26 @@ public:
   // with the binary.
   const char *filename() const;
 
+  // Returns the underlying File associated with the binary.
+  const File *file() const;
+
   // Returns the specific type of this binary.
   virtual Type GetType() const;
 
+  // Returns the digest of the whole of the binary's file (see
+  // ComputeDigest), computing it on first use. Binaries with different
+  // digests differ; equal digests only make it likely that they are
+  // identical, as the digest does not resist deliberate collisions.
+  ContentDigest Digest() const;
+
+  // Stores the costly parsed components of the binary (e.g. indexes of
+  // its symbols) in the cache, so that reading the same file with the
+  // cache later skips parsing them. Binaries read from streams, and
+  // binaries of types that keep nothing in the cache, are not stored.
+  // If the components cannot be stored, returns a status describing
+  // why.
+  virtual Status StoreInCache(const BinaryCache &cache) const;
+
   // Returns a string that summarises the binary.
   // This may include a string representation of various
   // components of the binary, e.g. section headers and
@@ -48,8 +101,17 @@ protected:
   Binary(const File *file);
 
 private:
+  // Parses a binary from a file that has been read, or passes on the
+  // status describing why it could not be.
+  static Result<Binary> Parse(Result<File> file,
+                              const BinaryCache *const cache);
+
   // The file that this object encapsulates.
   std::unique_ptr<const File> binary_;
+
+  // The digest of the file, computed on first use under its once_flag.
+  mutable std::once_flag digest_once_;
+  mutable ContentDigest digest_;
 };
 
 enum class Binary::Type {
@@ -0,0 +1,195 @@
+#include "binary_cache.h"
+#include "file.h"
+#include "status.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// The alignment of every value and array in an entry.
+const size_t kCacheAlignment = 8;
+
+// The version of the layout of entries, and of every component
+// serialized into them. Must be changed whenever any of them is, so
+// that entries written by other versions of the program are ignored.
+const uint32_t kCacheVersion = 3;
+
+// Type representing the header at the start of every entry.
+struct CacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  File::Identity identity;
+};
+
+// The magic number that every entry begins with.
+const char kCacheMagic[8] = {'B', 'M', 'C', 'A', 'C', 'H', 'E', '\0'};
+
+// Returns size rounded up to a multiple of kCacheAlignment.
+inline static size_t CacheAlign(const size_t size)
+{
+  return (size + kCacheAlignment - 1) & ~(kCacheAlignment - 1);
+}
+
+// Returns a status describing the failure of the named system call
+// on path, from errno.
+static Status CacheError(const char *const call, const std::string &path)
+{
+  return Status(Status::Code::kIoError,
+                std::string(call) + " " + path + ": " + strerror(errno));
+}
+
+// Writes the size bytes at data to fd in full.
+static bool WriteFully(const int fd, const uint8_t *data, size_t size)
+{
+  while (size) {
+    const ssize_t kWritten = write(fd, data, size);
+    if (kWritten < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += kWritten;
+    size -= static_cast<size_t>(kWritten);
+  }
+  return true;
+}
+
+} // namespace
+
+CacheWriter::CacheWriter() : contents_() { }
+
+CacheWriter::~CacheWriter() { }
+
+const std::vector<uint8_t> &CacheWriter::contents() const
+{
+  return contents_;
+}
+
+void CacheWriter::Append(const void *const data, const size_t size)
+{
+  const size_t kStart = contents_.size();
+  contents_.resize(kStart + CacheAlign(size), 0);
+  if (size) {
+    memcpy(&contents_[kStart], data, size);
+  }
+}
+
+CacheReader::CacheReader(const uint8_t *const buf, const size_t size)
+  : buf_(buf),
+    size_(size),
+    position_(0),
+    ok_(true) { }
+
+bool CacheReader::ok() const
+{
+  return ok_;
+}
+
+void CacheReader::Fail()
+{
+  ok_ = false;
+  position_ = size_;
+}
+
+void CacheReader::Take(void *const data, const size_t size)
+{
+  if (!size) {
+    return;
+  }
+  if (!ok_ || size > size_ - position_) {
+    Fail();
+    memset(data, 0, size);
+    return;
+  }
+  memcpy(data, buf_ + position_, size);
+  position_ += std::min(CacheAlign(size), size_ - position_);
+}
+
+BinaryCache::BinaryCache(std::string directory)
+  : directory_(std::move(directory)) { }
+
+BinaryCache::~BinaryCache() { }
+
+std::unique_ptr<BinaryCache::Entry>
+BinaryCache::Lookup(const File::Identity &identity) const
+{
+  // The entry's File names its path, so the path is placed first.
+  std::unique_ptr<Entry> entry(
+      new Entry{EntryPath(identity), nullptr, CacheReader(nullptr, 0)});
+  Result<File> file = File::Open(entry->path.c_str());
+  if (!file.ok() || file.get()->size() < sizeof(CacheHeader)) {
+    return nullptr;
+  }
+  CacheHeader header;
+  memcpy(&header, file.get()->buffer(), sizeof(header));
+  if (memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic))
+      || header.version != kCacheVersion
+      || memcmp(&header.identity, &identity, sizeof(identity))) {
+    return nullptr;
+  }
+  entry->reader = CacheReader(file.get()->buffer() + sizeof(header),
+                              file.get()->size() - sizeof(header));
+  entry->file = file.release();
+  return entry;
+}
+
+Status BinaryCache::Store(const File::Identity &identity,
+                          const std::vector<uint8_t> &contents) const
+{
+  if (mkdir(directory_.c_str(), 0777) < 0 && errno != EEXIST) {
+    return CacheError("mkdir", directory_);
+  }
+
+  CacheHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+  header.version = kCacheVersion;
+  header.identity = identity;
+
+  // Other processes may store the same entry at once, so each writes
+  // its own temporary file.
+  const std::string kPath = EntryPath(identity);
+  const std::string kTemporaryPath
+      = kPath + ".tmp." + std::to_string(getpid());
+  const int fd = open(kTemporaryPath.c_str(),
+                      O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  if (fd < 0) {
+    return CacheError("open", kTemporaryPath);
+  }
+  const bool kWritten
+      = WriteFully(fd, reinterpret_cast<const uint8_t*>(&header),
+                   sizeof(header))
+      && WriteFully(fd, contents.data(), contents.size());
+  Status status = kWritten ? Status() : CacheError("write", kTemporaryPath);
+  if (close(fd) < 0 && status.ok()) {
+    status = CacheError("close", kTemporaryPath);
+  }
+  if (status.ok() && rename(kTemporaryPath.c_str(), kPath.c_str()) < 0) {
+    status = CacheError("rename", kPath);
+  }
+  if (!status.ok()) {
+    unlink(kTemporaryPath.c_str());
+  }
+  return status;
+}
+
+std::string BinaryCache::EntryPath(const File::Identity &identity) const
+{
+  char name[64];
+  snprintf(name, sizeof(name), "/%llx-%llx",
+           static_cast<unsigned long long>(identity.device),
+           static_cast<unsigned long long>(identity.inode));
+  return directory_ + name;
+}
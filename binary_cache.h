@@ -0,0 +1,185 @@
+#ifndef BINARY_MATCHER_BINARY_CACHE_H
+#define BINARY_MATCHER_BINARY_CACHE_H
+
+#include "arena.h"
+#include "file.h"
+#include "status.h"
+
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Class that builds the contents of a cache entry: a sequence of
+// values and arrays, each aligned to 8 bytes, read back in the same
+// order by a CacheReader.
+class CacheWriter {
+public:
+  // Constructs a writer of an empty entry.
+  CacheWriter();
+
+  // Delete copy constructor and assignment.
+  CacheWriter(const CacheWriter&) = delete;
+  CacheWriter &operator=(const CacheWriter&) = delete;
+
+  ~CacheWriter();
+
+  // Appends a single value.
+  template <typename T>
+  void Write(const T value)
+  {
+    Append(&value, sizeof(value));
+  }
+
+  // Appends an array of values, preceded by its length.
+  template <typename T, typename Allocator>
+  void WriteArray(const std::vector<T, Allocator> &values)
+  {
+    Write<uint64_t>(values.size());
+    Append(values.data(), values.size() * sizeof(T));
+  }
+
+  // Returns the contents written so far.
+  const std::vector<uint8_t> &contents() const;
+
+private:
+  // Appends size bytes from data, padded to a multiple of 8 bytes.
+  void Append(const void *const data, const size_t size);
+
+  // The contents of the entry.
+  std::vector<uint8_t> contents_;
+};
+
+// Class that reads back, from a buffer, the values and arrays that a
+// CacheWriter wrote. Every read is checked against the end of the
+// buffer: once a read fails, the reader is failed, and every later
+// read returns zeroes or empty arrays, so that a caller can read a
+// whole entry and check ok() once at the end.
+class CacheReader {
+public:
+  // Constructs a reader of the size bytes at buf.
+  CacheReader(const uint8_t *const buf, const size_t size);
+
+  // Returns true if every read so far has succeeded.
+  bool ok() const;
+
+  // Fails the reader, for a value read that is not valid.
+  void Fail();
+
+  // Reads a single value.
+  template <typename T>
+  T Read()
+  {
+    T value = T();
+    Take(&value, sizeof(value));
+    return value;
+  }
+
+  // Reads a value, failing unless it is below limit.
+  template <typename T>
+  T Read(const T limit)
+  {
+    const T kValue = Read<T>();
+    if (kValue >= limit) {
+      Fail();
+      return T();
+    }
+    return kValue;
+  }
+
+  // Reads an array into a vector allocated from the arena.
+  template <typename T>
+  ArenaVector<T> ReadArray(Arena *const arena)
+  {
+    ArenaVector<T> values{ArenaAllocator<T>(arena)};
+    const uint64_t kCount = Read<uint64_t>();
+    if (kCount > (size_ - position_) / sizeof(T)) {
+      Fail();
+      return values;
+    }
+    values.resize(static_cast<size_t>(kCount));
+    Take(values.data(), values.size() * sizeof(T));
+    return values;
+  }
+
+  // Reads an array, failing unless every element is below limit:
+  // for arrays of positions in other arrays, or offsets into tables.
+  template <typename T>
+  ArenaVector<T> ReadArray(const uint64_t limit, Arena *const arena)
+  {
+    ArenaVector<T> values = ReadArray<T>(arena);
+    for (const T kValue : values) {
+      if (kValue >= limit) {
+        Fail();
+        break;
+      }
+    }
+    return values;
+  }
+
+private:
+  // Copies size bytes into data, and skips the padding that follows
+  // them. Fails the reader, and zeroes data, if there are not enough.
+  void Take(void *const data, const size_t size);
+
+  // The buffer read from.
+  const uint8_t *buf_;
+  // The size of the buffer.
+  size_t size_;
+  // The position of the next read.
+  size_t position_;
+  // False once a read has failed.
+  bool ok_;
+};
+
+// Class that represents a directory of cached components of parsed
+// binaries, so that a binary read again and again (e.g. the baseline
+// of many diffs) is parsed and indexed once, and read from its entry
+// thereafter.
+// Each entry belongs to one file, and records the identity of the
+// version of the file it was built from: an entry for a file that has
+// since been modified or replaced is never used, and is overwritten
+// when the file's components are next stored.
+class BinaryCache {
+public:
+  // Constructs a cache kept in the given directory, which is created
+  // when an entry is first stored if it does not exist.
+  explicit BinaryCache(std::string directory);
+
+  // Delete copy constructor and assignment.
+  BinaryCache(const BinaryCache&) = delete;
+  BinaryCache &operator=(const BinaryCache&) = delete;
+
+  ~BinaryCache();
+
+  // Type representing an entry found in the cache: a mapping of its
+  // file, and a reader of the contents it was stored with.
+  struct Entry {
+    std::string path;
+    std::unique_ptr<const File> file;
+    CacheReader reader;
+  };
+
+  // Looks up the entry for the file of the given identity, returning
+  // nullptr if there is none, or it was built from another version of
+  // the file or by another version of this program.
+  std::unique_ptr<Entry> Lookup(const File::Identity &identity) const;
+
+  // Stores contents as the entry for the file of the given identity,
+  // replacing any entry it had. The entry is written in full to a
+  // temporary file and then renamed into place, so that a reader never
+  // sees a partly written entry. If the entry cannot be written,
+  // returns a status describing why.
+  Status Store(const File::Identity &identity,
+               const std::vector<uint8_t> &contents) const;
+
+private:
+  // Returns the path of the entry for the file of the given identity.
+  std::string EntryPath(const File::Identity &identity) const;
+
+  // The directory holding the entries.
+  const std::string directory_;
+};
+
+#endif // BINARY_MATCHER_BINARY_CACHE_H
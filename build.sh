@@ -4,23 +4,30 @@
 # and then calls make with the arguments
 # given to this script.
 #
+# Every *_test.cc file is built into its own program under
+# ${bin_dir}/tests, linked against every object but main's;
+# './build.sh test' builds and runs them all.
+#
 # Overwrites any present file called 'makefile'.
 
 bin_dir="bin"
 obj_dir="obj"
 src_dir="./"
-srcs=$(find ${src_dir} -name '*.cc')
+srcs=$(find ${src_dir} -name '*.cc' -not -name '*_test.cc')
+test_srcs=$(find ${src_dir} -name '*_test.cc')
 
-mkdir -p ${bin_dir}
+mkdir -p ${bin_dir} ${bin_dir}/tests
 
 mkdir -p ${obj_dir}
 
 objects=""
+library_objects=""
+test_binaries=""
 binary="${bin_dir}/binary-matcher"
 rules=""
 
 # Make object rules
-for file in $srcs; do
+for file in $srcs $test_srcs; do
   file=${file/$src_dir/}
 
   # If the output directory doesn't exist, create it.
@@ -28,7 +35,22 @@ for file in $srcs; do
 
   obj="$file"
   obj="${obj_dir}/${obj/%cc/o}"
-  objects="$obj $objects"
+  case "$file" in
+    *_test.cc)
+      test_binary="${bin_dir}/tests/$(basename ${file%.cc})"
+      test_binaries="$test_binary $test_binaries"
+      rule=$(printf '%s: %s $(LIBOBJ)\n\t$(CC) -o %s %s $(LIBOBJ) $(LINKFLAGS)' \
+                    "$test_binary" "$obj" "$test_binary" "$obj")
+      rules=$(printf '%s\n\n%s' "$rules" "$rule")
+      ;;
+    main.cc)
+      objects="$obj $objects"
+      ;;
+    *)
+      objects="$obj $objects"
+      library_objects="$obj $library_objects"
+      ;;
+  esac
   dependency=$(g++ -I${src_dir} -MM -MT "$obj" -std=c++14 $file)
   # Remove implanted newlines
   dependency=$(echo $dependency | sed 's/ \\//g')
@@ -63,14 +85,19 @@ WARNINGS='-fmax-errors=5 -fstrict-aliasing -fstrict-overflow
 # build the actual makefile
 echo 'CC=g++' > makefile
 echo >> makefile
-echo CFLAGS=$WARNINGS -c -O2 -std=c++14 -I${src_dir} >> makefile
-echo LINKFLAGS=-std=c++14 >> makefile
+echo CFLAGS=$WARNINGS -c -O2 -std=c++14 -pthread -I${src_dir} >> makefile
+echo LINKFLAGS=-std=c++14 -pthread >> makefile
 echo >> makefile
 echo "OBJ=$objects" >> makefile
+echo "LIBOBJ=$library_objects" >> makefile
 echo "BIN=$binary" >> makefile
+echo "TESTS=$test_binaries" >> makefile
 echo >> makefile
 printf '%s:%s\n\n' 'all' ' $(OBJ) $(BIN)' >> makefile
-printf '%s\n\t%s\n\n' 'clean:' 'rm -rf $(OBJ) $(BIN)' >> makefile
+printf '%s\n\t%s\n\n' 'clean:' 'rm -rf $(OBJ) $(BIN) $(TESTS)' >> makefile
+printf '%s\n\t%s\n\n' 'test: $(TESTS)' \
+       'for t in $(TESTS); do $$t || exit 1; done' >> makefile
+printf '%s\n\n' '.PHONY: all clean test' >> makefile
 printf "%s:%s\n\t%s" \
        "$binary" \
        "$objects" \
@@ -0,0 +1,214 @@
+#include "diff/delta.h"
+#include "diff/mismatch.h"
+#include "suffix_array.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <initializer_list>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace {
+
+// The shortest match worth copying rather than inserting.
+const uint64_t kMinCopy = 8;
+
+// The fewest new bytes worth matching on another thread.
+const uint64_t kMatchGrain = 1 << 18;
+
+// The smallest that windows are made so that more of them fit the
+// memory budget at once, to be built on several threads: each still
+// reaches 16 MiB beyond the part of the old contents it stands for.
+const uint64_t kMinSharedWindow = 64 << 20;
+
+// Type representing a window of the old contents and the suffix
+// array over it.
+struct Window {
+  // The offset of the window in the old contents.
+  const uint64_t kOffset;
+  // The bytes of the window.
+  const uint8_t *const kData;
+  const uint64_t kSize;
+  // The suffix array of the window's bytes.
+  const std::vector<int32_t> kSuffixes;
+};
+
+// Returns the length of the longest prefix of the size bytes at
+// target that occurs in the window, storing its offset in the window
+// in *position. Binary searches the suffix array for the neighbours
+// of target, one of which shares its longest prefix with it.
+static uint64_t LongestMatch(const Window &window,
+                             const uint8_t *const target,
+                             const uint64_t size,
+                             uint64_t *const position)
+{
+  const std::vector<int32_t> &kSuffixes = window.kSuffixes;
+  if (kSuffixes.empty() || !size) {
+    return 0;
+  }
+  size_t low = 0;
+  size_t high = kSuffixes.size() - 1;
+  while (high - low >= 2) {
+    const size_t kMiddle = low + (high - low) / 2;
+    const uint64_t kSuffix = static_cast<uint64_t>(kSuffixes[kMiddle]);
+    const uint64_t kLength = std::min(window.kSize - kSuffix, size);
+    const uint64_t kCommon = FirstMismatch(window.kData + kSuffix, target,
+                                           static_cast<size_t>(kLength));
+    if (kCommon == size) {
+      *position = kSuffix;
+      return size;
+    }
+    // A suffix that is a prefix of target sorts before it.
+    if (kCommon == kLength
+        || window.kData[kSuffix + kCommon] < target[kCommon]) {
+      low = kMiddle;
+    } else {
+      high = kMiddle;
+    }
+  }
+
+  uint64_t best = 0;
+  for (const size_t i : {low, high}) {
+    const uint64_t kSuffix = static_cast<uint64_t>(kSuffixes[i]);
+    const uint64_t kCommon = FirstMismatch(
+        window.kData + kSuffix, target,
+        static_cast<size_t>(std::min(window.kSize - kSuffix, size)));
+    if (kCommon > best) {
+      best = kCommon;
+      *position = kSuffix;
+    }
+  }
+  return best;
+}
+
+// Appends to ops the steps that rebuild the new bytes from begin up
+// to end, greedily copying the longest match in the window at each
+// position and inserting the bytes that have no match worth copying.
+static void MatchRange(const Window &window, const uint8_t *const new_data,
+                       const uint64_t begin, const uint64_t end,
+                       std::vector<DeltaOp> *const ops)
+{
+  uint64_t inserted = begin;
+  uint64_t i = begin;
+  while (i < end) {
+    uint64_t position = 0;
+    const uint64_t kLength
+        = LongestMatch(window, new_data + i, end - i, &position);
+    if (kLength < kMinCopy) {
+      i++;
+      continue;
+    }
+    if (inserted < i) {
+      ops->push_back(DeltaOp{DeltaOp::Kind::kInsert, 0, inserted,
+                             i - inserted});
+    }
+    ops->push_back(DeltaOp{DeltaOp::Kind::kCopy, window.kOffset + position,
+                           i, kLength});
+    i += kLength;
+    inserted = i;
+  }
+  if (inserted < end) {
+    ops->push_back(DeltaOp{DeltaOp::Kind::kInsert, 0, inserted,
+                           end - inserted});
+  }
+}
+
+// Appends op to ops, merging it into the last step if it continues it:
+// an insert following an insert, or a copy of the old bytes following
+// those of the last copy.
+inline static void AppendOp(const DeltaOp &op, std::vector<DeltaOp> *const ops)
+{
+  if (!ops->empty() && ops->back().kKind == op.kKind
+      && (op.kKind == DeltaOp::Kind::kInsert
+          || ops->back().kOldOffset + ops->back().kLength == op.kOldOffset)) {
+    const DeltaOp kLast = ops->back();
+    ops->pop_back();
+    ops->push_back(DeltaOp{kLast.kKind, kLast.kOldOffset, kLast.kNewOffset,
+                           kLast.kLength + op.kLength});
+    return;
+  }
+  ops->push_back(op);
+}
+
+} // namespace
+
+std::vector<DeltaOp> ComputeDelta(const uint8_t *const old_data,
+                                  const uint64_t old_size,
+                                  const uint8_t *const new_data,
+                                  const uint64_t new_size,
+                                  const uint64_t memory_budget)
+{
+  ThreadPool *const pool = ThreadPool::Default();
+
+  // Old contents larger than a window are split into twice as many
+  // parts as windows, so that each window reaches a quarter of its
+  // size beyond the part of the old contents it stands for. Building
+  // a suffix array is serial, so such contents are given windows small
+  // enough that one per thread fits the budget, down to a floor, and
+  // the windows of that many parts are built at once.
+  const uint64_t kBudgetWindow = std::max<uint64_t>(1, std::min<uint64_t>(
+      memory_budget / kSuffixArrayBytesPerByte, kMaxSuffixArrayInput));
+  uint64_t window_size = kBudgetWindow;
+  if (old_size > kBudgetWindow) {
+    window_size = std::min(kBudgetWindow, std::max(
+        kMinSharedWindow, kBudgetWindow / pool->concurrency()));
+  }
+  const uint64_t kWindowSize = window_size;
+  const uint64_t kParts = old_size <= kWindowSize
+      ? 1 : (2*old_size + kWindowSize - 1) / kWindowSize;
+  const uint64_t kBatch = kBudgetWindow / kWindowSize;
+
+  std::vector<DeltaOp> ops;
+  for (uint64_t first = 0; first < kParts; first += kBatch) {
+    const size_t kBatchParts
+        = static_cast<size_t>(std::min(kBatch, kParts - first));
+    std::vector<std::unique_ptr<const Window>> windows(kBatchParts);
+    pool->ParallelFor(kBatchParts, [&](const size_t i) {
+      const uint64_t kPart = first + i;
+      const uint64_t kOldBegin = old_size * kPart / kParts;
+      const uint64_t kOldEnd = old_size * (kPart + 1) / kParts;
+      const uint64_t kSlack
+          = (kWindowSize - std::min(kWindowSize, kOldEnd - kOldBegin)) / 2;
+      const uint64_t kWindowBegin = std::min(
+          kOldBegin - std::min(kOldBegin, kSlack),
+          old_size - std::min(old_size, kWindowSize));
+      const uint64_t kWindowEnd
+          = std::min(old_size, kWindowBegin + kWindowSize);
+      windows[i].reset(new Window{
+        kWindowBegin,
+        old_data + kWindowBegin,
+        kWindowEnd - kWindowBegin,
+        BuildSuffixArray(old_data + kWindowBegin,
+                         static_cast<size_t>(kWindowEnd - kWindowBegin)),
+      });
+    });
+
+    for (size_t i = 0; i < kBatchParts; i++) {
+      const uint64_t kPart = first + i;
+      const uint64_t kNewBegin = new_size * kPart / kParts;
+      const uint64_t kNewEnd = new_size * (kPart + 1) / kParts;
+      const Window &window = *windows[i];
+
+      // Each range of the part is matched greedily on its own, so a
+      // match is cut short at the end of a range; the copies on either
+      // side of the cut are merged again below.
+      const uint64_t kPartSize = kNewEnd - kNewBegin;
+      const size_t kRanges = static_cast<size_t>(std::max<uint64_t>(
+          1, std::min<uint64_t>(kPartSize / kMatchGrain,
+                                4*pool->concurrency())));
+      std::vector<std::vector<DeltaOp>> range_ops(kRanges);
+      pool->ParallelFor(kRanges, [&](const size_t j) {
+        MatchRange(window, new_data, kNewBegin + kPartSize * j / kRanges,
+                   kNewBegin + kPartSize * (j + 1) / kRanges, &range_ops[j]);
+      });
+      for (const std::vector<DeltaOp> &range : range_ops) {
+        for (const DeltaOp &op : range) {
+          AppendOp(op, &ops);
+        }
+      }
+    }
+  }
+  return ops;
+}
@@ -0,0 +1,52 @@
+#ifndef BINARY_MATCHER_DIFF_DELTA_H
+#define BINARY_MATCHER_DIFF_DELTA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Type representing one step of rebuilding new contents from old:
+// either a copy of a run of old bytes, or an insert of new bytes.
+struct DeltaOp {
+  // An enumeration of the kinds of step.
+  enum class Kind;
+
+  // The kind of step.
+  const Kind kKind;
+  // The offset in the old contents of the bytes copied, or 0 for an
+  // insert.
+  const uint64_t kOldOffset;
+  // The offset in the new contents of the bytes the step produces.
+  const uint64_t kNewOffset;
+  // The number of bytes the step produces.
+  const uint64_t kLength;
+};
+
+enum class DeltaOp::Kind {
+  // The bytes are copied from the old contents.
+  kCopy,
+  // The bytes are new, and inserted as they are.
+  kInsert,
+};
+
+// Computes a delta that rebuilds the new_size bytes at new_data from
+// the old_size bytes at old_data, in the style of bsdiff: a suffix
+// array of the old bytes is searched for the longest match of each
+// position of the new, so that code that merely moved, by a few bytes
+// or across the section, becomes a few long copies rather than a
+// run of changed bytes. Both inputs are read in place.
+// At most memory_budget bytes are spent on suffix arrays. Old
+// contents too large for that are covered by windows that fit it a
+// few at a time, and each part of the new contents is matched only
+// against the window around the corresponding part of the old, so
+// that matches are found where contents shifted rather than moved far.
+// The windows that fit at once are built, and matching is spread,
+// across the default thread pool.
+// Returns the steps in order of the bytes they produce.
+std::vector<DeltaOp> ComputeDelta(const uint8_t *const old_data,
+                                  const uint64_t old_size,
+                                  const uint8_t *const new_data,
+                                  const uint64_t new_size,
+                                  const uint64_t memory_budget);
+
+#endif // BINARY_MATCHER_DIFF_DELTA_H
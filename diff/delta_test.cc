@@ -0,0 +1,134 @@
+#include "diff/delta.h"
+#include "suffix_array.h"
+#include "test.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace {
+
+// Rebuilds the new contents from the old and the delta computed
+// between them, checking that the delta's steps produce the new bytes
+// in order and copy only old bytes. Returns the number of bytes copied.
+static uint64_t ExpectRoundTrip(const std::vector<uint8_t> &old_data,
+                                const std::vector<uint8_t> &new_data,
+                                const uint64_t memory_budget)
+{
+  const std::vector<DeltaOp> kDelta = ComputeDelta(
+      old_data.data(), old_data.size(), new_data.data(), new_data.size(),
+      memory_budget);
+  std::vector<uint8_t> rebuilt;
+  uint64_t copied = 0;
+  for (const DeltaOp &op : kDelta) {
+    EXPECT_EQ(op.kNewOffset, rebuilt.size());
+    EXPECT(op.kLength > 0);
+    EXPECT(op.kNewOffset + op.kLength <= new_data.size());
+    if (op.kNewOffset + op.kLength > new_data.size()) {
+      return copied;
+    }
+    switch (op.kKind) {
+      case DeltaOp::Kind::kCopy:
+        EXPECT(op.kOldOffset + op.kLength <= old_data.size());
+        if (op.kOldOffset + op.kLength > old_data.size()) {
+          return copied;
+        }
+        rebuilt.insert(rebuilt.end(), old_data.data() + op.kOldOffset,
+                       old_data.data() + op.kOldOffset + op.kLength);
+        copied += op.kLength;
+        break;
+      case DeltaOp::Kind::kInsert:
+        rebuilt.insert(rebuilt.end(), new_data.data() + op.kNewOffset,
+                       new_data.data() + op.kNewOffset + op.kLength);
+        break;
+      default:
+        EXPECT(false);
+        return copied;
+    }
+  }
+  EXPECT(rebuilt == new_data);
+  return copied;
+}
+
+// The memory budget that leaves a window of the given bytes.
+inline static uint64_t BudgetFor(const uint64_t window)
+{
+  return window * kSuffixArrayBytesPerByte;
+}
+
+static void TestEmpty()
+{
+  uint64_t state = 1;
+  const std::vector<uint8_t> kData = RandomValues<uint8_t>(100, 256, &state);
+  EXPECT(ComputeDelta(kData.data(), kData.size(), kData.data(), 0,
+                      BudgetFor(1 << 20)).empty());
+  EXPECT_EQ(ExpectRoundTrip(std::vector<uint8_t>(), kData,
+                            BudgetFor(1 << 20)), 0U);
+  ExpectRoundTrip(kData, std::vector<uint8_t>(), BudgetFor(1 << 20));
+}
+
+static void TestIdentical()
+{
+  uint64_t state = 2;
+  const std::vector<uint8_t> kData = RandomValues<uint8_t>(50000, 256, &state);
+  const std::vector<DeltaOp> kDelta = ComputeDelta(
+      kData.data(), kData.size(), kData.data(), kData.size(),
+      BudgetFor(1 << 20));
+  EXPECT_EQ(kDelta.size(), 1U);
+  EXPECT_EQ(ExpectRoundTrip(kData, kData, BudgetFor(1 << 20)),
+            kData.size());
+}
+
+// Checks that contents shifted by an insertion and a deletion are
+// rebuilt mostly by copies.
+static void TestShifted()
+{
+  uint64_t state = 3;
+  const std::vector<uint8_t> kOld = RandomValues<uint8_t>(100000, 256, &state);
+  std::vector<uint8_t> new_data(kOld);
+  const std::vector<uint8_t> kInserted = RandomValues<uint8_t>(37, 256, &state);
+  new_data.insert(new_data.begin() + 20000, kInserted.begin(),
+                  kInserted.end());
+  new_data.erase(new_data.begin() + 70000, new_data.begin() + 70100);
+  EXPECT(ExpectRoundTrip(kOld, new_data, BudgetFor(1 << 20))
+         >= new_data.size() - kInserted.size());
+}
+
+// Checks contents larger than a window, which are split into parts.
+static void TestWindowed()
+{
+  uint64_t state = 4;
+  const std::vector<uint8_t> kOld = RandomValues<uint8_t>(200000, 256, &state);
+  std::vector<uint8_t> new_data(kOld);
+  for (size_t i = 0; i < new_data.size(); i += 9973) {
+    new_data.insert(new_data.begin() + static_cast<ptrdiff_t>(i), 0x90);
+  }
+  for (const uint64_t kWindow : {1U << 12, 1U << 14, 100000U}) {
+    EXPECT(ExpectRoundTrip(kOld, new_data, BudgetFor(kWindow))
+           > new_data.size() / 2);
+  }
+  // A budget too small for any window still yields a valid delta.
+  ExpectRoundTrip(kOld, new_data, 0);
+}
+
+// Checks unrelated contents, which are rebuilt by inserts.
+static void TestUnrelated()
+{
+  uint64_t state = 5;
+  const std::vector<uint8_t> kOld = RandomValues<uint8_t>(30000, 256, &state);
+  const std::vector<uint8_t> kNew = RandomValues<uint8_t>(30000, 256, &state);
+  ExpectRoundTrip(kOld, kNew, BudgetFor(1 << 20));
+  ExpectRoundTrip(kOld, kNew, BudgetFor(1 << 10));
+}
+
+} // namespace
+
+int main()
+{
+  RUN_TEST(TestEmpty);
+  RUN_TEST(TestIdentical);
+  RUN_TEST(TestShifted);
+  RUN_TEST(TestWindowed);
+  RUN_TEST(TestUnrelated);
+  return TestStatus();
+}
@@ -0,0 +1,758 @@
+#include "binary.h"
+#include "diff/delta.h"
+#include "diff/diff.h"
+#include "diff/function_diff.h"
+#include "diff/mismatch.h"
+#include "diff/normalize.h"
+#include "elf/elf_binary.h"
+#include "elf/elf_binary_note.h"
+#include "elf/elf_binary_section_header.h"
+#include "elf/elf_binary_section_index.h"
+#include "file.h"
+#include "merkle_tree.h"
+
+#include <algorithm>
+#include <elf.h>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using SectionHeader = ElfBinary::SectionHeader;
+
+namespace {
+
+// The most changed ranges listed per section by ToString.
+const size_t kMaxRangesShown = 16;
+
+// The memory spent on computing a delta by default: enough to match
+// sections of up to 200 MiB against the whole of the old section.
+const uint64_t kDefaultDeltaMemoryBudget = 1ULL << 30;
+
+// Type representing the bytes of a region of a file.
+struct Contents {
+  const uint8_t *const kData;
+  const uint64_t kSize;
+};
+
+// Returns the offset within the file of contents.
+inline static uint64_t ContentsOffset(const File *const file,
+                                      const Contents &contents)
+{
+  return static_cast<uint64_t>(contents.kData - file->buffer());
+}
+
+// Appends to ranges the runs of bytes from begin up to end in which
+// a and b differ, and adds their lengths to changed. A run that
+// starts where the last range ends extends it instead.
+static void CollectChangedRanges(const uint8_t *const a,
+                                 const uint8_t *const b,
+                                 const uint64_t begin, const uint64_t end,
+                                 std::vector<ByteRange> *const ranges,
+                                 uint64_t *const changed)
+{
+  uint64_t i = begin + FirstMismatch(a + begin, b + begin, end - begin);
+  while (i < end) {
+    uint64_t start = i;
+    const uint64_t kRun = FirstMatch(a + i, b + i, end - i);
+    if (!ranges->empty()
+        && ranges->back().kOffset + ranges->back().kLength == start) {
+      start = ranges->back().kOffset;
+      ranges->pop_back();
+    }
+    ranges->push_back(ByteRange{start, i + kRun - start});
+    *changed += kRun;
+    i += kRun;
+    i += FirstMismatch(a + i, b + i, end - i);
+  }
+}
+
+// Builds the diff of a section from the ranges of its common bytes
+// that changed, adding the bytes past the end of the shorter instance.
+static SectionDiff MakeSectionDiff(const std::string &name,
+                                   const uint64_t old_size,
+                                   const uint64_t new_size,
+                                   std::vector<ByteRange> ranges,
+                                   uint64_t changed)
+{
+  if (ranges.empty() && old_size == new_size) {
+    return SectionDiff{
+      name,
+      SectionDiff::Kind::kIdentical,
+      old_size,
+      new_size,
+      0,
+      std::vector<ByteRange>(),
+      std::vector<DeltaOp>(),
+    };
+  }
+
+  // Bytes past the end of the shorter section have changed too.
+  const uint64_t kCommon = std::min(old_size, new_size);
+  const uint64_t kLonger = std::max(old_size, new_size);
+  if (kLonger > kCommon) {
+    uint64_t start = kCommon;
+    if (!ranges.empty()
+        && ranges.back().kOffset + ranges.back().kLength == kCommon) {
+      start = ranges.back().kOffset;
+      ranges.pop_back();
+    }
+    ranges.push_back(ByteRange{start, kLonger - start});
+    changed += kLonger - kCommon;
+  }
+
+  return SectionDiff{
+    name,
+    SectionDiff::Kind::kChanged,
+    old_size,
+    new_size,
+    changed,
+    std::move(ranges),
+    std::vector<DeltaOp>(),
+  };
+}
+
+// Compares the contents of two instances of a section.
+// Identical contents are recognised by a single vectorized scan;
+// only when that finds a difference are the changed ranges
+// collected.
+static SectionDiff CompareContents(const std::string &name,
+                                   const Contents &old_contents,
+                                   const Contents &new_contents)
+{
+  std::vector<ByteRange> ranges;
+  uint64_t changed = 0;
+  CollectChangedRanges(old_contents.kData, new_contents.kData, 0,
+                       std::min(old_contents.kSize, new_contents.kSize),
+                       &ranges, &changed);
+  return MakeSectionDiff(name, old_contents.kSize, new_contents.kSize,
+                         std::move(ranges), changed);
+}
+
+// Returns true if the contents of sections of the kind of both old
+// and new are worth a delta: code and data, which shift as a whole
+// when anything before them grows or shrinks.
+inline static bool WantsDelta(const SectionHeader &old_section,
+                              const SectionHeader &new_section)
+{
+  return old_section.kType == SHT_PROGBITS && (old_section.kFlags & SHF_ALLOC)
+         && new_section.kType == SHT_PROGBITS
+         && (new_section.kFlags & SHF_ALLOC);
+}
+
+// Returns diff with the given delta.
+static SectionDiff WithDelta(const SectionDiff &diff,
+                             std::vector<DeltaOp> delta)
+{
+  return SectionDiff{
+    diff.kName,
+    diff.kKind,
+    diff.kOldSize,
+    diff.kNewSize,
+    diff.kChangedBytes,
+    diff.kChangedRanges,
+    std::move(delta),
+  };
+}
+
+// Compares the contents of a section of two files, as CompareContents
+// does, giving the comparison a delta if it found them changed and
+// delta is true. The contents are read in ahead of the scan, and
+// dropped from memory after it and the delta, so that diffing binaries
+// larger than memory reads each byte once and holds only the sections
+// being compared.
+static SectionDiff CompareFileContents(const std::string &name,
+                                       const File *const old_file,
+                                       const Contents &old_contents,
+                                       const File *const new_file,
+                                       const Contents &new_contents,
+                                       const bool delta,
+                                       const uint64_t memory_budget)
+{
+  old_file->Prefetch(ContentsOffset(old_file, old_contents),
+                     old_contents.kSize);
+  new_file->Prefetch(ContentsOffset(new_file, new_contents),
+                     new_contents.kSize);
+  const SectionDiff kDiff = CompareContents(name, old_contents, new_contents);
+  std::vector<DeltaOp> ops;
+  if (kDiff.kKind == SectionDiff::Kind::kChanged && delta) {
+    ops = ComputeDelta(old_contents.kData, old_contents.kSize,
+                       new_contents.kData, new_contents.kSize, memory_budget);
+  }
+  old_file->Release(ContentsOffset(old_file, old_contents),
+                    old_contents.kSize);
+  new_file->Release(ContentsOffset(new_file, new_contents),
+                    new_contents.kSize);
+  return ops.empty() ? kDiff : WithDelta(kDiff, std::move(ops));
+}
+
+// Compares the contents of a section of two files, as CompareContents
+// does, given Merkle trees over both. Only the chunks whose digests
+// differ are read, each in turn, so that comparing sections that
+// differ in a few places costs time in proportion to their number
+// rather than to the size of the sections.
+static SectionDiff CompareTreeContents(const std::string &name,
+                                       const File *const old_file,
+                                       const Contents &old_contents,
+                                       const MerkleTree &old_tree,
+                                       const File *const new_file,
+                                       const Contents &new_contents,
+                                       const MerkleTree &new_tree)
+{
+  const uint64_t kCommon = std::min(old_contents.kSize, new_contents.kSize);
+  const uint64_t kOldOffset = ContentsOffset(old_file, old_contents);
+  const uint64_t kNewOffset = ContentsOffset(new_file, new_contents);
+  std::vector<ByteRange> ranges;
+  uint64_t changed = 0;
+  for (const uint64_t kChunk : old_tree.DifferingChunks(new_tree)) {
+    const uint64_t kBegin = kChunk * MerkleTree::kChunkSize;
+    if (kBegin >= kCommon) {
+      break;
+    }
+    const uint64_t kLength
+        = std::min<uint64_t>(MerkleTree::kChunkSize, kCommon - kBegin);
+    old_file->Prefetch(kOldOffset + kBegin, kLength);
+    new_file->Prefetch(kNewOffset + kBegin, kLength);
+    CollectChangedRanges(old_contents.kData, new_contents.kData,
+                         kBegin, kBegin + kLength, &ranges, &changed);
+    old_file->Release(kOldOffset + kBegin, kLength);
+    new_file->Release(kNewOffset + kBegin, kLength);
+  }
+  return MakeSectionDiff(name, old_contents.kSize, new_contents.kSize,
+                         std::move(ranges), changed);
+}
+
+// Returns diff, a comparison of the contents of a section of two files
+// through their Merkle trees that found them changed, with a delta
+// that rebuilds the new contents from the old (see ComputeDelta).
+// The comparison read only the chunks that differ, so the contents
+// are read in whole here, and dropped from memory after.
+static SectionDiff AddDelta(const SectionDiff &diff,
+                            const File *const old_file,
+                            const Contents &old_contents,
+                            const File *const new_file,
+                            const Contents &new_contents,
+                            const uint64_t memory_budget)
+{
+  old_file->Prefetch(ContentsOffset(old_file, old_contents),
+                     old_contents.kSize);
+  new_file->Prefetch(ContentsOffset(new_file, new_contents),
+                     new_contents.kSize);
+  std::vector<DeltaOp> delta = ComputeDelta(
+      old_contents.kData, old_contents.kSize,
+      new_contents.kData, new_contents.kSize, memory_budget);
+  old_file->Release(ContentsOffset(old_file, old_contents),
+                    old_contents.kSize);
+  new_file->Release(ContentsOffset(new_file, new_contents),
+                    new_contents.kSize);
+  return WithDelta(diff, std::move(delta));
+}
+
+// Compares the instances of a section of two binaries of which either
+// was rewritten by normalizing its relocations (see NormalizedSections),
+// as CompareContents does, giving the comparison a delta if it found
+// them changed and delta is true. Both are compared as rewritten.
+static SectionDiff CompareNormalizedContents(
+    const std::string &name,
+    const NormalizedSections &old_normalized, const size_t old_section,
+    const NormalizedSections &new_normalized, const size_t new_section,
+    const bool delta, const uint64_t memory_budget)
+{
+  uint64_t old_size;
+  uint64_t new_size;
+  const Contents kOld{old_normalized.Contents(old_section, &old_size),
+                      old_size};
+  const Contents kNew{new_normalized.Contents(new_section, &new_size),
+                      new_size};
+  const SectionDiff kDiff = CompareContents(name, kOld, kNew);
+  if (kDiff.kKind != SectionDiff::Kind::kChanged || !delta) {
+    return kDiff;
+  }
+  return WithDelta(kDiff, ComputeDelta(kOld.kData, kOld.kSize,
+                                       kNew.kData, kNew.kSize,
+                                       memory_budget));
+}
+
+// Returns the position of section, which is numbered number, among
+// the sections of its binary that share its name.
+inline static size_t NameOccurrence(const ElfBinary::SectionIndex &index,
+                                    const SectionHeader &section,
+                                    const uint32_t number)
+{
+  const ElfBinary::SectionIndex::Sections kNamed
+      = index.SectionsNamed(section.kStringName);
+  return static_cast<size_t>(
+      std::lower_bound(kNamed.begin(), kNamed.end(), number) - kNamed.begin());
+}
+
+// Compares two ELF binaries section by section.
+// Sections are paired by name; where several sections share a name
+// they are paired in the order they appear in each binary.
+// If either binary was read from a cache, paired sections are
+// compared through their Merkle trees, which it already holds.
+// If the binaries' relocations were normalized, pairs of which either
+// section was rewritten are compared as rewritten instead.
+// Changed code and data sections are given a delta.
+static std::vector<SectionDiff>
+DiffElfSections(const ElfBinary &old_elf, const ElfBinary &new_elf,
+                const NormalizedSections *const old_normalized,
+                const NormalizedSections *const new_normalized,
+                const DiffOptions &options)
+{
+  const bool kUseTrees = old_elf.cached() || new_elf.cached();
+  const ArenaVector<SectionHeader> &old_sections
+      = old_elf.section_headers();
+  const ArenaVector<SectionHeader> &new_sections
+      = new_elf.section_headers();
+  const ElfBinary::SectionIndex &old_index = old_elf.section_index();
+  const ElfBinary::SectionIndex &new_index = new_elf.section_index();
+
+  std::vector<SectionDiff> diffs;
+  for (size_t i = 0; i < old_sections.size(); i++) {
+    const SectionHeader &old_section = old_sections[i];
+    if (old_section.kType == SHT_NULL) {
+      continue;
+    }
+    uint64_t old_size;
+    const uint8_t *const kOldData = old_elf.SectionContents(i, &old_size);
+    const Contents old_contents{kOldData, old_size};
+    // Pair the k'th old section of a name with the k'th new one.
+    const ElfBinary::SectionIndex::Sections kNewNamed
+        = new_index.SectionsNamed(old_section.kStringName);
+    const size_t kOccurrence = NameOccurrence(
+        old_index, old_section, static_cast<uint32_t>(i));
+    if (kOccurrence >= kNewNamed.size()) {
+      diffs.push_back(SectionDiff{
+        old_section.kStringName,
+        SectionDiff::Kind::kRemoved,
+        old_contents.kSize,
+        0,
+        0,
+        std::vector<ByteRange>(),
+        std::vector<DeltaOp>(),
+      });
+      continue;
+    }
+    const size_t kNew = kNewNamed[kOccurrence];
+    const SectionHeader &new_section = new_sections[kNew];
+    if (old_normalized && new_normalized
+        && (old_normalized->rewritten(i) || new_normalized->rewritten(kNew))) {
+      diffs.push_back(CompareNormalizedContents(
+          old_section.kStringName, *old_normalized, i, *new_normalized, kNew,
+          WantsDelta(old_section, new_section),
+          options.delta_memory_budget));
+      continue;
+    }
+    uint64_t new_size;
+    const uint8_t *const kNewData = new_elf.SectionContents(kNew, &new_size);
+    const Contents new_contents{kNewData, new_size};
+    const bool kDelta = WantsDelta(old_section, new_section);
+    if (!kUseTrees) {
+      diffs.push_back(CompareFileContents(old_section.kStringName,
+                                          old_elf.file(),
+                                          old_contents,
+                                          new_elf.file(),
+                                          new_contents,
+                                          kDelta,
+                                          options.delta_memory_budget));
+      continue;
+    }
+    const SectionDiff kDiff = CompareTreeContents(
+        old_section.kStringName,
+        old_elf.file(),
+        old_contents,
+        old_elf.section_trees()[i],
+        new_elf.file(),
+        new_contents,
+        new_elf.section_trees()[kNew]);
+    if (kDiff.kKind == SectionDiff::Kind::kChanged && kDelta) {
+      diffs.push_back(AddDelta(kDiff, old_elf.file(), old_contents,
+                               new_elf.file(), new_contents,
+                               options.delta_memory_budget));
+      continue;
+    }
+    diffs.push_back(kDiff);
+  }
+
+  // New sections beyond the number of old ones sharing their
+  // name were left unpaired.
+  for (size_t i = 0; i < new_sections.size(); i++) {
+    const SectionHeader &new_section = new_sections[i];
+    if (new_section.kType == SHT_NULL
+        || NameOccurrence(new_index, new_section, static_cast<uint32_t>(i))
+           < old_index.SectionsNamed(new_section.kStringName).size()) {
+      continue;
+    }
+    uint64_t new_size;
+    new_elf.SectionContents(i, &new_size);
+    diffs.push_back(SectionDiff{
+      new_section.kStringName,
+      SectionDiff::Kind::kAdded,
+      0,
+      new_size,
+      0,
+      std::vector<ByteRange>(),
+      std::vector<DeltaOp>(),
+    });
+  }
+
+  return diffs;
+}
+
+// Returns true if the parsed components of binary were read from a
+// cache entry (see ElfBinary::cached).
+inline static bool ReadFromCache(const Binary &binary)
+{
+  return binary.GetType() == Binary::Type::kElf
+      && static_cast<const ElfBinary&>(binary).cached();
+}
+
+// Returns the diff of the sections of binary against a byte-identical
+// copy of it: every section (or the whole contents, if the binary has
+// no notion of sections) is identical.
+static std::vector<SectionDiff> IdenticalSections(const Binary &binary)
+{
+  std::vector<SectionDiff> diffs;
+  if (binary.GetType() != Binary::Type::kElf) {
+    diffs.push_back(SectionDiff{
+      "<contents>",
+      SectionDiff::Kind::kIdentical,
+      binary.file()->size(),
+      binary.file()->size(),
+      0,
+      std::vector<ByteRange>(),
+      std::vector<DeltaOp>(),
+    });
+    return diffs;
+  }
+  const ElfBinary &elf = static_cast<const ElfBinary&>(binary);
+  const ArenaVector<SectionHeader> &sections = elf.section_headers();
+  for (size_t i = 0; i < sections.size(); i++) {
+    if (sections[i].kType == SHT_NULL) {
+      continue;
+    }
+    uint64_t size;
+    elf.SectionContents(i, &size);
+    diffs.push_back(SectionDiff{
+      sections[i].kStringName,
+      SectionDiff::Kind::kIdentical,
+      size,
+      size,
+      0,
+      std::vector<ByteRange>(),
+      std::vector<DeltaOp>(),
+    });
+  }
+  return diffs;
+}
+
+// Returns the build-id of binary in hexadecimal, or an empty string if
+// it carries none.
+inline static std::string BuildIdString(const Binary &binary)
+{
+  if (binary.GetType() != Binary::Type::kElf) {
+    return std::string();
+  }
+  const ElfBinary::Note *const kBuildId
+      = static_cast<const ElfBinary&>(binary).build_id();
+  if (!kBuildId || !kBuildId->kDescriptionSize) {
+    return std::string();
+  }
+  return kBuildId->DescriptionString();
+}
+
+// Returns the part of the binary's filename after its last '/'.
+inline static const char *BaseName(const Binary &binary)
+{
+  const char *const kSlash = strrchr(binary.filename(), '/');
+  return kSlash ? kSlash + 1 : binary.filename();
+}
+
+// Constructs a summary of a delta: how many bytes it copies and
+// inserts, in how many steps.
+static std::string DeltaString(const std::vector<DeltaOp> &delta)
+{
+  uint64_t copies = 0;
+  uint64_t copied = 0;
+  uint64_t inserts = 0;
+  uint64_t inserted = 0;
+  for (const DeltaOp &op : delta) {
+    switch (op.kKind) {
+      case DeltaOp::Kind::kCopy:
+        copies++;
+        copied += op.kLength;
+        break;
+      case DeltaOp::Kind::kInsert:
+        inserts++;
+        inserted += op.kLength;
+        break;
+      default:
+        break;
+    }
+  }
+  std::stringstream res;
+  res << copied << " bytes copied in " << copies << " copies, "
+      << inserted << " bytes inserted in " << inserts << " inserts";
+  return res.str();
+}
+
+// Converts a diff kind into a string.
+inline static const char *SectionDiffKindString(const SectionDiff::Kind kKind)
+{
+  switch (kKind) {
+    case SectionDiff::Kind::kIdentical: return "identical";
+    case SectionDiff::Kind::kChanged: return "changed";
+    case SectionDiff::Kind::kAdded: return "added";
+    case SectionDiff::Kind::kRemoved: return "removed";
+    default: return "UNKNOWN";
+  }
+}
+
+} // namespace
+
+const size_t BinaryPair::kNone;
+
+DiffOptions::DiffOptions()
+  : trust_build_ids(false),
+    functions(false),
+    normalize_relocations(false),
+    delta_memory_budget(kDefaultDeltaMemoryBudget) { }
+
+BinaryDiff Diff(const Binary &old_binary, const Binary &new_binary,
+                const DiffOptions &options)
+{
+  // The build-ids are found from the headers and notes alone, so
+  // binaries of the same build are recognised without reading their
+  // contents.
+  if (options.trust_build_ids
+      && old_binary.file()->size() == new_binary.file()->size()) {
+    std::string build_id = BuildIdString(old_binary);
+    if (!build_id.empty() && build_id == BuildIdString(new_binary)) {
+      return BinaryDiff{
+        old_binary.filename(),
+        new_binary.filename(),
+        std::vector<SectionDiff>(),
+        std::move(build_id),
+        std::vector<FunctionDiff>(),
+      };
+    }
+  }
+
+  // Byte-identical files need not be compared section by section.
+  // Files that differ usually do so early, where the comparison stops.
+  // Binaries read from a cache are left to their sections' Merkle
+  // trees, which avoid reading the files at all.
+  std::vector<SectionDiff> sections;
+  std::vector<FunctionDiff> functions;
+  if (!ReadFromCache(old_binary) && !ReadFromCache(new_binary)
+      && old_binary.file()->size() == new_binary.file()->size()
+      && FirstMismatch(old_binary.file()->buffer(),
+                       new_binary.file()->buffer(),
+                       old_binary.file()->size())
+         == old_binary.file()->size()) {
+    sections = IdenticalSections(old_binary);
+    if (options.functions
+        && old_binary.GetType() == Binary::Type::kElf
+        && new_binary.GetType() == Binary::Type::kElf) {
+      functions = DiffFunctions(static_cast<const ElfBinary&>(old_binary),
+                                static_cast<const ElfBinary&>(new_binary),
+                                nullptr, nullptr);
+    }
+  } else if (old_binary.GetType() == Binary::Type::kElf
+             && new_binary.GetType() == Binary::Type::kElf) {
+    const ElfBinary &old_elf = static_cast<const ElfBinary&>(old_binary);
+    const ElfBinary &new_elf = static_cast<const ElfBinary&>(new_binary);
+    std::unique_ptr<NormalizedSections> old_normalized;
+    std::unique_ptr<NormalizedSections> new_normalized;
+    if (options.normalize_relocations) {
+      old_normalized.reset(new NormalizedSections(old_elf));
+      new_normalized.reset(new NormalizedSections(new_elf));
+    }
+    sections = DiffElfSections(old_elf, new_elf, old_normalized.get(),
+                               new_normalized.get(), options);
+    if (options.functions) {
+      functions = DiffFunctions(old_elf, new_elf, old_normalized.get(),
+                                new_normalized.get());
+    }
+  } else {
+    // Without a notion of sections, compare the files wholesale.
+    const File *const old_file = old_binary.file();
+    const File *const new_file = new_binary.file();
+    sections.push_back(CompareFileContents(
+        "<contents>",
+        old_file,
+        Contents{old_file->buffer(), old_file->size()},
+        new_file,
+        Contents{new_file->buffer(), new_file->size()},
+        false,
+        options.delta_memory_budget));
+  }
+  return BinaryDiff{
+    old_binary.filename(),
+    new_binary.filename(),
+    std::move(sections),
+    std::string(),
+    std::move(functions),
+  };
+}
+
+std::vector<BinaryPair>
+PairBinaries(const std::vector<const Binary*> &old_binaries,
+             const std::vector<const Binary*> &new_binaries)
+{
+  std::vector<size_t> partners(old_binaries.size(), BinaryPair::kNone);
+  std::vector<bool> paired(new_binaries.size(), false);
+
+  // Pair by build-id, then by name, each time taking the first new
+  // binary with the key that is still unpaired.
+  const auto kPairBy = [&](const std::function<std::string(const Binary&)>
+                               &key) {
+    std::unordered_map<std::string, std::vector<size_t>> unpaired;
+    for (size_t i = new_binaries.size(); i-- > 0;) {
+      if (!paired[i]) {
+        unpaired[key(*new_binaries[i])].push_back(i);
+      }
+    }
+    unpaired.erase(std::string());
+    for (size_t i = 0; i < old_binaries.size(); i++) {
+      if (partners[i] != BinaryPair::kNone) {
+        continue;
+      }
+      const auto kFound = unpaired.find(key(*old_binaries[i]));
+      if (kFound == unpaired.end() || kFound->second.empty()) {
+        continue;
+      }
+      partners[i] = kFound->second.back();
+      paired[partners[i]] = true;
+      kFound->second.pop_back();
+    }
+  };
+  kPairBy(BuildIdString);
+  kPairBy([](const Binary &binary) { return std::string(BaseName(binary)); });
+
+  std::vector<BinaryPair> pairs;
+  for (size_t i = 0; i < old_binaries.size(); i++) {
+    pairs.push_back(BinaryPair{i, partners[i]});
+  }
+  for (size_t i = 0; i < new_binaries.size(); i++) {
+    if (!paired[i]) {
+      pairs.push_back(BinaryPair{BinaryPair::kNone, i});
+    }
+  }
+  return pairs;
+}
+
+SectionDiff::SectionDiff(const std::string &name, const Kind kind,
+                         const uint64_t old_size, const uint64_t new_size,
+                         const uint64_t changed_bytes,
+                         std::vector<ByteRange> changed_ranges,
+                         std::vector<DeltaOp> delta)
+  : kName(name),
+    kKind(kind),
+    kOldSize(old_size),
+    kNewSize(new_size),
+    kChangedBytes(changed_bytes),
+    kChangedRanges(std::move(changed_ranges)),
+    kDelta(std::move(delta)) { }
+
+SectionDiff::SectionDiff(const SectionDiff &other)
+  : kName(other.kName),
+    kKind(other.kKind),
+    kOldSize(other.kOldSize),
+    kNewSize(other.kNewSize),
+    kChangedBytes(other.kChangedBytes),
+    kChangedRanges(other.kChangedRanges),
+    kDelta(other.kDelta) { }
+
+SectionDiff::~SectionDiff() { }
+
+BinaryDiff::~BinaryDiff() { }
+
+bool BinaryDiff::Identical() const
+{
+  for (const SectionDiff &section : kSections) {
+    if (section.kKind != SectionDiff::Kind::kIdentical) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string SectionDiff::ToString() const
+{
+  std::stringstream res;
+  res << kName << ": " << SectionDiffKindString(kKind);
+  switch (kKind) {
+    case Kind::kIdentical:
+      res << ", " << kOldSize << " bytes";
+      break;
+    case Kind::kChanged:
+      res << ", " << kOldSize << " -> " << kNewSize << " bytes, "
+          << kChangedBytes << " bytes differ in "
+          << kChangedRanges.size() << " ranges";
+      if (!kDelta.empty()) {
+        res << "\n    delta: " << DeltaString(kDelta);
+      }
+      break;
+    case Kind::kAdded:
+      res << ", " << kNewSize << " bytes";
+      break;
+    case Kind::kRemoved:
+      res << ", " << kOldSize << " bytes";
+      break;
+    default:
+      break;
+  }
+  res << std::hex;
+  for (size_t i = 0; i < kChangedRanges.size() && i < kMaxRangesShown; i++) {
+    res << "\n    0x" << kChangedRanges[i].kOffset
+        << "-0x" << kChangedRanges[i].kOffset + kChangedRanges[i].kLength;
+  }
+  res << std::dec;
+  if (kChangedRanges.size() > kMaxRangesShown) {
+    res << "\n    ... " << kChangedRanges.size() - kMaxRangesShown
+        << " more ranges";
+  }
+  return res.str();
+}
+
+std::string BinaryDiff::ToString() const
+{
+  std::stringstream res;
+  res << "--- " << kOldName << "\n+++ " << kNewName << '\n';
+  if (!kSameBuild.empty()) {
+    res << "  identical build " << kSameBuild << '\n';
+  }
+  for (const SectionDiff &section : kSections) {
+    res << "  " << section.ToString() << '\n';
+  }
+  if (kFunctions.empty()) {
+    return res.str();
+  }
+
+  // Unchanged functions are only counted, unless renamed; there may be
+  // many.
+  size_t counts[4] = {0, 0, 0, 0};
+  size_t renamed = 0;
+  for (const FunctionDiff &function : kFunctions) {
+    counts[static_cast<size_t>(function.kKind)]++;
+    renamed += !function.kNewName.empty();
+    if (function.kKind != FunctionDiff::Kind::kUnchanged
+        || !function.kNewName.empty()) {
+      res << "  " << function.ToString() << '\n';
+    }
+  }
+  res << "  functions: "
+      << counts[static_cast<size_t>(FunctionDiff::Kind::kUnchanged)]
+      << " unchanged, "
+      << counts[static_cast<size_t>(FunctionDiff::Kind::kChanged)]
+      << " changed, "
+      << counts[static_cast<size_t>(FunctionDiff::Kind::kAdded)]
+      << " added, "
+      << counts[static_cast<size_t>(FunctionDiff::Kind::kRemoved)]
+      << " removed, " << renamed << " matched by similarity\n";
+  return res.str();
+}
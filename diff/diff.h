@@ -0,0 +1,168 @@
+#ifndef BINARY_MATCHER_DIFF_DIFF_H
+#define BINARY_MATCHER_DIFF_DIFF_H
+
+#include "diff/delta.h"
+#include "diff/function_diff.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class Binary;
+
+// Type representing a contiguous range of bytes.
+struct ByteRange {
+  // The offset of the first byte in the range.
+  const uint64_t kOffset;
+  // The number of bytes in the range.
+  const uint64_t kLength;
+};
+
+// Type representing the comparison of one section of a binary
+// against the identically named section of another.
+struct SectionDiff {
+  // An enumeration of the possible outcomes of the comparison.
+  enum class Kind;
+
+  // The name of the section.
+  const std::string kName;
+  // The outcome of the comparison.
+  const Kind kKind;
+  // The size of the section in the old binary, or 0 if added.
+  const uint64_t kOldSize;
+  // The size of the section in the new binary, or 0 if removed.
+  const uint64_t kNewSize;
+  // The total number of bytes covered by kChangedRanges.
+  const uint64_t kChangedBytes;
+  // The ranges, relative to the start of the section, in which the
+  // contents differ. Bytes past the end of the shorter section
+  // count as changed.
+  const std::vector<ByteRange> kChangedRanges;
+  // For a changed code or data section, the steps that rebuild its
+  // new contents from its old (see ComputeDelta); empty otherwise.
+  const std::vector<DeltaOp> kDelta;
+
+  // Constructs a section diff from each of its fields.
+  SectionDiff(const std::string &name, const Kind kind,
+              const uint64_t old_size, const uint64_t new_size,
+              const uint64_t changed_bytes,
+              std::vector<ByteRange> changed_ranges,
+              std::vector<DeltaOp> delta);
+
+  // Copy constructor.
+  SectionDiff(const SectionDiff &other);
+
+  // Empty destructor.
+  ~SectionDiff();
+
+  // Constructs a string representation of the section diff.
+  std::string ToString() const;
+};
+
+enum class SectionDiff::Kind {
+  // The section contents are byte-identical.
+  kIdentical,
+  // The section exists in both binaries but its contents differ.
+  kChanged,
+  // The section only exists in the new binary.
+  kAdded,
+  // The section only exists in the old binary.
+  kRemoved,
+};
+
+// Type representing the comparison of two binaries.
+struct BinaryDiff {
+  // The filename of the old binary.
+  const std::string kOldName;
+  // The filename of the new binary.
+  const std::string kNewName;
+  // The per-section comparisons, in old binary section order
+  // followed by any sections only present in the new binary.
+  // Empty if the binaries were recognised as the same build.
+  const std::vector<SectionDiff> kSections;
+  // The build-id, in hexadecimal, that both binaries were recognised
+  // as the same build by, without their contents being compared, or
+  // empty if they were compared.
+  const std::string kSameBuild;
+  // The per-function comparisons of ELF binaries, in order of name, if
+  // requested (see DiffOptions::functions); empty otherwise.
+  const std::vector<FunctionDiff> kFunctions;
+
+  // Empty destructor.
+  ~BinaryDiff();
+
+  // Returns true if no section was changed, added or removed.
+  bool Identical() const;
+
+  // Constructs a string representation of the diff, summarising
+  // each section and listing the ranges of those that changed, then
+  // listing the functions that changed, were added or were removed.
+  std::string ToString() const;
+};
+
+// Options controlling how binaries are compared.
+struct DiffOptions {
+  // Constructs the default options: build-ids are not trusted.
+  DiffOptions();
+
+  // If true, ELF binaries of the same size that carry the same
+  // build-id are taken to be the same build, and are reported as
+  // identical without their contents being read. Build-ids are
+  // chosen by the linker, so this is only safe where every binary
+  // carrying one was linked from the inputs it identifies.
+  bool trust_build_ids;
+
+  // If true, ELF binaries are also compared function by function
+  // (see DiffFunctions).
+  bool functions;
+
+  // If true, the places in ELF binaries that their relocations patch
+  // are rewritten to stand for the targets of the relocations before
+  // sections and functions are compared (see NormalizedSections), so
+  // that references to code or data that merely moved compare equal.
+  bool normalize_relocations;
+
+  // The most memory spent on suffix arrays when computing the delta
+  // of a changed section (see ComputeDelta).
+  uint64_t delta_memory_budget;
+};
+
+// Type representing a pairing of an old binary with a new one to be
+// compared, by their positions in the lists of each.
+struct BinaryPair {
+  // The position of a binary left without a partner.
+  static const size_t kNone = SIZE_MAX;
+
+  // The position of the old binary, or kNone if the new binary has
+  // no partner.
+  const size_t kOld;
+  // The position of the new binary, or kNone if the old binary has
+  // no partner.
+  const size_t kNew;
+};
+
+// Compares two binaries.
+// ELF binaries are compared section by section, pairing sections
+// by name. Byte-identical sections are detected with a vectorized
+// scan and skipped; only sections that differ are diffed in detail,
+// and code and data sections that differ are given a delta.
+// If either binary was read from a cache, sections are compared
+// through the Merkle trees cached for them instead, so that only the
+// chunks whose digests differ are read at all. Sections rewritten by
+// normalizing relocations (see DiffOptions::normalize_relocations)
+// are compared in full, as rewritten.
+// Binaries of any other type are compared as a single blob.
+BinaryDiff Diff(const Binary &old_binary, const Binary &new_binary,
+                const DiffOptions &options = DiffOptions());
+
+// Pairs each old binary with the new binary that it should be compared
+// against: first the binaries that carry the same build-id, so that a
+// renamed but unchanged binary finds its partner, then those left that
+// share a file name, ignoring directories. Returns the pairs in the
+// order of the old binaries, followed by the unpaired new binaries.
+std::vector<BinaryPair>
+PairBinaries(const std::vector<const Binary*> &old_binaries,
+             const std::vector<const Binary*> &new_binaries);
+
+#endif // BINARY_MATCHER_DIFF_DIFF_H
@@ -0,0 +1,58 @@
+#include "diff/edit_distance.h"
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+uint64_t EditDistance(const uint64_t *old_tokens, size_t old_size,
+                      const uint64_t *new_tokens, size_t new_size,
+                      const uint64_t max_work)
+{
+  while (old_size && new_size && *old_tokens == *new_tokens) {
+    old_tokens++;
+    new_tokens++;
+    old_size--;
+    new_size--;
+  }
+  while (old_size && new_size
+         && old_tokens[old_size - 1] == new_tokens[new_size - 1]) {
+    old_size--;
+    new_size--;
+  }
+  const uint64_t kTotal = old_size + new_size;
+  if (!old_size || !new_size) {
+    return kTotal;
+  }
+
+  // Each round of the search extends every diagonal by one edit, at a
+  // cost of up to the total size, so the rounds are bounded by that.
+  const uint64_t kMaxEdits = std::min<uint64_t>(
+      kTotal, std::max<uint64_t>(1, max_work / kTotal));
+  const int64_t kOldSize = static_cast<int64_t>(old_size);
+  const int64_t kNewSize = static_cast<int64_t>(new_size);
+  const int64_t kMax = static_cast<int64_t>(kMaxEdits);
+
+  // furthest[kMax + k] is the furthest position in the old tokens
+  // reached along diagonal k (old position minus new position).
+  std::vector<int64_t> furthest(static_cast<size_t>(2 * kMax + 3), 0);
+  for (int64_t d = 0; d <= kMax; d++) {
+    for (int64_t k = -d; k <= d; k += 2) {
+      int64_t *const kDiagonal = &furthest[static_cast<size_t>(kMax + k + 1)];
+      int64_t x = k == -d || (k != d && kDiagonal[-1] < kDiagonal[1])
+          ? kDiagonal[1] : kDiagonal[-1] + 1;
+      int64_t y = x - k;
+      while (x < kOldSize && y < kNewSize
+             && old_tokens[static_cast<size_t>(x)]
+                == new_tokens[static_cast<size_t>(y)]) {
+        x++;
+        y++;
+      }
+      *kDiagonal = x;
+      if (x >= kOldSize && y >= kNewSize) {
+        return static_cast<uint64_t>(d);
+      }
+    }
+  }
+  return kTotal;
+}
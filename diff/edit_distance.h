@@ -0,0 +1,21 @@
+#ifndef BINARY_MATCHER_DIFF_EDIT_DISTANCE_H
+#define BINARY_MATCHER_DIFF_EDIT_DISTANCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Returns the number of tokens that must be deleted from the old_size
+// tokens at old_tokens and inserted from the new_size tokens at
+// new_tokens to turn one into the other: the length of the shortest
+// edit script between them, found by Myers' O(ND) algorithm after
+// their common prefix and suffix are stripped. Only the frontier of
+// the search is kept, in space linear in the sizes.
+// The search stops once it has spent about max_work steps, returning
+// the total size of the differing middles instead, an upper bound.
+uint64_t EditDistance(const uint64_t *const old_tokens,
+                      const size_t old_size,
+                      const uint64_t *const new_tokens,
+                      const size_t new_size,
+                      const uint64_t max_work);
+
+#endif // BINARY_MATCHER_DIFF_EDIT_DISTANCE_H
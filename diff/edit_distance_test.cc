@@ -0,0 +1,115 @@
+#include "diff/edit_distance.h"
+#include "test.h"
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace {
+
+// Enough steps for every search in these tests to finish.
+const uint64_t kUnlimitedWork = UINT64_MAX;
+
+// Returns the number of insertions and deletions between a and b,
+// found through the longest common subsequence by dynamic programming.
+static uint64_t NaiveEditDistance(const std::vector<uint64_t> &a,
+                                  const std::vector<uint64_t> &b)
+{
+  std::vector<size_t> row(b.size() + 1, 0);
+  for (size_t i = 1; i <= a.size(); i++) {
+    size_t diagonal = 0;
+    for (size_t j = 1; j <= b.size(); j++) {
+      const size_t kAbove = row[j];
+      row[j] = a[i - 1] == b[j - 1]
+          ? diagonal + 1 : std::max(row[j], row[j - 1]);
+      diagonal = kAbove;
+    }
+  }
+  return a.size() + b.size() - 2 * row[b.size()];
+}
+
+// Returns the edit distance between a and b, searching for at most
+// max_work steps.
+static uint64_t Distance(const std::vector<uint64_t> &a,
+                         const std::vector<uint64_t> &b,
+                         const uint64_t max_work)
+{
+  return EditDistance(a.data(), a.size(), b.data(), b.size(), max_work);
+}
+
+static void TestEdgeCases()
+{
+  const std::vector<uint64_t> kEmpty;
+  const std::vector<uint64_t> kTokens{1, 2, 3, 4};
+  EXPECT_EQ(Distance(kEmpty, kEmpty, kUnlimitedWork), 0U);
+  EXPECT_EQ(Distance(kEmpty, kTokens, kUnlimitedWork), 4U);
+  EXPECT_EQ(Distance(kTokens, kEmpty, kUnlimitedWork), 4U);
+  EXPECT_EQ(Distance(kTokens, kTokens, kUnlimitedWork), 0U);
+  EXPECT_EQ(Distance(kTokens, {1, 2, 9, 4}, kUnlimitedWork), 2U);
+  EXPECT_EQ(Distance(kTokens, {2, 3, 4, 1}, kUnlimitedWork), 2U);
+  EXPECT_EQ(Distance({5, 6, 7}, {8, 9}, kUnlimitedWork), 5U);
+}
+
+// Checks random pairs, related and not, against dynamic programming.
+static void TestRandom()
+{
+  uint64_t state = 0x2545f4914f6cdd1dULL;
+  for (const uint64_t kAlphabet : {2U, 4U, 1000U}) {
+    for (size_t size = 0; size <= 120; size += 13) {
+      const std::vector<uint64_t> kOld
+          = RandomValues<uint64_t>(size, kAlphabet, &state);
+      const std::vector<uint64_t> kUnrelated
+          = RandomValues<uint64_t>(size + NextRandom(&state) % 20,
+                                   kAlphabet, &state);
+      EXPECT_EQ(Distance(kOld, kUnrelated, kUnlimitedWork),
+                NaiveEditDistance(kOld, kUnrelated));
+
+      // A few tokens of the old replaced, inserted and deleted.
+      std::vector<uint64_t> edited(kOld);
+      for (int edit = 0; edit < 5 && !edited.empty(); edit++) {
+        const size_t kAt = NextRandom(&state) % edited.size();
+        switch (NextRandom(&state) % 3) {
+          case 0:
+            edited[kAt] = NextRandom(&state) % kAlphabet;
+            break;
+          case 1:
+            edited.insert(edited.begin() + static_cast<ptrdiff_t>(kAt),
+                          NextRandom(&state) % kAlphabet);
+            break;
+          default:
+            edited.erase(edited.begin() + static_cast<ptrdiff_t>(kAt));
+            break;
+        }
+      }
+      EXPECT_EQ(Distance(kOld, edited, kUnlimitedWork),
+                NaiveEditDistance(kOld, edited));
+    }
+  }
+}
+
+// Checks that a search cut short returns an upper bound no greater
+// than the total size of the inputs.
+static void TestLimitedWork()
+{
+  uint64_t state = 7;
+  const std::vector<uint64_t> kOld = RandomValues<uint64_t>(2000, 4, &state);
+  const std::vector<uint64_t> kNew = RandomValues<uint64_t>(2000, 4, &state);
+  const uint64_t kExact = NaiveEditDistance(kOld, kNew);
+  for (const uint64_t kWork : {0U, 1U, 100U, 10000U}) {
+    const uint64_t kBound = Distance(kOld, kNew, kWork);
+    EXPECT(kBound >= kExact);
+    EXPECT(kBound <= kOld.size() + kNew.size());
+  }
+  EXPECT_EQ(Distance(kOld, kNew, kUnlimitedWork), kExact);
+}
+
+} // namespace
+
+int main()
+{
+  RUN_TEST(TestEdgeCases);
+  RUN_TEST(TestRandom);
+  RUN_TEST(TestLimitedWork);
+  return TestStatus();
+}
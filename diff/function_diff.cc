@@ -0,0 +1,514 @@
+#include "diff/edit_distance.h"
+#include "diff/function_diff.h"
+#include "diff/instruction_tokens.h"
+#include "diff/minhash.h"
+#include "diff/mismatch.h"
+#include "diff/normalize.h"
+#include "diff/symbolic_targets.h"
+#include "elf/elf_binary.h"
+#include "elf/elf_binary_header.h"
+#include "elf/elf_binary_section_header.h"
+#include "elf/elf_binary_symbol_table.h"
+#include "parallel.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <elf.h>
+#include <memory>
+#include <sstream>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using SectionHeader = ElfBinary::SectionHeader;
+using SymbolTable = ElfBinary::SymbolTable;
+
+namespace {
+
+// The number of function pairs that a thread claims at a time.
+const size_t kPairGrain = 256;
+
+// The most steps spent finding the edit script between the
+// instructions of a pair of functions, beyond which its length is
+// estimated (see EditDistance).
+const uint64_t kMaxEditWork = 1 << 26;
+
+// The number of consecutive instructions, or bytes if instructions
+// are not decoded, that make up a shingle of a function's signature.
+const size_t kInstructionShingle = 3;
+const size_t kByteShingle = 8;
+
+// The fewest hashes on which the signatures of two functions must
+// agree for them to be paired by similarity: about half of their
+// shingles must be shared.
+const size_t kMinAgreement = kMinHashSize / 2;
+
+// Type representing a function of one binary and its bytes.
+struct Function {
+  // The function's name.
+  const char *name;
+  // The index of the function's symbol in its table.
+  size_t symbol;
+  // The function's size, according to its symbol.
+  uint64_t size;
+  // The function's address, according to its symbol.
+  uint64_t address;
+  // The bytes of the function, of which there are none if they do not
+  // lie within the file.
+  const uint8_t *data;
+  uint64_t data_size;
+  // The data_size bytes that the function's instructions are decoded
+  // from: its bytes, or in a relocatable object those bytes with the
+  // places that relocations patch rewritten to stand for their targets.
+  const uint8_t *code;
+  // True if the function was outlined by .eh_frame and has no name but
+  // the sub_ one made of its address (see FunctionTable).
+  bool anonymous;
+};
+
+// Type representing a function of the old binary paired with one of
+// the new, either of which is nullptr if the other has no partner.
+struct FunctionPair {
+  const Function *const kOld;
+  const Function *const kNew;
+};
+
+// Returns the symbol table that the functions of elf are found in:
+// .symtab or, if it was stripped, the functions outlined by .eh_frame,
+// or failing both, .dynsym.
+static const SymbolTable *FunctionTable(const ElfBinary &elf)
+{
+  const SymbolTable *const table = elf.symbol_table(".symtab");
+  if (strcmp(table->type(), "N/A")) {
+    return table;
+  }
+  const SymbolTable *const frames = elf.frame_symbol_table();
+  return strcmp(frames->type(), "N/A") ? frames : elf.symbol_table(".dynsym");
+}
+
+// Returns the functions of elf, from FunctionTable, ordered by name,
+// then by their order in the table. Their bytes are read from
+// normalized, if given, rather than from the file, and their code
+// from relocated, if given, rather than their bytes.
+static std::vector<Function>
+CollectFunctions(const ElfBinary &elf,
+                 const NormalizedSections *const normalized,
+                 const NormalizedSections *const relocated)
+{
+  const SymbolTable *const table = FunctionTable(elf);
+  const bool kFrames = table == elf.frame_symbol_table();
+  const ArenaVector<SectionHeader> &sections = elf.section_headers();
+  const SymbolTable::Columns &columns = table->columns();
+
+  std::vector<Function> functions;
+  for (size_t i = 0; i < table->size(); i++) {
+    const uint16_t kSection = columns.section_header_indices[i];
+    if (ELF64_ST_TYPE(columns.infos[i]) != STT_FUNC
+        || kSection == SHN_UNDEF || kSection >= sections.size()) {
+      continue;
+    }
+    // In relocatable objects a function's value is its offset within
+    // its section, whose address is 0; elsewhere it is its address.
+    const SectionHeader &section = sections[kSection];
+    const uint64_t kValue = columns.values[i];
+    const uint64_t kSize = columns.sizes[i];
+    uint64_t contents_size;
+    const uint8_t *const kContents = normalized
+        ? normalized->Contents(kSection, &contents_size)
+        : elf.SectionContents(kSection, &contents_size);
+    const bool kInFile = kValue >= section.kAddress
+        && ElfRangeInBounds(kValue - section.kAddress, kSize, contents_size);
+    const uint8_t *const kData
+        = kInFile ? kContents + (kValue - section.kAddress) : kContents;
+    uint64_t code_size;
+    const uint8_t *const kCode = relocated && kInFile
+        ? relocated->Contents(kSection, &code_size)
+          + (kValue - section.kAddress)
+        : kData;
+    functions.push_back(Function{
+      table->name(i),
+      i,
+      kSize,
+      kValue,
+      kData,
+      kInFile ? kSize : 0,
+      kCode,
+      kFrames && !strncmp(table->name(i), "sub_", 4),
+    });
+  }
+
+  ParallelSort(functions.begin(), functions.end(),
+               [](const Function &a, const Function &b) {
+    const int kOrder = strcmp(a.name, b.name);
+    return kOrder < 0 || (!kOrder && a.symbol < b.symbol);
+  });
+  return functions;
+}
+
+// Computes into signature the MinHash signature of function, over its
+// instructions if decode is set and its bytes otherwise, using tokens
+// as scratch space. Returns false if the function is too short to
+// have one.
+static bool ComputeFunctionSignature(const Function &function,
+                                     const uint16_t machine,
+                                     const bool decode,
+                                     const SymbolicTargets *const targets,
+                                     std::vector<uint64_t> *const tokens,
+                                     MinHashSignature *const signature)
+{
+  tokens->clear();
+  if (!decode) {
+    tokens->assign(function.data, function.data + function.data_size);
+    return ComputeMinHash(tokens->data(), tokens->size(), kByteShingle,
+                          signature);
+  }
+  TokenizeInstructions(machine, function.code, function.data_size,
+                       function.address, targets, tokens);
+  return ComputeMinHash(tokens->data(), tokens->size(),
+                        kInstructionShingle, signature);
+}
+
+// Computes the signatures of the functions of pairs at the given
+// positions, in parallel. Returns the positions of those that have
+// one, and their signatures.
+static std::vector<size_t>
+ComputePairSignatures(const std::vector<FunctionPair> &pairs,
+                      const std::vector<size_t> &positions,
+                      const bool old_side, const uint16_t machine,
+                      const bool decode,
+                      const SymbolicTargets *const targets,
+                      std::vector<MinHashSignature> *const signatures)
+{
+  std::vector<MinHashSignature> computed(positions.size());
+  std::vector<uint8_t> valid(positions.size());
+  ThreadPool::Default()->ParallelFor(
+      (positions.size() + kPairGrain - 1) / kPairGrain,
+      [&](const size_t batch) {
+    std::vector<uint64_t> tokens;
+    const size_t kEnd = std::min(positions.size(), (batch + 1) * kPairGrain);
+    for (size_t k = batch * kPairGrain; k < kEnd; k++) {
+      const FunctionPair &pair = pairs[positions[k]];
+      valid[k] = ComputeFunctionSignature(
+          old_side ? *pair.kOld : *pair.kNew, machine, decode, targets,
+          &tokens, &computed[k]);
+    }
+  });
+
+  std::vector<size_t> kept;
+  for (size_t k = 0; k < positions.size(); k++) {
+    if (valid[k]) {
+      kept.push_back(positions[k]);
+      signatures->push_back(computed[k]);
+    }
+  }
+  return kept;
+}
+
+// Rebuilds pairs, as they are immutable, giving each old function the
+// new partner in partners at its position, if any, and dropping the
+// pairs whose positions are taken.
+static void RebuildPairs(const std::vector<const Function *> &partners,
+                         const std::vector<bool> &taken,
+                         std::vector<FunctionPair> *const pairs)
+{
+  std::vector<FunctionPair> rebuilt;
+  rebuilt.reserve(pairs->size());
+  for (size_t k = 0; k < pairs->size(); k++) {
+    const FunctionPair &pair = (*pairs)[k];
+    if (taken[k]) {
+      continue;
+    }
+    rebuilt.push_back(
+        FunctionPair{pair.kOld, partners[k] ? partners[k] : pair.kNew});
+  }
+  pairs->swap(rebuilt);
+}
+
+// Pairs the old functions of pairs that have no new partner with the
+// new functions that have no old one, by the similarity of their
+// signatures. Each paired old function takes its partner, which is
+// dropped from where it stood alone.
+static void PairBySimilarity(const uint16_t machine, const bool decode,
+                             const SymbolicTargets *const old_targets,
+                             const SymbolicTargets *const new_targets,
+                             std::vector<FunctionPair> *const pairs)
+{
+  std::vector<size_t> removed;
+  std::vector<size_t> added;
+  for (size_t k = 0; k < pairs->size(); k++) {
+    const FunctionPair &pair = (*pairs)[k];
+    if (!pair.kNew) {
+      removed.push_back(k);
+    } else if (!pair.kOld) {
+      added.push_back(k);
+    }
+  }
+  if (removed.empty() || added.empty()) {
+    return;
+  }
+
+  std::vector<MinHashSignature> old_signatures;
+  std::vector<MinHashSignature> new_signatures;
+  removed = ComputePairSignatures(*pairs, removed, true, machine, decode,
+                                  old_targets, &old_signatures);
+  added = ComputePairSignatures(*pairs, added, false, machine, decode,
+                                new_targets, &new_signatures);
+  const std::vector<MinHashMatch> kMatches
+      = MatchMinHashes(old_signatures, new_signatures, kMinAgreement);
+  if (kMatches.empty()) {
+    return;
+  }
+
+  std::vector<const Function *> partners(pairs->size(), nullptr);
+  std::vector<bool> taken(pairs->size(), false);
+  for (const MinHashMatch &match : kMatches) {
+    partners[removed[match.kOld]] = (*pairs)[added[match.kNew]].kNew;
+    taken[added[match.kNew]] = true;
+  }
+  RebuildPairs(partners, taken, pairs);
+}
+
+// Pairs the anonymous old functions of pairs that have no new partner
+// with the new function of the same name, and so address, if it has no
+// old one and is of the same size: the same stretch of code, edited
+// too much to be paired by similarity.
+static void PairAnonymousBySize(std::vector<FunctionPair> *const pairs)
+{
+  std::unordered_map<uint64_t, size_t> added;
+  for (size_t k = 0; k < pairs->size(); k++) {
+    const FunctionPair &pair = (*pairs)[k];
+    if (!pair.kOld && pair.kNew->anonymous) {
+      added.emplace(pair.kNew->address, k);
+    }
+  }
+  if (added.empty()) {
+    return;
+  }
+
+  std::vector<const Function *> partners(pairs->size(), nullptr);
+  std::vector<bool> taken(pairs->size(), false);
+  for (size_t k = 0; k < pairs->size(); k++) {
+    const FunctionPair &pair = (*pairs)[k];
+    if (pair.kNew || !pair.kOld->anonymous) {
+      continue;
+    }
+    const auto kAdded = added.find(pair.kOld->address);
+    if (kAdded != added.end()
+        && (*pairs)[kAdded->second].kNew->size == pair.kOld->size) {
+      partners[k] = (*pairs)[kAdded->second].kNew;
+      taken[kAdded->second] = true;
+    }
+  }
+  RebuildPairs(partners, taken, pairs);
+}
+
+// Returns the number of bytes that differ between the functions.
+static uint64_t CountChangedBytes(const Function &old_function,
+                                  const Function &new_function)
+{
+  const uint8_t *const a = old_function.data;
+  const uint8_t *const b = new_function.data;
+  const uint64_t kCommon
+      = std::min(old_function.data_size, new_function.data_size);
+  uint64_t changed
+      = std::max(old_function.data_size, new_function.data_size) - kCommon;
+  uint64_t i = FirstMismatch(a, b, kCommon);
+  while (i < kCommon) {
+    const uint64_t kRun = FirstMatch(a + i, b + i, kCommon - i);
+    changed += kRun;
+    i += kRun;
+    i += FirstMismatch(a + i, b + i, kCommon - i);
+  }
+  return changed;
+}
+
+// Returns true if the functions are of the same size and have the same
+// bytes.
+inline static bool SameBytes(const Function &old_function,
+                             const Function &new_function)
+{
+  return old_function.size == new_function.size
+      && old_function.data_size == new_function.data_size
+      && FirstMismatch(old_function.data, new_function.data,
+                       old_function.data_size) == old_function.data_size;
+}
+
+// Converts a diff kind into a string.
+inline static const char *FunctionDiffKindString(
+    const FunctionDiff::Kind kKind)
+{
+  switch (kKind) {
+    case FunctionDiff::Kind::kUnchanged: return "unchanged";
+    case FunctionDiff::Kind::kChanged: return "changed";
+    case FunctionDiff::Kind::kAdded: return "added";
+    case FunctionDiff::Kind::kRemoved: return "removed";
+    default: return "UNKNOWN";
+  }
+}
+
+} // namespace
+
+std::vector<FunctionDiff>
+DiffFunctions(const ElfBinary &old_elf, const ElfBinary &new_elf,
+              const NormalizedSections *const old_normalized,
+              const NormalizedSections *const new_normalized)
+{
+  // The code of relocatable objects refers to other functions and to
+  // data through relocations, whose fields hold only their addends, so
+  // it is decoded with its relocations normalized.
+  std::unique_ptr<const NormalizedSections> old_relocated;
+  std::unique_ptr<const NormalizedSections> new_relocated;
+  if (!old_normalized && old_elf.header()->kType == ET_REL) {
+    old_relocated.reset(new NormalizedSections(old_elf));
+  }
+  if (!new_normalized && new_elf.header()->kType == ET_REL) {
+    new_relocated.reset(new NormalizedSections(new_elf));
+  }
+  const std::vector<Function> kOldFunctions = CollectFunctions(
+      old_elf, old_normalized,
+      old_normalized ? old_normalized : old_relocated.get());
+  const std::vector<Function> kNewFunctions = CollectFunctions(
+      new_elf, new_normalized,
+      new_normalized ? new_normalized : new_relocated.get());
+
+  // The targets of the instructions of linked binaries are named
+  // through their symbols, PLT stubs and sections. Relocatable objects'
+  // are left to their relocations, and normalized x86-64 code already
+  // stands for its targets.
+  const uint16_t kMachine = old_elf.header()->kMachine;
+  const bool kDecode = kMachine == new_elf.header()->kMachine
+      && CanTokenizeInstructions(kMachine);
+  std::unique_ptr<const SymbolicTargets> old_targets;
+  std::unique_ptr<const SymbolicTargets> new_targets;
+  if (kDecode && old_elf.header()->kType != ET_REL
+      && !(old_normalized && kMachine == EM_X86_64)) {
+    old_targets.reset(new SymbolicTargets(old_elf));
+  }
+  if (kDecode && new_elf.header()->kType != ET_REL
+      && !(new_normalized && kMachine == EM_X86_64)) {
+    new_targets.reset(new SymbolicTargets(new_elf));
+  }
+
+  // Both lists are ordered by name, then by position, so pairing the
+  // k'th old function of a name with the k'th new one is a merge.
+  std::vector<FunctionPair> pairs;
+  size_t i = 0;
+  size_t j = 0;
+  while (i < kOldFunctions.size() || j < kNewFunctions.size()) {
+    int order = i == kOldFunctions.size() ? 1
+        : j == kNewFunctions.size() ? -1
+        : strcmp(kOldFunctions[i].name, kNewFunctions[j].name);
+    // Functions named after their address share nothing but where they
+    // lie, so unless their bytes are identical they are left alone, the
+    // old one first, to be paired by similarity (or PairAnonymousBySize).
+    if (!order && (kOldFunctions[i].anonymous || kNewFunctions[j].anonymous)
+        && !SameBytes(kOldFunctions[i], kNewFunctions[j])) {
+      order = -1;
+    }
+    pairs.push_back(FunctionPair{
+      order <= 0 ? &kOldFunctions[i++] : nullptr,
+      order >= 0 ? &kNewFunctions[j++] : nullptr,
+    });
+  }
+  PairBySimilarity(kMachine, kDecode, old_targets.get(), new_targets.get(),
+                   &pairs);
+  PairAnonymousBySize(&pairs);
+
+  // Functions vary widely in size, so threads claim small batches of
+  // pairs as they finish rather than a fixed share each.
+  std::vector<uint64_t> changed(pairs.size());
+  std::vector<uint64_t> edits(pairs.size());
+  ThreadPool::Default()->ParallelFor(
+      (pairs.size() + kPairGrain - 1) / kPairGrain,
+      [&](const size_t batch) {
+    std::vector<uint64_t> old_tokens;
+    std::vector<uint64_t> new_tokens;
+    const size_t kEnd = std::min(pairs.size(), (batch + 1) * kPairGrain);
+    for (size_t k = batch * kPairGrain; k < kEnd; k++) {
+      const Function *const kOld = pairs[k].kOld;
+      const Function *const kNew = pairs[k].kNew;
+      if (!kOld || !kNew) {
+        continue;
+      }
+      changed[k] = CountChangedBytes(*kOld, *kNew);
+      if (!kDecode) {
+        continue;
+      }
+      // Instructions are compared as tokens, each standing for a whole
+      // instruction with its displacement normalized, so the edit
+      // script is over far fewer, and more meaningful, elements.
+      old_tokens.clear();
+      new_tokens.clear();
+      TokenizeInstructions(kMachine, kOld->code, kOld->data_size,
+                           kOld->address, old_targets.get(), &old_tokens);
+      TokenizeInstructions(kMachine, kNew->code, kNew->data_size,
+                           kNew->address, new_targets.get(), &new_tokens);
+      edits[k] = EditDistance(old_tokens.data(), old_tokens.size(),
+                              new_tokens.data(), new_tokens.size(),
+                              kMaxEditWork);
+    }
+  });
+
+  std::vector<FunctionDiff> diffs;
+  diffs.reserve(pairs.size());
+  for (size_t k = 0; k < pairs.size(); k++) {
+    const Function *const kOld = pairs[k].kOld;
+    const Function *const kNew = pairs[k].kNew;
+    FunctionDiff::Kind kind = FunctionDiff::Kind::kChanged;
+    if (!kOld) {
+      kind = FunctionDiff::Kind::kAdded;
+    } else if (!kNew) {
+      kind = FunctionDiff::Kind::kRemoved;
+    } else if (!(kDecode ? edits[k] : changed[k])
+               && kOld->size == kNew->size) {
+      kind = FunctionDiff::Kind::kUnchanged;
+    }
+    const bool kRenamed = kOld && kNew && strcmp(kOld->name, kNew->name);
+    diffs.push_back(FunctionDiff{
+      kOld ? kOld->name : kNew->name,
+      kRenamed ? kNew->name : "",
+      kind,
+      kOld ? kOld->size : 0,
+      kNew ? kNew->size : 0,
+      changed[k],
+      kDecode,
+      edits[k],
+    });
+  }
+  return diffs;
+}
+
+std::string FunctionDiff::ToString() const
+{
+  std::stringstream res;
+  res << kName;
+  if (!kNewName.empty()) {
+    res << " -> " << kNewName;
+  }
+  res << ": " << FunctionDiffKindString(kKind);
+  switch (kKind) {
+    case Kind::kUnchanged:
+      res << ", " << kOldSize << " bytes";
+      break;
+    case Kind::kChanged:
+      res << ", " << kOldSize << " -> " << kNewSize << " bytes, "
+          << kChangedBytes << " bytes differ";
+      if (kDecoded) {
+        res << ", " << kChangedInstructions
+            << " instructions inserted or deleted";
+      }
+      break;
+    case Kind::kAdded:
+      res << ", " << kNewSize << " bytes";
+      break;
+    case Kind::kRemoved:
+      res << ", " << kOldSize << " bytes";
+      break;
+    default:
+      break;
+  }
+  return res.str();
+}
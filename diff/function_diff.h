@@ -0,0 +1,87 @@
+#ifndef BINARY_MATCHER_DIFF_FUNCTION_DIFF_H
+#define BINARY_MATCHER_DIFF_FUNCTION_DIFF_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class ElfBinary;
+class NormalizedSections;
+
+// Type representing the comparison of one function of a binary
+// against the identically named, or most similar, function of another.
+struct FunctionDiff {
+  // An enumeration of the possible outcomes of the comparison.
+  enum class Kind;
+
+  // The name of the function.
+  const std::string kName;
+  // The name of the function in the new binary, if it was paired by
+  // similarity with one of another name, and empty otherwise.
+  const std::string kNewName;
+  // The outcome of the comparison.
+  const Kind kKind;
+  // The size of the function in the old binary, or 0 if added.
+  const uint64_t kOldSize;
+  // The size of the function in the new binary, or 0 if removed.
+  const uint64_t kNewSize;
+  // The number of bytes of the function that differ. Bytes past the
+  // end of the shorter function count as changed.
+  const uint64_t kChangedBytes;
+  // True if the function's instructions were compared: if both
+  // binaries are of a machine whose instructions can be decoded (see
+  // CanTokenizeInstructions).
+  const bool kDecoded;
+  // The number of instructions deleted from the old function plus
+  // those inserted into the new by the shortest edit script between
+  // them (see EditDistance), if decoded, and 0 otherwise.
+  const uint64_t kChangedInstructions;
+
+  // Constructs a string representation of the function diff.
+  std::string ToString() const;
+};
+
+enum class FunctionDiff::Kind {
+  // The function's instructions, or if they were not decoded its
+  // bytes, are identical.
+  kUnchanged,
+  // The function exists in both binaries but its bytes differ.
+  kChanged,
+  // The function only exists in the new binary.
+  kAdded,
+  // The function only exists in the old binary.
+  kRemoved,
+};
+
+// Compares the functions (STT_FUNC symbols defined in a section) of
+// two ELF binaries, from .symtab or, if it was stripped, those
+// outlined by .eh_frame (see ElfBinary::frame_symbol_table), or
+// failing both, .dynsym.
+// Functions are paired by name; where several share a name they are
+// paired in the order they appear in each table. Functions outlined by
+// .eh_frame that are named only after their address are paired by name
+// only if their bytes are identical. Functions left unpaired, e.g.
+// because they were renamed or are compiler generated clones, or
+// changed if stripped, are then paired by the similarity of their
+// instructions (or bytes, if they cannot be decoded) as estimated by
+// MinHash (see MatchMinHashes). Functions named after their address
+// that are still unpaired are then paired by name if they are of the
+// same size. Each function's bytes are found from its value and size
+// through the section it is defined in; a function that lies outside
+// its section, or in one that occupies no space in the file, has no
+// bytes.
+// Pairs are compared in batches claimed by each thread of the default
+// thread pool in turn, so that a few large functions do not hold up
+// the rest. Returns the comparisons in order of (old) name.
+// Instructions stand for the targets they refer to (see
+// TokenizeInstructions), named in linked binaries through
+// SymbolicTargets and in relocatable objects through their
+// relocations, which are normalized to be decoded.
+// If the binaries' relocations were normalized, each function's bytes
+// are read from the normalized contents of its section instead.
+std::vector<FunctionDiff>
+DiffFunctions(const ElfBinary &old_elf, const ElfBinary &new_elf,
+              const NormalizedSections *const old_normalized = nullptr,
+              const NormalizedSections *const new_normalized = nullptr);
+
+#endif // BINARY_MATCHER_DIFF_FUNCTION_DIFF_H
@@ -0,0 +1,138 @@
+#include "diff/instruction_tokens.h"
+#include "diff/symbolic_targets.h"
+#include "instruction_decoder.h"
+
+#include <elf.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace {
+
+// The values that set apart the kinds of value standing for a
+// PC-relative field, so that, say, an offset within the function and
+// an unresolved displacement of the same value do not collide.
+const uint64_t kInvalid = 0x5bd1e9955bd1e995ULL;
+const uint64_t kInFunction = 1;
+const uint64_t kNamed = 2;
+const uint64_t kUnresolved = 3;
+const uint64_t kPage = 4;
+
+// Returns hash with value mixed into it.
+inline static uint64_t MixToken(const uint64_t hash, const uint64_t value)
+{
+  const uint64_t kMixed = (hash ^ value) * 0x100000001b3ULL;
+  return kMixed ^ (kMixed >> 32);
+}
+
+// Returns the value standing for a PC-relative field, holding
+// displacement, that refers to target, from the instructions of the
+// size bytes of the function at address. See TokenizeInstructions.
+static uint64_t ResolveTarget(const SymbolicTargets &targets,
+                              const uint64_t address, const uint64_t size,
+                              const uint64_t target,
+                              const int64_t displacement)
+{
+  if (target - address < size) {
+    return MixToken(kInFunction, target - address);
+  }
+  uint64_t token;
+  return targets.Resolve(target, &token)
+      ? MixToken(kNamed, token)
+      : MixToken(kUnresolved, static_cast<uint64_t>(displacement));
+}
+
+// Appends the tokens of x86-64 code. See TokenizeInstructions.
+static void TokenizeX86_64(const uint8_t *const code, const uint64_t size,
+                           const uint64_t address,
+                           const SymbolicTargets *const targets,
+                           std::vector<uint64_t> *const tokens)
+{
+  uint64_t i = 0;
+  while (i < size) {
+    const X86_64Instruction kInstruction
+        = DecodeX86_64Instruction(code + i, static_cast<size_t>(size - i));
+    if (!kInstruction.length) {
+      tokens->push_back(MixToken(kInvalid, code[i]));
+      i++;
+      continue;
+    }
+    const uint8_t *const kBytes = code + i;
+    const uint64_t kEnd = i + kInstruction.length;
+    uint64_t token = kInstruction.length;
+    for (uint8_t j = 0; j < kInstruction.length; j++) {
+      if (targets && j == kInstruction.relative_offset
+          && kInstruction.relative_size) {
+        const int64_t kDisplacement
+            = X86_64RelativeDisplacement(kBytes, kInstruction);
+        token = MixToken(token, ResolveTarget(
+            *targets, address, size,
+            address + kEnd + static_cast<uint64_t>(kDisplacement),
+            kDisplacement));
+        j = static_cast<uint8_t>(j + kInstruction.relative_size - 1);
+        continue;
+      }
+      token = MixToken(token, kBytes[j]);
+    }
+    tokens->push_back(token);
+    i = kEnd;
+  }
+}
+
+// Appends the tokens of AArch64 code. See TokenizeInstructions.
+static void TokenizeAArch64(const uint8_t *const code, const uint64_t size,
+                            const uint64_t address,
+                            const SymbolicTargets *const targets,
+                            std::vector<uint64_t> *const tokens)
+{
+  uint64_t i = 0;
+  for (; size - i >= kAArch64InstructionSize; i += kAArch64InstructionSize) {
+    // Instructions are little endian whatever the data encoding.
+    const uint32_t kInstruction = static_cast<uint32_t>(code[i])
+        | static_cast<uint32_t>(code[i + 1]) << 8
+        | static_cast<uint32_t>(code[i + 2]) << 16
+        | static_cast<uint32_t>(code[i + 3]) << 24;
+    const AArch64RelativeField kField = targets
+        ? DecodeAArch64RelativeField(kInstruction)
+        : AArch64RelativeField{0, 0, false};
+    uint64_t token = MixToken(kAArch64InstructionSize,
+                              kInstruction & ~kField.mask);
+    if (kField.mask) {
+      // Pages hold many symbols, so ADRP refers to none in particular.
+      token = MixToken(token, kField.page ? kPage : ResolveTarget(
+          *targets, address, size,
+          address + i + static_cast<uint64_t>(kField.offset),
+          kField.offset));
+    }
+    tokens->push_back(token);
+  }
+  for (; i < size; i++) {
+    tokens->push_back(MixToken(kInvalid, code[i]));
+  }
+}
+
+} // namespace
+
+bool CanTokenizeInstructions(const uint16_t machine)
+{
+  return machine == EM_X86_64 || machine == EM_AARCH64;
+}
+
+void TokenizeInstructions(const uint16_t machine,
+                          const uint8_t *const code,
+                          const uint64_t size,
+                          const uint64_t address,
+                          const SymbolicTargets *const targets,
+                          std::vector<uint64_t> *const tokens)
+{
+  switch (machine) {
+    case EM_X86_64:
+      TokenizeX86_64(code, size, address, targets, tokens);
+      break;
+    case EM_AARCH64:
+      TokenizeAArch64(code, size, address, targets, tokens);
+      break;
+    default:
+      break;
+  }
+}
@@ -0,0 +1,37 @@
+#ifndef BINARY_MATCHER_DIFF_INSTRUCTION_TOKENS_H
+#define BINARY_MATCHER_DIFF_INSTRUCTION_TOKENS_H
+
+#include <stdint.h>
+#include <vector>
+
+class SymbolicTargets;
+
+// Returns true if the instructions of the given machine (an ELF
+// header's kMachine) can be split by TokenizeInstructions: those of
+// EM_X86_64, decoded by length, and of EM_AARCH64, which are all 4
+// bytes.
+bool CanTokenizeInstructions(const uint16_t machine);
+
+// Splits the size bytes of code, which make up the function at
+// address, into the instructions of the given machine, which must be
+// one that CanTokenizeInstructions accepts, and appends a token
+// standing for each to tokens. A token is a hash of the instruction's
+// bytes with its PC-relative field, if any, replaced by a value
+// standing for the field's target: for a target within the function,
+// its offset from the function's start, and for any other, its name
+// as given by targets (see SymbolicTargets), or failing that the field
+// itself. Branches within the function, calls to the same function
+// and references to the same data thus give the same token wherever
+// the function and its targets lie. If targets is nullptr the field
+// is hashed as it is, e.g. for code whose fields were already
+// rewritten to stand for their targets (see NormalizedSections).
+// A byte that does not begin a valid instruction becomes a token of
+// its own.
+void TokenizeInstructions(const uint16_t machine,
+                          const uint8_t *const code,
+                          const uint64_t size,
+                          const uint64_t address,
+                          const SymbolicTargets *const targets,
+                          std::vector<uint64_t> *const tokens);
+
+#endif // BINARY_MATCHER_DIFF_INSTRUCTION_TOKENS_H
@@ -0,0 +1,150 @@
+#include "diff/instruction_tokens.h"
+#include "diff/symbolic_targets.h"
+#include "elf/elf_binary.h"
+#include "elf/elf_binary_symbol_table.h"
+#include "file.h"
+#include "test.h"
+
+#include <elf.h>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+using SymbolTable = ElfBinary::SymbolTable;
+
+namespace {
+
+// An address past every section of this program, from which its
+// functions are still within reach of a 32-bit displacement.
+const uint64_t kNowhere = 0x40000000;
+
+// Returns the tokens of the x86-64 code, which lies at address.
+static std::vector<uint64_t> Tokens(const std::vector<uint8_t> &code,
+                                    const uint64_t address,
+                                    const SymbolicTargets *const targets)
+{
+  std::vector<uint64_t> tokens;
+  TokenizeInstructions(EM_X86_64, code.data(), code.size(), address,
+                       targets, &tokens);
+  return tokens;
+}
+
+// Returns the bytes of a call, at address, to target.
+static std::vector<uint8_t> Call(const uint64_t address,
+                                 const uint64_t target)
+{
+  const uint32_t kField = static_cast<uint32_t>(target - (address + 5));
+  return std::vector<uint8_t>{
+    0xe8,
+    static_cast<uint8_t>(kField),
+    static_cast<uint8_t>(kField >> 8),
+    static_cast<uint8_t>(kField >> 16),
+    static_cast<uint8_t>(kField >> 24),
+  };
+}
+
+// Returns the address of the function of this program's .symtab with
+// the given name, or 0 if it has none.
+static uint64_t FunctionAddress(const ElfBinary &elf, const char *const name)
+{
+  const SymbolTable *const symtab = elf.symbol_table(".symtab");
+  for (size_t i = 0; i < symtab->size(); i++) {
+    if (ELF64_ST_TYPE(symtab->columns().infos[i]) == STT_FUNC
+        && symtab->columns().values[i] && !strcmp(symtab->name(i), name)) {
+      return symtab->columns().values[i];
+    }
+  }
+  return 0;
+}
+
+static void TestRawFields()
+{
+  // Fields are hashed as they are: the same bytes give the same tokens
+  // wherever they lie, and different fields different ones.
+  const std::vector<uint8_t> kCode{0x55, 0xe8, 0, 0, 0, 0, 0x5d, 0xc3};
+  const std::vector<uint64_t> kTokens = Tokens(kCode, 0x1000, nullptr);
+  EXPECT_EQ(kTokens.size(), 4U);
+  EXPECT(kTokens == Tokens(kCode, 0x2000, nullptr));
+  std::vector<uint8_t> other(kCode);
+  other[2] = 1;
+  const std::vector<uint64_t> kOtherTokens = Tokens(other, 0x1000, nullptr);
+  EXPECT_EQ(kOtherTokens.size(), 4U);
+  EXPECT(kOtherTokens != kTokens);
+  EXPECT_EQ(kOtherTokens[0], kTokens[0]);
+  EXPECT_EQ(kOtherTokens[2], kTokens[2]);
+}
+
+static void TestInvalidBytes()
+{
+  // push %es is invalid in 64-bit mode, and becomes a token of its own
+  // before the nop that follows.
+  const std::vector<uint64_t> kTokens = Tokens({0x06, 0x90}, 0, nullptr);
+  EXPECT_EQ(kTokens.size(), 2U);
+  EXPECT(Tokens({0x07, 0x90}, 0, nullptr) != kTokens);
+  EXPECT(Tokens({0x90}, 0, nullptr)[0] == kTokens[1]);
+  // A truncated call is an invalid byte, followed by what the rest
+  // decodes to.
+  EXPECT_EQ(Tokens({0xe8, 0x90, 0x90}, 0, nullptr).size(), 3U);
+}
+
+// Checks the tokens of fields resolved through the targets of this
+// program itself.
+static void TestResolvedFields()
+{
+  Result<File> file = File::Open("/proc/self/exe");
+  EXPECT(file.ok());
+  if (!file.ok()) {
+    return;
+  }
+  Result<ElfBinary> elf
+      = ElfBinary::ParseFile(std::unique_ptr<const File>(file.release()));
+  EXPECT(elf.ok());
+  if (!elf.ok()) {
+    return;
+  }
+  const uint64_t kMain = FunctionAddress(*elf.get(), "main");
+  const uint64_t kStart = FunctionAddress(*elf.get(), "_start");
+  if (!kMain || !kStart) {
+    fprintf(stderr, "skipping: this program has no .symtab\n");
+    return;
+  }
+  const SymbolicTargets kTargets(*elf.get());
+
+  // A branch within the function, a jmp to its own ret, stands for its
+  // offset from the function's start wherever the function lies.
+  const std::vector<uint8_t> kLoop{0x90, 0xeb, 0x00, 0xc3};
+  EXPECT(Tokens(kLoop, kNowhere, &kTargets)
+         == Tokens(kLoop, kNowhere + 0x1234, &kTargets));
+  EXPECT(Tokens(kLoop, kNowhere, &kTargets)
+         != Tokens({0x90, 0xeb, 0xfd, 0xc3}, kNowhere, &kTargets));
+
+  // A call to a function stands for the function, whatever its
+  // displacement.
+  EXPECT(Tokens(Call(kNowhere, kMain), kNowhere, &kTargets)
+         == Tokens(Call(kNowhere + 0x1000, kMain), kNowhere + 0x1000,
+                   &kTargets));
+  EXPECT(Tokens(Call(kNowhere, kMain), kNowhere, &kTargets)
+         != Tokens(Call(kNowhere, kStart), kNowhere, &kTargets));
+  EXPECT(Tokens(Call(kNowhere, kMain), kNowhere, &kTargets)
+         != Tokens(Call(kNowhere, kMain + 1), kNowhere, &kTargets));
+
+  // A call to an address in no section stands for its displacement.
+  EXPECT(Tokens(Call(kNowhere, kNowhere + 0x100), kNowhere, &kTargets)
+         == Tokens(Call(kNowhere + 8, kNowhere + 0x108), kNowhere + 8,
+                   &kTargets));
+  EXPECT(Tokens(Call(kNowhere, kNowhere + 0x100), kNowhere, &kTargets)
+         != Tokens(Call(kNowhere, kNowhere + 0x200), kNowhere, &kTargets));
+}
+
+} // namespace
+
+int main()
+{
+  RUN_TEST(TestRawFields);
+  RUN_TEST(TestInvalidBytes);
+  RUN_TEST(TestResolvedFields);
+  return TestStatus();
+}
@@ -0,0 +1,155 @@
+#include "diff/minhash.h"
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// The number of bands that signatures are cut into for indexing, and
+// the hashes in each. Signatures agreeing on a fraction s of their
+// hashes share some band with probability 1 - (1 - s^kRows)^kBands:
+// about 0.89 for s = 0.7 and 0.99 for s = 0.8, and about 0.06 for
+// s = 0.3.
+const size_t kBands = 8;
+const size_t kRows = kMinHashSize / kBands;
+
+// The most signatures sharing a band that are compared through it.
+const size_t kMaxBucket = 64;
+
+// Returns a well mixed hash of value (the splitmix64 finalizer).
+inline static uint64_t MixHash(uint64_t value)
+{
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+  return value ^ (value >> 31);
+}
+
+// Returns the key of the given band of signature.
+inline static uint64_t BandKey(const MinHashSignature &signature,
+                               const size_t band)
+{
+  uint64_t key = band;
+  for (size_t i = band * kRows; i < (band + 1) * kRows; i++) {
+    key = MixHash(key ^ signature[i]);
+  }
+  return key;
+}
+
+// Type representing a candidate pairing, before pairs are chosen.
+struct Candidate {
+  size_t old_position;
+  size_t new_position;
+  size_t agreement;
+};
+
+} // namespace
+
+bool ComputeMinHash(const uint64_t *const tokens, const size_t count,
+                    const size_t shingle_size,
+                    MinHashSignature *const signature)
+{
+  if (!shingle_size || count < shingle_size) {
+    return false;
+  }
+  signature->fill(UINT64_MAX);
+  for (size_t i = 0; i + shingle_size <= count; i++) {
+    uint64_t shingle = 0;
+    for (size_t j = i; j < i + shingle_size; j++) {
+      shingle = MixHash(shingle ^ tokens[j]);
+    }
+    // Each hash function is the mix of the shingle with its own seed.
+    for (size_t h = 0; h < kMinHashSize; h++) {
+      const uint64_t kHash
+          = MixHash(shingle + (h + 1) * 0x9e3779b97f4a7c15ULL);
+      (*signature)[h] = std::min((*signature)[h], kHash);
+    }
+  }
+  return true;
+}
+
+size_t MinHashAgreement(const MinHashSignature &a, const MinHashSignature &b)
+{
+  size_t agreement = 0;
+  for (size_t i = 0; i < kMinHashSize; i++) {
+    agreement += a[i] == b[i];
+  }
+  return agreement;
+}
+
+std::vector<MinHashMatch>
+MatchMinHashes(const std::vector<MinHashSignature> &old_signatures,
+               const std::vector<MinHashSignature> &new_signatures,
+               const size_t min_agreement)
+{
+  std::vector<std::unordered_map<uint64_t, std::vector<size_t>>> bands(
+      kBands);
+  for (size_t j = 0; j < new_signatures.size(); j++) {
+    for (size_t band = 0; band < kBands; band++) {
+      bands[band][BandKey(new_signatures[j], band)].push_back(j);
+    }
+  }
+
+  // A new signature may share several bands with an old one; it is
+  // only compared with it the first time.
+  std::vector<Candidate> candidates;
+  std::vector<size_t> compared(new_signatures.size(), SIZE_MAX);
+  for (size_t i = 0; i < old_signatures.size(); i++) {
+    for (size_t band = 0; band < kBands; band++) {
+      const auto kBucket = bands[band].find(
+          BandKey(old_signatures[i], band));
+      if (kBucket == bands[band].end()
+          || kBucket->second.size() > kMaxBucket) {
+        continue;
+      }
+      for (const size_t j : kBucket->second) {
+        if (compared[j] == i) {
+          continue;
+        }
+        compared[j] = i;
+        const size_t kAgreement
+            = MinHashAgreement(old_signatures[i], new_signatures[j]);
+        if (kAgreement >= min_agreement) {
+          candidates.push_back(Candidate{i, j, kAgreement});
+        }
+      }
+    }
+  }
+
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate &a, const Candidate &b) {
+    if (a.agreement != b.agreement) {
+      return a.agreement > b.agreement;
+    }
+    return a.old_position != b.old_position
+        ? a.old_position < b.old_position
+        : a.new_position < b.new_position;
+  });
+  std::vector<bool> old_paired(old_signatures.size(), false);
+  std::vector<bool> new_paired(new_signatures.size(), false);
+  std::vector<Candidate> chosen;
+  for (const Candidate &candidate : candidates) {
+    if (old_paired[candidate.old_position]
+        || new_paired[candidate.new_position]) {
+      continue;
+    }
+    old_paired[candidate.old_position] = true;
+    new_paired[candidate.new_position] = true;
+    chosen.push_back(candidate);
+  }
+
+  std::sort(chosen.begin(), chosen.end(),
+            [](const Candidate &a, const Candidate &b) {
+    return a.old_position < b.old_position;
+  });
+  std::vector<MinHashMatch> matches;
+  matches.reserve(chosen.size());
+  for (const Candidate &candidate : chosen) {
+    matches.push_back(MinHashMatch{candidate.old_position,
+                                   candidate.new_position,
+                                   candidate.agreement});
+  }
+  return matches;
+}
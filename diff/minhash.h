@@ -0,0 +1,53 @@
+#ifndef BINARY_MATCHER_DIFF_MINHASH_H
+#define BINARY_MATCHER_DIFF_MINHASH_H
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// The number of hashes in a MinHash signature.
+const size_t kMinHashSize = 32;
+
+// Type representing the MinHash signature of a set: for each of
+// kMinHashSize hash functions, the least hash of any of its elements.
+// The fraction of the hashes on which two signatures agree estimates
+// the Jaccard similarity of their sets.
+using MinHashSignature = std::array<uint64_t, kMinHashSize>;
+
+// Type representing a pairing of an old signature with a new one.
+struct MinHashMatch {
+  // The position of the old signature.
+  const size_t kOld;
+  // The position of the new signature.
+  const size_t kNew;
+  // The number of hashes on which the signatures agree.
+  const size_t kAgreement;
+};
+
+// Computes into signature the MinHash signature of the shingles of the
+// count tokens at tokens: the runs of shingle_size consecutive tokens.
+// Returns false, leaving signature as it was, if there are fewer
+// tokens than make a shingle.
+bool ComputeMinHash(const uint64_t *const tokens, const size_t count,
+                    const size_t shingle_size,
+                    MinHashSignature *const signature);
+
+// Returns the number of hashes on which the signatures agree.
+size_t MinHashAgreement(const MinHashSignature &a, const MinHashSignature &b);
+
+// Pairs old signatures with new ones that agree on at least
+// min_agreement hashes, each at most once, taking the pairs that agree
+// most first. Candidates are found by locality-sensitive hashing
+// rather than by comparing every pair: the signatures are cut into
+// bands, and only signatures that are identical in some band are
+// compared, so that the work is roughly linear in their number.
+// Bands shared by very many signatures (e.g. of tiny, identical
+// functions) are too ambiguous to pair by, and are skipped.
+// Returns the pairs in order of old position.
+std::vector<MinHashMatch>
+MatchMinHashes(const std::vector<MinHashSignature> &old_signatures,
+               const std::vector<MinHashSignature> &new_signatures,
+               const size_t min_agreement);
+
+#endif // BINARY_MATCHER_DIFF_MINHASH_H
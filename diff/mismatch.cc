@@ -0,0 +1,96 @@
+#include "diff/mismatch.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Compares the buffers a machine word at a time, returning
+// the index of the first differing byte or size.
+inline static size_t
+FirstMismatchWords(const uint8_t *const a, const uint8_t *const b,
+                   size_t i, const size_t size)
+{
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t wa, wb;
+    memcpy(&wa, a + i, sizeof(wa));
+    memcpy(&wb, b + i, sizeof(wb));
+    if (wa != wb) {
+      break;
+    }
+  }
+  for (; i < size; i++) {
+    if (a[i] != b[i]) {
+      return i;
+    }
+  }
+  return size;
+}
+
+} // namespace
+
+size_t FirstMismatch(const uint8_t *const a, const uint8_t *const b,
+                     const size_t size)
+{
+  size_t i = 0;
+#if defined(__AVX2__)
+  // Compare 64 bytes per iteration, only locating the exact
+  // byte once some lane has differed.
+  for (; i + 64 <= size; i += 64) {
+    const __m256i lo = _mm256_cmpeq_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+    const __m256i hi = _mm256_cmpeq_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + 32)),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i + 32)));
+    const uint32_t lo_mask = static_cast<uint32_t>(_mm256_movemask_epi8(lo));
+    const uint32_t hi_mask = static_cast<uint32_t>(_mm256_movemask_epi8(hi));
+    if ((lo_mask & hi_mask) != 0xFFFFFFFFU) {
+      if (lo_mask != 0xFFFFFFFFU) {
+        return i + static_cast<size_t>(__builtin_ctz(~lo_mask));
+      }
+      return i + 32 + static_cast<size_t>(__builtin_ctz(~hi_mask));
+    }
+  }
+#elif defined(__SSE2__)
+  // Compare 64 bytes per iteration, only locating the exact
+  // byte once some lane has differed.
+  for (; i + 64 <= size; i += 64) {
+    uint32_t masks[4];
+    for (unsigned j = 0; j < 4; j++) {
+      const __m128i eq = _mm_cmpeq_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 16*j)),
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 16*j)));
+      masks[j] = static_cast<uint32_t>(_mm_movemask_epi8(eq));
+    }
+    if ((masks[0] & masks[1] & masks[2] & masks[3]) != 0xFFFFU) {
+      for (unsigned j = 0; j < 4; j++) {
+        if (masks[j] != 0xFFFFU) {
+          return i + 16*j
+              + static_cast<size_t>(__builtin_ctz(~masks[j] & 0xFFFFU));
+        }
+      }
+    }
+  }
+#endif
+  return FirstMismatchWords(a, b, i, size);
+}
+
+size_t FirstMatch(const uint8_t *const a, const uint8_t *const b,
+                  const size_t size)
+{
+  // Differing runs are short in practice, so a byte loop suffices.
+  for (size_t i = 0; i < size; i++) {
+    if (a[i] == b[i]) {
+      return i;
+    }
+  }
+  return size;
+}
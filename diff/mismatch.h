@@ -0,0 +1,20 @@
+#ifndef BINARY_MATCHER_DIFF_MISMATCH_H
+#define BINARY_MATCHER_DIFF_MISMATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Returns the index of the first byte at which the two buffers
+// differ, or size if the first size bytes of both are identical.
+// Compares a vector register's worth of bytes per step where the
+// target supports it, so scanning identical data runs at close to
+// memory bandwidth.
+size_t FirstMismatch(const uint8_t *const a, const uint8_t *const b,
+                     const size_t size);
+
+// Returns the index of the first byte at which the two buffers
+// agree, or size if every one of the first size bytes differs.
+size_t FirstMatch(const uint8_t *const a, const uint8_t *const b,
+                  const size_t size);
+
+#endif // BINARY_MATCHER_DIFF_MISMATCH_H
@@ -0,0 +1,277 @@
+#include "diff/normalize.h"
+#include "diff/symbolic_targets.h"
+#include "elf/elf_binary.h"
+#include "elf/elf_binary_field.h"
+#include "elf/elf_binary_header.h"
+#include "elf/elf_binary_name_index.h"
+#include "elf/elf_binary_relocation.h"
+#include "elf/elf_binary_section_header.h"
+#include "elf/elf_binary_symbol_table.h"
+#include "instruction_decoder.h"
+
+#include <algorithm>
+#include <elf.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+using NameIndex = ElfBinary::NameIndex;
+using Relocation = ElfBinary::Relocation;
+using SectionHeader = ElfBinary::SectionHeader;
+using SymbolTable = ElfBinary::SymbolTable;
+
+namespace {
+
+// The position returned by lookups that find no section.
+const size_t kNoSection = SIZE_MAX;
+
+// Returns the symbol table that the given relocation section links
+// to, or nullptr if it links to none.
+inline static const SymbolTable *
+LinkedSymbolTable(const ElfBinary &elf, const SectionHeader &relocations)
+{
+  const ArenaVector<SectionHeader> &sections = elf.section_headers();
+  if (relocations.kLink >= sections.size()) {
+    return nullptr;
+  }
+  switch (sections[relocations.kLink].kType) {
+    case SHT_SYMTAB: return elf.symbol_table(".symtab");
+    case SHT_DYNSYM: return elf.symbol_table(".dynsym");
+    default: return nullptr;
+  }
+}
+
+// Returns the name of the target of relocation, in the symbol table
+// table: the name of its symbol or, for a section symbol, which has
+// none, that of its section. Returns "" if it has no symbol.
+static const char *TargetName(const ElfBinary &elf,
+                              const SymbolTable *const table,
+                              const Relocation &relocation)
+{
+  if (!table || !relocation.kSymbol || relocation.kSymbol >= table->size()) {
+    return "";
+  }
+  const SymbolTable::Columns &columns = table->columns();
+  const ArenaVector<SectionHeader> &sections = elf.section_headers();
+  const size_t kSymbol = relocation.kSymbol;
+  const uint16_t kSection = columns.section_header_indices[kSymbol];
+  if (ELF64_ST_TYPE(columns.infos[kSymbol]) == STT_SECTION
+      && kSection < sections.size()) {
+    return sections[kSection].kStringName;
+  }
+  return table->name(kSymbol);
+}
+
+// Returns the token that stands for a relocation of the given type
+// to the target of the given name.
+inline static uint64_t RelocationToken(const char *const target,
+                                       const uint32_t type)
+{
+  const uint64_t kHash
+      = NameIndex::Hash(target) ^ (type * 0x9e3779b97f4a7c15ULL);
+  return kHash ^ (kHash >> 29);
+}
+
+// Returns the addend of relocation, which patches the width bytes at
+// place: an SHT_RELA section's carries its own, and an SHT_REL
+// section's is held at the place, in the given data encoding.
+inline static uint64_t RelocationAddend(const Relocation &relocation,
+                                        const SectionHeader &section,
+                                        const uint8_t *const place,
+                                        const uint64_t width,
+                                        const uint8_t data_encoding)
+{
+  if (section.kType == SHT_RELA) {
+    return static_cast<uint64_t>(relocation.kAddend);
+  }
+  uint64_t addend = 0;
+  for (uint64_t i = 0; i < width && i < 8; i++) {
+    const uint64_t kByte = data_encoding == ELFDATA2MSB
+        ? place[i] : place[width - 1 - i];
+    addend = addend << 8 | kByte;
+  }
+  return addend;
+}
+
+// Returns the token that stands for a relocation of the given type
+// that has no symbol, and patches in the address addend, named as
+// targets names it, or the addend itself if it lies in no section.
+inline static uint64_t AddressToken(const SymbolicTargets &targets,
+                                    const uint64_t addend,
+                                    const uint32_t type)
+{
+  uint64_t target;
+  if (!targets.Resolve(addend, &target)) {
+    target = addend;
+  }
+  const uint64_t kHash = target ^ (type * 0x9e3779b97f4a7c15ULL);
+  return kHash ^ (kHash >> 29);
+}
+
+// Writes the width bytes at place with token, repeated as needed, so
+// that the rewritten bytes do not depend on the host's byte order.
+inline static void WriteToken(const uint64_t token, uint8_t *const place,
+                              const uint64_t width)
+{
+  for (uint64_t i = 0; i < width; i++) {
+    place[i] = static_cast<uint8_t>(token >> (8 * (i % 8)));
+  }
+}
+
+// Returns the number of the section whose contents hold address, from
+// by_address, the numbers of the sections that occupy space in both
+// memory and the file ordered by address, or kNoSection if none do.
+static size_t FindSectionByAddress(const ArenaVector<SectionHeader> &sections,
+                                   const std::vector<size_t> &by_address,
+                                   const uint64_t address)
+{
+  const auto kAfter = std::upper_bound(
+      by_address.begin(), by_address.end(), address,
+      [&sections](const uint64_t kAddress, const size_t i) {
+    return kAddress < sections[i].kAddress;
+  });
+  if (kAfter == by_address.begin()) {
+    return kNoSection;
+  }
+  const SectionHeader &section = sections[*(kAfter - 1)];
+  return address - section.kAddress < section.kSize
+      ? *(kAfter - 1) : kNoSection;
+}
+
+} // namespace
+
+NormalizedSections::NormalizedSections(const ElfBinary &elf)
+  : elf_(&elf), contents_(elf.section_headers().size())
+{
+  const ArenaVector<SectionHeader> &sections = elf.section_headers();
+  const uint16_t kMachine = elf.header()->kMachine;
+  const bool kRelocatable = elf.header()->kType == ET_REL;
+
+  // Dynamic relocations name only the address they patch.
+  std::vector<size_t> by_address;
+  for (size_t i = 0; i < sections.size(); i++) {
+    if ((sections[i].kFlags & SHF_ALLOC) && sections[i].kType != SHT_NOBITS
+        && sections[i].kSize) {
+      by_address.push_back(i);
+    }
+  }
+  std::stable_sort(by_address.begin(), by_address.end(),
+                   [&sections](const size_t a, const size_t b) {
+    return sections[a].kAddress < sections[b].kAddress;
+  });
+
+  const SymbolicTargets kTargets(elf);
+  if (!kRelocatable && kMachine == EM_X86_64) {
+    RewriteCodeReferences(kTargets);
+  }
+
+  for (size_t r = 0; r < sections.size(); r++) {
+    const ArenaVector<Relocation> &relocations = elf.relocations(r);
+    if (relocations.empty()) {
+      continue;
+    }
+    // A relocation section that names the section it applies to
+    // patches only that one.
+    const SectionHeader &relocation_section = sections[r];
+    const bool kApplies = relocation_section.kInfo
+        && relocation_section.kInfo < sections.size()
+        && (kRelocatable || (relocation_section.kFlags & SHF_INFO_LINK));
+    const SymbolTable *const table
+        = LinkedSymbolTable(elf, relocation_section);
+    for (const Relocation &relocation : relocations) {
+      const uint64_t kWidth = ElfRelocationWidth(kMachine, relocation.kType);
+      const size_t kTarget = !kWidth ? kNoSection
+          : kApplies ? relocation_section.kInfo
+          : FindSectionByAddress(sections, by_address, relocation.kOffset);
+      if (kTarget == kNoSection
+          || relocation.kOffset < sections[kTarget].kAddress) {
+        continue;
+      }
+      const uint64_t kPlace = relocation.kOffset - sections[kTarget].kAddress;
+      uint64_t size;
+      const uint8_t *const kData = elf.SectionContents(kTarget, &size);
+      if (!ElfRangeInBounds(kPlace, kWidth, size)) {
+        continue;
+      }
+      // A relocation with no symbol, such as R_*_RELATIVE, patches in
+      // its addend, which is an address in a linked binary.
+      const uint64_t kToken = relocation.kSymbol || kRelocatable
+          ? RelocationToken(TargetName(elf, table, relocation),
+                            relocation.kType)
+          : AddressToken(kTargets,
+                         RelocationAddend(relocation, relocation_section,
+                                          kData + kPlace, kWidth,
+                                          elf.header()->kData),
+                         relocation.kType);
+      WriteToken(kToken, MutableContents(kTarget) + kPlace, kWidth);
+    }
+  }
+}
+
+NormalizedSections::~NormalizedSections() { }
+
+uint8_t *NormalizedSections::MutableContents(const size_t i)
+{
+  std::vector<uint8_t> &contents = contents_[i];
+  if (contents.empty()) {
+    uint64_t size;
+    const uint8_t *const kData = elf_->SectionContents(i, &size);
+    contents.assign(kData, kData + size);
+  }
+  return contents.data();
+}
+
+void NormalizedSections::RewriteCodeReferences(
+    const SymbolicTargets &targets)
+{
+  const ArenaVector<SectionHeader> &sections = elf_->section_headers();
+  for (size_t i = 0; i < sections.size(); i++) {
+    const SectionHeader &section = sections[i];
+    if (section.kType != SHT_PROGBITS
+        || (section.kFlags & (SHF_ALLOC | SHF_EXECINSTR))
+           != (SHF_ALLOC | SHF_EXECINSTR)) {
+      continue;
+    }
+    // The code is decoded from the file, as rewriting it changes
+    // neither the length of an instruction nor where its field lies.
+    uint64_t size;
+    const uint8_t *const kCode = elf_->SectionContents(i, &size);
+    uint64_t j = 0;
+    while (j < size) {
+      const X86_64Instruction kInstruction = DecodeX86_64Instruction(
+          kCode + j, static_cast<size_t>(size - j));
+      if (!kInstruction.length) {
+        j++;
+        continue;
+      }
+      // Short branches stay within their function, so only fields
+      // wide enough to reach other code and data are rewritten.
+      const uint64_t kEnd = j + kInstruction.length;
+      uint64_t token;
+      if (kInstruction.relative_size == 4
+          && targets.Resolve(section.kAddress + kEnd + static_cast<uint64_t>(
+                                 X86_64RelativeDisplacement(kCode + j,
+                                                            kInstruction)),
+                             &token)) {
+        WriteToken(token, MutableContents(i) + j
+                          + kInstruction.relative_offset, 4);
+      }
+      j = kEnd;
+    }
+  }
+}
+
+const uint8_t *NormalizedSections::Contents(const size_t i,
+                                            uint64_t *const size) const
+{
+  if (contents_[i].empty()) {
+    return elf_->SectionContents(i, size);
+  }
+  *size = contents_[i].size();
+  return contents_[i].data();
+}
+
+bool NormalizedSections::rewritten(const size_t i) const
+{
+  return !contents_[i].empty();
+}
@@ -0,0 +1,69 @@
+#ifndef BINARY_MATCHER_DIFF_NORMALIZE_H
+#define BINARY_MATCHER_DIFF_NORMALIZE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class ElfBinary;
+class SymbolicTargets;
+
+// Type holding the contents of the sections of an ELF binary with each
+// place that a relocation patches rewritten to stand for the target of
+// the relocation rather than its address: a token derived from the
+// relocation's type and the name of its symbol (or, for a section
+// symbol, of its section), ignoring the addend. Two binaries whose
+// code refers to the same targets at the same places then compare
+// equal there, however far the targets moved, so that one function
+// growing does not change every later call and reference.
+// Places are found through every SHT_REL and SHT_RELA section: a
+// relocatable object's, which patch the sections they apply to, and a
+// linked binary's dynamic relocations, which patch the GOT, the PLT's
+// slots and pointers in data. A dynamic relocation with no symbol,
+// such as R_X86_64_RELATIVE, stands for the address it patches in, as
+// SymbolicTargets names it. Only relocations of the machines known to
+// ElfRelocationWidth are rewritten.
+// The code of a linked binary carries no relocations unless it was
+// linked with --emit-relocs, so for x86-64 the 32-bit relative field
+// of each instruction of its executable sections (a call, a jump or a
+// RIP-relative operand) is rewritten to stand for its target as
+// SymbolicTargets names it, including calls through PLT stubs and
+// loads from GOT slots, which are named after the symbols bound there.
+// Instructions are decoded linearly from the start of each section.
+class NormalizedSections {
+public:
+  // Finds the places patched by the relocations of elf and rewrites a
+  // copy of each section holding any of them. Sections holding none
+  // are left in place in the file.
+  explicit NormalizedSections(const ElfBinary &elf);
+
+  NormalizedSections(const NormalizedSections&) = delete;
+  NormalizedSections &operator=(const NormalizedSections&) = delete;
+
+  ~NormalizedSections();
+
+  // Returns the contents of the i'th section, rewritten if any place in
+  // it was, storing their size in *size. Sections are treated as
+  // ElfBinary::SectionContents treats them.
+  const uint8_t *Contents(const size_t i, uint64_t *const size) const;
+
+  // Returns true if any place in the i'th section was rewritten.
+  bool rewritten(const size_t i) const;
+
+private:
+  // Returns the rewritten contents of the i'th section, copying them
+  // from the file first if nothing in it was rewritten yet.
+  uint8_t *MutableContents(const size_t i);
+
+  // Rewrites the relative fields of the x86-64 code of the binary to
+  // stand for their targets, as named by targets.
+  void RewriteCodeReferences(const SymbolicTargets &targets);
+
+  // The binary whose sections are held.
+  const ElfBinary *elf_;
+  // The rewritten contents of each section, or an empty vector for a
+  // section that holds no place to rewrite.
+  std::vector<std::vector<uint8_t>> contents_;
+};
+
+#endif // BINARY_MATCHER_DIFF_NORMALIZE_H
@@ -0,0 +1,263 @@
+#include "diff/symbolic_targets.h"
+#include "elf/elf_binary.h"
+#include "elf/elf_binary_header.h"
+#include "elf/elf_binary_name_index.h"
+#include "elf/elf_binary_relocation.h"
+#include "elf/elf_binary_section_header.h"
+#include "elf/elf_binary_symbol_table.h"
+#include "instruction_decoder.h"
+
+#include <algorithm>
+#include <elf.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+using NameIndex = ElfBinary::NameIndex;
+using Relocation = ElfBinary::Relocation;
+using SectionHeader = ElfBinary::SectionHeader;
+using SymbolTable = ElfBinary::SymbolTable;
+
+namespace {
+
+// The values that set apart the kinds of name that an address is
+// given, so that, say, a PLT stub and a symbol of the same name do not
+// give the same token.
+const uint64_t kStubName = 1;
+const uint64_t kSlotName = 2;
+const uint64_t kSymbolName = 3;
+const uint64_t kSectionName = 4;
+const uint64_t kContentsName = 5;
+const uint64_t kAnonymousName = 6;
+
+// The size of a PLT stub in sections that do not record one.
+const uint64_t kDefaultStubSize = 16;
+
+// The most bytes of a string in read-only data that name it.
+const uint64_t kMaxStringName = 64;
+
+// The bytes of other read-only data that name it, e.g. a floating
+// point constant.
+const uint64_t kConstantName = 8;
+
+// Returns hash with value mixed into it.
+inline static uint64_t MixToken(const uint64_t hash, const uint64_t value)
+{
+  const uint64_t kMixed = (hash ^ value) * 0x100000001b3ULL;
+  return kMixed ^ (kMixed >> 32);
+}
+
+// Returns true if relocations of the given type, on the given machine,
+// fill a GOT slot with the address of their symbol for the dynamic
+// loader: R_*_GLOB_DAT for data and R_*_JUMP_SLOT for the PLT.
+inline static bool FillsSlot(const uint16_t machine, const uint32_t type)
+{
+  switch (machine) {
+    case EM_X86_64:
+      return type == R_X86_64_GLOB_DAT || type == R_X86_64_JUMP_SLOT;
+    case EM_386:
+      return type == R_386_GLOB_DAT || type == R_386_JMP_SLOT;
+    case EM_AARCH64:
+      return type == R_AARCH64_GLOB_DAT || type == R_AARCH64_JUMP_SLOT;
+    default:
+      return false;
+  }
+}
+
+// Returns true if byte may be part of a string: it is printable, part
+// of a UTF-8 sequence, or whitespace.
+inline static bool IsStringByte(const uint8_t byte)
+{
+  return (byte >= 0x20 && byte != 0x7f) || (byte >= '\t' && byte <= '\r');
+}
+
+// Returns a hash of the size bytes at data naming them by what they
+// hold: the string they begin with, up to its terminating NUL or
+// kMaxStringName bytes, or else their first kConstantName bytes.
+static uint64_t ContentsName(const uint8_t *const data, const uint64_t size)
+{
+  uint64_t length = 0;
+  while (length < size && length < kMaxStringName
+         && IsStringByte(data[length])) {
+    length++;
+  }
+  if (!length || (length < size && length < kMaxStringName
+                  && data[length])) {
+    length = std::min(size, kConstantName);
+  }
+  uint64_t name = MixToken(kContentsName, length);
+  for (uint64_t i = 0; i < length; i++) {
+    name = MixToken(name, data[i]);
+  }
+  return name;
+}
+
+} // namespace
+
+SymbolicTargets::SymbolicTargets(const ElfBinary &elf)
+  : elf_(&elf), symbols_(nullptr), frames_(nullptr), sections_(), slots_(),
+    stubs_()
+{
+  if (elf.header()->kType == ET_REL) {
+    return;
+  }
+  const SymbolTable *const symtab = elf.symbol_table(".symtab");
+  if (strcmp(symtab->type(), "N/A")) {
+    symbols_ = symtab;
+  } else {
+    symbols_ = elf.symbol_table(".dynsym");
+    frames_ = elf.frame_symbol_table();
+  }
+
+  const ArenaVector<SectionHeader> &sections = elf.section_headers();
+  for (size_t i = 0; i < sections.size(); i++) {
+    if ((sections[i].kFlags & SHF_ALLOC) && sections[i].kSize) {
+      sections_.push_back(i);
+    }
+  }
+  std::stable_sort(sections_.begin(), sections_.end(),
+                   [&sections](const size_t a, const size_t b) {
+    return sections[a].kAddress < sections[b].kAddress;
+  });
+
+  // Dynamic relocations name symbols of .dynsym.
+  const uint16_t kMachine = elf.header()->kMachine;
+  const SymbolTable *const dynsym = elf.symbol_table(".dynsym");
+  for (size_t r = 0; r < sections.size(); r++) {
+    for (const Relocation &relocation : elf.relocations(r)) {
+      if (FillsSlot(kMachine, relocation.kType) && relocation.kSymbol
+          && relocation.kSymbol < dynsym->size()) {
+        slots_[relocation.kOffset] = dynsym->name(relocation.kSymbol);
+      }
+    }
+  }
+  if (kMachine != EM_X86_64 || slots_.empty()) {
+    return;
+  }
+
+  // Each stub of .plt, .plt.sec and .plt.got jumps through its slot;
+  // .plt's first stub, which calls the dynamic loader, through none.
+  for (size_t i = 0; i < sections.size(); i++) {
+    const SectionHeader &section = sections[i];
+    if (!(section.kFlags & SHF_EXECINSTR)
+        || strncmp(section.kStringName, ".plt", 4)) {
+      continue;
+    }
+    uint64_t size;
+    const uint8_t *const kCode = elf.SectionContents(i, &size);
+    const uint64_t kStubSize
+        = section.kEntrySize ? section.kEntrySize : kDefaultStubSize;
+    for (uint64_t stub = 0; stub < size; stub += kStubSize) {
+      const uint64_t kEnd = std::min(size, stub + kStubSize);
+      uint64_t j = stub;
+      while (j < kEnd) {
+        const X86_64Instruction kInstruction = DecodeX86_64Instruction(
+            kCode + j, static_cast<size_t>(kEnd - j));
+        if (!kInstruction.length) {
+          break;
+        }
+        j += kInstruction.length;
+        if (kInstruction.relative_size != 4) {
+          continue;
+        }
+        const uint64_t kTarget = section.kAddress + j + static_cast<uint64_t>(
+            X86_64RelativeDisplacement(kCode + j - kInstruction.length,
+                                       kInstruction));
+        const auto kSlot = slots_.find(kTarget);
+        if (kSlot != slots_.end()) {
+          stubs_[section.kAddress + stub] = kSlot->second;
+          break;
+        }
+      }
+    }
+  }
+}
+
+SymbolicTargets::~SymbolicTargets() { }
+
+bool SymbolicTargets::Resolve(const uint64_t address,
+                              uint64_t *const token) const
+{
+  const auto kStub = stubs_.find(address);
+  if (kStub != stubs_.end()) {
+    *token = MixToken(kStubName, NameIndex::Hash(kStub->second));
+    return true;
+  }
+  const auto kSlot = slots_.find(address);
+  if (kSlot != slots_.end()) {
+    *token = MixToken(kSlotName, NameIndex::Hash(kSlot->second));
+    return true;
+  }
+
+  const SymbolTable::Columns *const columns
+      = symbols_ ? &symbols_->columns() : nullptr;
+  if (symbols_) {
+    const size_t kSymbol = symbols_->FindSymbolContaining(address);
+    if (kSymbol != SymbolTable::kNoSymbol) {
+      *token = MixToken(MixToken(kSymbolName,
+                                 NameIndex::Hash(symbols_->name(kSymbol))),
+                        address - columns->values[kSymbol]);
+      return true;
+    }
+  }
+
+  // The functions of stripped binaries that .dynsym does not name are
+  // named after their address, which differs wherever code moved, so
+  // only the offset into them is kept.
+  if (frames_) {
+    const size_t kFunction = frames_->FindSymbolContaining(address);
+    if (kFunction != SymbolTable::kNoSymbol) {
+      const char *const kName = frames_->name(kFunction);
+      *token = MixToken(strncmp(kName, "sub_", 4)
+                            ? MixToken(kSymbolName, NameIndex::Hash(kName))
+                            : kAnonymousName,
+                        address - frames_->columns().values[kFunction]);
+      return true;
+    }
+  }
+
+  // Find the last section starting at or before address, and check
+  // that it extends past it.
+  const ArenaVector<SectionHeader> &sections = elf_->section_headers();
+  const auto kAfter = std::upper_bound(
+      sections_.begin(), sections_.end(), address,
+      [&sections](const uint64_t kAddress, const size_t i) {
+    return kAddress < sections[i].kAddress;
+  });
+  if (kAfter == sections_.begin()) {
+    return false;
+  }
+  const size_t kSection = *(kAfter - 1);
+  const SectionHeader &section = sections[kSection];
+  if (address - section.kAddress >= section.kSize) {
+    return false;
+  }
+  // Literals, e.g. strings and floating point constants, have no
+  // symbol, so they are named by what they hold, wherever it lies.
+  uint64_t size;
+  const uint8_t *const kData = elf_->SectionContents(kSection, &size);
+  if (section.kType == SHT_PROGBITS
+      && !(section.kFlags & (SHF_WRITE | SHF_EXECINSTR))
+      && address - section.kAddress < size) {
+    *token = MixToken(NameIndex::Hash(section.kStringName),
+                      ContentsName(kData + (address - section.kAddress),
+                                   size - (address - section.kAddress)));
+    return true;
+  }
+  uint64_t name = MixToken(kSectionName,
+                           NameIndex::Hash(section.kStringName));
+  uint64_t base = section.kAddress;
+  if (symbols_) {
+    const size_t kSymbol = symbols_->FindSymbolAtOrBefore(address);
+    if (kSymbol != SymbolTable::kNoSymbol
+        && columns->section_header_indices[kSymbol] == kSection
+        && columns->values[kSymbol] >= section.kAddress) {
+      name = MixToken(name, NameIndex::Hash(symbols_->name(kSymbol)));
+      base = columns->values[kSymbol];
+    }
+  }
+  *token = MixToken(name, address - base);
+  return true;
+}
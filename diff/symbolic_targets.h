@@ -0,0 +1,67 @@
+#ifndef BINARY_MATCHER_DIFF_SYMBOLIC_TARGETS_H
+#define BINARY_MATCHER_DIFF_SYMBOLIC_TARGETS_H
+
+#include "elf/elf_binary.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+// Type that names the addresses that a linked ELF binary's code and
+// data refer to, so that references to the same place compare equal
+// however far it moved. An address is named, in order of preference:
+// - for the start of a PLT stub, by the function the stub calls
+//   through the GOT, and for a GOT slot, by the symbol the dynamic
+//   loader fills it with (found through their R_*_JUMP_SLOT and
+//   R_*_GLOB_DAT relocations);
+// - by the symbol containing it and its offset into the symbol;
+// - in a stripped binary, by the function outlined by .eh_frame that
+//   contains it (see ElfBinary::frame_symbol_table) and its offset
+//   into the function, leaving out the names made of addresses;
+// - for read-only data, by the section holding it and what it holds
+//   there: the string starting at it, or its first 8 bytes, so that
+//   literals, which have no symbols, are named however they were laid
+//   out;
+// - by the section holding it, the last symbol starting at or before
+//   it in that section, if any, and its offset from that symbol (or
+//   from the start of the section).
+// Symbols are those of .symtab, or, if it was stripped, of .dynsym.
+// PLT stubs are only recognised in x86-64 binaries, whose stubs each
+// jump through their slot with a single RIP-relative instruction.
+// Addresses in relocatable objects are offsets into sections that all
+// start at 0, so none are named.
+class SymbolicTargets {
+public:
+  // Finds the PLT stubs, GOT slots, symbols and sections of elf.
+  explicit SymbolicTargets(const ElfBinary &elf);
+
+  SymbolicTargets(const SymbolicTargets&) = delete;
+  SymbolicTargets &operator=(const SymbolicTargets&) = delete;
+
+  ~SymbolicTargets();
+
+  // Stores a token naming address in *token, derived from the names
+  // and offset described above, and returns true, or returns false if
+  // address lies in no section that occupies memory.
+  bool Resolve(const uint64_t address, uint64_t *const token) const;
+
+private:
+  // The binary whose addresses are named.
+  const ElfBinary *elf_;
+  // The symbols that addresses are named after, or nullptr.
+  const ElfBinary::SymbolTable *symbols_;
+  // The functions outlined by .eh_frame, if .symtab was stripped, or
+  // nullptr.
+  const ElfBinary::SymbolTable *frames_;
+  // The numbers of the sections that occupy memory, ordered by address.
+  std::vector<size_t> sections_;
+  // The names of the symbols that the dynamic loader binds each GOT
+  // slot to, by the slot's address.
+  std::unordered_map<uint64_t, const char*> slots_;
+  // The names of the functions that each PLT stub calls, by the
+  // stub's address.
+  std::unordered_map<uint64_t, const char*> stubs_;
+};
+
+#endif // BINARY_MATCHER_DIFF_SYMBOLIC_TARGETS_H
@@ -0,0 +1,224 @@
+#include "digest.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// The number of 64 bit lanes that a leaf is accumulated into.
+const size_t kLanes = 8;
+
+// The bytes consumed by one step of accumulation: a word per lane.
+const size_t kStripeSize = kLanes * sizeof(uint64_t);
+
+// The number of stripes between scrambles of the lanes.
+const size_t kStripesPerBlock = 16;
+
+// The size of a leaf. Inputs no larger than a leaf are hashed as one.
+const size_t kLeafSize = 1 << 14;
+
+// The fewest leaves worth hashing on another thread.
+const size_t kLeafGrain = 64;
+
+// Values mixed into the final merge of the lanes, so that a leaf and
+// a node over leaf digests never share a digest.
+const uint64_t kLeafDomain = 0;
+const uint64_t kNodeDomain = 0x8E5B1C3F0D7A2946ULL;
+
+// Pseudorandom words that each stripe is keyed with before it is
+// multiplied, and that lanes are scrambled and merged with.
+const uint64_t kSecret[24] = {
+  0x1AC046DDA8E86E2AULL, 0xBE2C3B00B1D348C8ULL, 0x9B1A66A95412FF75ULL,
+  0xC448C2B1F05F7E4CULL, 0xC111CA6B8F6E73C4ULL, 0xB54861920D05B01DULL,
+  0x8D61500F4A7BBE16ULL, 0x5E0C25471F89E02EULL, 0x48105A3D28F0E221ULL,
+  0x2169F8846B637746ULL, 0x3D628782E0C0D863ULL, 0xA5DDB2216078AA40ULL,
+  0xC8119D17F0571101ULL, 0x98E2E2EB8F33280FULL, 0x8CD1E28860679CC4ULL,
+  0x9DCA6189C923AEF3ULL, 0x9D8D3071BA4F04C4ULL, 0x5D395ADA34220C26ULL,
+  0xE6DE42A441A1E28EULL, 0x308FBF68CC864F59ULL, 0x216A3C81332862F9ULL,
+  0xBACECA0A77F3132EULL, 0xDF2A2215339CA69CULL, 0x3E4C11A103A5D859ULL,
+};
+
+// The first secret word of the keys of the final, partial stripe.
+const size_t kTailKey = 7;
+
+// The first secret word that lanes are scrambled with.
+const size_t kScrambleKey = 16;
+
+// The first secret words that lanes are merged with into each half
+// of a digest.
+const size_t kLowMergeKey = 3;
+const size_t kHighMergeKey = 11;
+
+// Odd constants that lanes are multiplied by when scrambled and merged.
+const uint64_t kScramblePrime = 0x9E3779B1ULL;
+const uint64_t kMergePrime = 0x9FB21C651E98DF25ULL;
+
+// Accumulates count stripes at data into the lanes, keying the i'th
+// from kSecret[key + i] on. Each lane gains the product of the low and
+// high halves of its keyed word, and the neighbouring lane the word
+// itself, so that no byte's contribution can be cancelled by a zero
+// key half.
+static void AccumulateStripes(uint64_t *const acc, const uint8_t *const data,
+                              const size_t count, const size_t key)
+{
+#if defined(__AVX2__)
+  __m256i lanes[2] = {
+    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc)),
+    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + 4)),
+  };
+  for (size_t i = 0; i < count; i++) {
+    for (unsigned j = 0; j < 2; j++) {
+      const __m256i kData = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(data + i*kStripeSize + 32*j));
+      const __m256i kKeyed = _mm256_xor_si256(kData, _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(kSecret + key + i + 4*j)));
+      lanes[j] = _mm256_add_epi64(lanes[j], _mm256_shuffle_epi32(
+          kData, _MM_SHUFFLE(1, 0, 3, 2)));
+      lanes[j] = _mm256_add_epi64(lanes[j], _mm256_mul_epu32(
+          kKeyed, _mm256_srli_epi64(kKeyed, 32)));
+    }
+  }
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc), lanes[0]);
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + 4), lanes[1]);
+#elif defined(__SSE2__)
+  __m128i lanes[4];
+  for (unsigned j = 0; j < 4; j++) {
+    lanes[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + 2*j));
+  }
+  for (size_t i = 0; i < count; i++) {
+    for (unsigned j = 0; j < 4; j++) {
+      const __m128i kData = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(data + i*kStripeSize + 16*j));
+      const __m128i kKeyed = _mm_xor_si128(kData, _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(kSecret + key + i + 2*j)));
+      lanes[j] = _mm_add_epi64(lanes[j], _mm_shuffle_epi32(
+          kData, _MM_SHUFFLE(1, 0, 3, 2)));
+      lanes[j] = _mm_add_epi64(lanes[j], _mm_mul_epu32(
+          kKeyed, _mm_srli_epi64(kKeyed, 32)));
+    }
+  }
+  for (unsigned j = 0; j < 4; j++) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + 2*j), lanes[j]);
+  }
+#else
+  for (size_t i = 0; i < count; i++) {
+    for (size_t j = 0; j < kLanes; j++) {
+      uint64_t word;
+      memcpy(&word, data + i*kStripeSize + j*sizeof(word), sizeof(word));
+      const uint64_t kKeyed = word ^ kSecret[key + i + j];
+      acc[j ^ 1] += word;
+      acc[j] += (kKeyed & 0xFFFFFFFFULL) * (kKeyed >> 32);
+    }
+  }
+#endif
+}
+
+// Scrambles the lanes, so that the bits accumulated in their high
+// halves feed the products of the next block.
+inline static void ScrambleLanes(uint64_t *const acc)
+{
+  for (size_t j = 0; j < kLanes; j++) {
+    acc[j] ^= acc[j] >> 47;
+    acc[j] ^= kSecret[kScrambleKey + j];
+    acc[j] *= kScramblePrime;
+  }
+}
+
+// Mixes the bits of a word so that each affects every bit of the result.
+inline static uint64_t Avalanche(uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+// Merges the lanes into a single word, keyed from kSecret[key] on.
+inline static uint64_t MergeLanes(const uint64_t *const acc, const size_t key,
+                                  uint64_t h)
+{
+  for (size_t j = 0; j < kLanes; j++) {
+    h = (h ^ Avalanche(acc[j] ^ kSecret[key + j])) * kMergePrime;
+  }
+  return Avalanche(h);
+}
+
+// Hashes the size bytes at data as a single node of the given domain.
+static ContentDigest HashNode(const uint8_t *const data, const size_t size,
+                              const uint64_t domain)
+{
+  uint64_t acc[kLanes];
+  for (size_t j = 0; j < kLanes; j++) {
+    acc[j] = kSecret[kScrambleKey + j] ^ domain;
+  }
+  const size_t kStripes = size / kStripeSize;
+  for (size_t i = 0; i < kStripes; i += kStripesPerBlock) {
+    const size_t kCount = std::min(kStripesPerBlock, kStripes - i);
+    AccumulateStripes(acc, data + i*kStripeSize, kCount, 0);
+    if (kCount == kStripesPerBlock) {
+      ScrambleLanes(acc);
+    }
+  }
+
+  // The bytes after the last whole stripe are padded with zeroes to a
+  // stripe of their own; the size tells the padding from the data.
+  uint8_t tail[kStripeSize] = {0};
+  const size_t kTail = size - kStripes*kStripeSize;
+  if (kTail) {
+    memcpy(tail, data + kStripes*kStripeSize, kTail);
+  }
+  AccumulateStripes(acc, tail, 1, kTailKey);
+
+  return ContentDigest{
+    MergeLanes(acc, kLowMergeKey, (size * kMergePrime) ^ domain),
+    MergeLanes(acc, kHighMergeKey, ~(size * kScramblePrime) ^ domain),
+  };
+}
+
+} // namespace
+
+std::string ContentDigest::ToString() const
+{
+  char digits[33];
+  snprintf(digits, sizeof(digits), "%016llx%016llx",
+           static_cast<unsigned long long>(high),
+           static_cast<unsigned long long>(low));
+  return digits;
+}
+
+ContentDigest ComputeDigest(const uint8_t *const data, const size_t size)
+{
+  if (size <= kLeafSize) {
+    return HashNode(data, size, kLeafDomain);
+  }
+
+  // Hash each leaf, then the leaves' digests as a single node.
+  const size_t kLeaves = (size + kLeafSize - 1) / kLeafSize;
+  std::vector<uint64_t> leaves(2*kLeaves);
+  ParallelForRange(kLeaves, kLeafGrain,
+                   [data, size, &leaves](const size_t begin, const size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      const size_t kOffset = i*kLeafSize;
+      const ContentDigest kLeaf = HashNode(
+          data + kOffset, std::min(kLeafSize, size - kOffset), kLeafDomain);
+      leaves[2*i] = kLeaf.low;
+      leaves[2*i + 1] = kLeaf.high;
+    }
+  });
+  return HashNode(reinterpret_cast<const uint8_t*>(leaves.data()),
+                  leaves.size() * sizeof(leaves[0]), kNodeDomain);
+}
@@ -0,0 +1,40 @@
+#ifndef BINARY_MATCHER_DIGEST_H
+#define BINARY_MATCHER_DIGEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// Type representing a 128 bit digest of a sequence of bytes, used to
+// recognise identical contents without comparing them byte by byte.
+// Digests are fast rather than cryptographic: they detect accidental
+// differences, not deliberate collisions.
+struct ContentDigest {
+  uint64_t low;
+  uint64_t high;
+
+  bool operator==(const ContentDigest &other) const
+  {
+    return low == other.low && high == other.high;
+  }
+
+  bool operator!=(const ContentDigest &other) const
+  {
+    return !(*this == other);
+  }
+
+  // Constructs a string representation of the digest, as 32
+  // hexadecimal digits.
+  std::string ToString() const;
+};
+
+// Computes the digest of the size bytes at data.
+// The bytes are split into fixed size leaves, whose digests are in
+// turn digested, so that the leaves of a large input are hashed
+// concurrently on the default thread pool. Each leaf is hashed a
+// vector register's worth of bytes per step where the target supports
+// it. The result depends only on the bytes, never on the number of
+// threads or the instruction set.
+ContentDigest ComputeDigest(const uint8_t *const data, const size_t size);
+
+#endif // BINARY_MATCHER_DIGEST_H
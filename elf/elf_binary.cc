@@ -1,63 +1,127 @@
+#include "binary_cache.h"
 #include "elf/elf_binary.h"
+#include "elf/elf_binary_field.h"
+#include "elf/elf_binary_frame.h"
 #include "elf/elf_binary_header.h"
+#include "elf/elf_binary_note.h"
 #include "elf/elf_binary_program_header.h"
+#include "elf/elf_binary_relocation.h"
 #include "elf/elf_binary_section_header.h"
+#include "elf/elf_binary_section_index.h"
+#include "elf/elf_binary_symbol_hash_table.h"
 #include "elf/elf_binary_symbol_table.h"
 #include "file.h"
+#include "merkle_tree.h"
+#include "status.h"
 
+#include <mutex>
 #include <sstream>
 #include <stdio.h>
 #include <string.h>
 #include <elf.h>
 
-ElfBinary *ElfBinary::ParseFile(const File *file)
+namespace {
+
+// The names of the symbol tables that a binary can hold.
+const char *const kSymbolTableNames[] = {
+  ".dynsym",
+  ".symtab",
+};
+
+// The names of the string tables holding the names of the symbols in
+// each of kSymbolTableNames.
+const char *const kStringTableNames[] = {
+  ".dynstr",
+  ".strtab",
+};
+
+} // namespace
+
+Result<ElfBinary> ElfBinary::ParseFile(std::unique_ptr<const File> file,
+                                       const BinaryCache *const cache)
 {
   const uint8_t *const buf = file->buffer();
+  const uint64_t kSize = file->size();
 
-  std::unique_ptr<Header> header(ParseElfHeader(buf));
-  if (!ValidElfHeader(header.get())) {
-    return nullptr;
+  const Status kHeaderStatus = CheckHeader(buf, kSize);
+  if (!kHeaderStatus.ok()) {
+    return kHeaderStatus;
   }
-
-  std::vector<ProgramHeader> program_headers
-      = ParseElfProgramHeaders(buf, header.get());
-
-  for (const ProgramHeader &program_header : program_headers) {
-    if (!ValidElfProgramHeader(program_header)) {
-      return nullptr;
-    }
+  std::unique_ptr<Arena> arena(new Arena());
+  Header *const header = ParseElfHeader(buf, kSize, arena.get());
+  if (header->kProgramHeaderOffset
+      && header->kProgramHeaderCount != PN_XNUM
+      && !ElfTableInBounds(header->kProgramHeaderOffset,
+                           header->kProgramHeaderCount,
+                           header->kProgramHeaderSize,
+                           ElfProgramHeaderMinSize(header->kClass), kSize)) {
+    return Status(Status::Code::kMalformed,
+                  "program headers extend beyond the end of the file");
+  }
+  if (header->kSectionHeaderOffset
+      && !ElfTableInBounds(header->kSectionHeaderOffset,
+                           header->kSectionHeaderCount,
+                           header->kSectionHeaderSize,
+                           ElfSectionHeaderMinSize(header->kClass), kSize)) {
+    return Status(Status::Code::kMalformed,
+                  "section headers extend beyond the end of the file");
   }
 
-  std::vector<SectionHeader> section_headers
-      = ParseElfSectionHeaders(buf, header.get());
-
-  for (const SectionHeader &section_header : section_headers) {
-    if (!ValidElfSectionHeader(section_header)) {
-      return nullptr;
+  std::unique_ptr<ElfBinary> binary(
+      new ElfBinary(file.release(), std::move(arena), header));
+  const File::Identity *const identity = binary->file()->identity();
+  if (cache && identity) {
+    const std::unique_ptr<BinaryCache::Entry> entry
+        = cache->Lookup(*identity);
+    if (entry) {
+      binary->LoadFromCache(&entry->reader);
     }
   }
+  return binary;
+}
 
-  std::vector<SymbolTable> symbol_tables = {
-    SymbolTable::Parse(".dynsym", buf, header.get(), section_headers),
-    SymbolTable::Parse(".symtab", buf, header.get(), section_headers),
-  };
-
-  return new ElfBinary(file, header.release(),
-                           std::move(program_headers),
-                           std::move(section_headers),
-                           std::move(symbol_tables));
+Status ElfBinary::CheckHeader(const uint8_t *const buf, const uint64_t size)
+{
+  Arena arena;
+  const Header *const header = ParseElfHeader(buf, size, &arena);
+  if (!header) {
+    return Status(Status::Code::kMalformed, "ELF header is truncated");
+  }
+  if (!ValidElfHeader(header)) {
+    return Status(Status::Code::kMalformed, "ELF header is invalid");
+  }
+  return Status();
 }
 
 ElfBinary::ElfBinary(const File *file,
-                             Header *header,
-                             std::vector<ProgramHeader> &&program_headers,
-                             std::vector<SectionHeader> &&section_headers,
-                             std::vector<SymbolTable> &&symbol_tables)
+                     std::unique_ptr<Arena> arena,
+                     Header *header)
   : Binary(file),
+    arena_(std::move(arena)),
     header_(header),
-    program_headers_(program_headers),
-    section_headers_(section_headers),
-    symbol_tables_(symbol_tables) { }
+    program_headers_once_(),
+    program_headers_(),
+    section_headers_once_(),
+    section_headers_(),
+    section_index_once_(),
+    section_index_(),
+    symbol_tables_once_(),
+    symbol_tables_(),
+    symbol_hash_table_once_(),
+    symbol_hash_table_(),
+    notes_once_(),
+    notes_(),
+    section_trees_once_(),
+    section_trees_(),
+    relocations_once_(),
+    relocations_(),
+    frame_ranges_once_(),
+    frame_ranges_(),
+    frame_symbol_table_once_(),
+    frame_symbol_table_(),
+    cached_(false) { }
+
+ElfBinary::~ElfBinary() { }
 
 Binary::Type ElfBinary::GetType() const
 {
@@ -69,22 +133,332 @@ const ElfBinary::Header *ElfBinary::header() const
   return header_.get();
 }
 
-const std::vector<ElfBinary::ProgramHeader>
+const ArenaVector<ElfBinary::ProgramHeader>
 &ElfBinary::program_headers() const
 {
+  std::call_once(program_headers_once_, [this] {
+    file()->Prefetch(header_->kProgramHeaderOffset,
+                     static_cast<uint64_t>(header_->kProgramHeaderCount)
+                     * header_->kProgramHeaderSize);
+    ArenaVector<ProgramHeader> program_headers = ParseElfProgramHeaders(
+        file()->buffer(), file()->size(), header_.get(), arena_.get());
+    for (const ProgramHeader &program_header : program_headers) {
+      if (!ValidElfProgramHeader(program_header)) {
+        return;
+      }
+    }
+    program_headers_ = std::move(program_headers);
+  });
   return program_headers_;
 }
 
-const std::vector<ElfBinary::SectionHeader>
+const ArenaVector<ElfBinary::SectionHeader>
 &ElfBinary::section_headers() const
 {
+  std::call_once(section_headers_once_, [this] {
+    file()->Prefetch(header_->kSectionHeaderOffset,
+                     static_cast<uint64_t>(header_->kSectionHeaderCount)
+                     * header_->kSectionHeaderSize);
+    ArenaVector<SectionHeader> section_headers = ParseElfSectionHeaders(
+        file()->buffer(), file()->size(), header_.get(), arena_.get());
+    for (const SectionHeader &section_header : section_headers) {
+      if (!ValidElfSectionHeader(section_header)) {
+        return;
+      }
+    }
+    section_headers_ = std::move(section_headers);
+  });
   return section_headers_;
 }
 
-const std::vector<ElfBinary::SymbolTable>
-&ElfBinary::symbol_tables() const
+const ElfBinary::SectionIndex &ElfBinary::section_index() const
+{
+  std::call_once(section_index_once_, [this] {
+    section_index_.reset(
+        arena_->New<SectionIndex>(section_headers(), arena_.get()));
+  });
+  return *section_index_;
+}
+
+const ElfBinary::SectionHeader
+*ElfBinary::FindSection(const char *const name) const
+{
+  const size_t kIndex = section_index().Find(name);
+  if (kIndex == SectionIndex::kNotFound) {
+    return nullptr;
+  }
+  return &section_headers()[kIndex];
+}
+
+ContentDigest ElfBinary::SectionDigest(const size_t i) const
+{
+  return section_trees()[i].root();
+}
+
+const ArenaVector<ElfBinary::Note> &ElfBinary::notes() const
+{
+  std::call_once(notes_once_, [this] {
+    notes_ = ParseElfNotes(file()->buffer(), file()->size(), header_.get(),
+                           program_headers(), section_headers(),
+                           arena_.get());
+  });
+  return notes_;
+}
+
+const ElfBinary::Note *ElfBinary::FindNote(const char *const owner,
+                                           const uint32_t type) const
+{
+  for (const Note &note : notes()) {
+    if (note.kType == type && !strcmp(note.kOwner, owner)) {
+      return &note;
+    }
+  }
+  return nullptr;
+}
+
+const ElfBinary::Note *ElfBinary::build_id() const
+{
+  return FindNote("GNU", NT_GNU_BUILD_ID);
+}
+
+const ArenaVector<MerkleTree> &ElfBinary::section_trees() const
+{
+  std::call_once(section_trees_once_, [this] {
+    ArenaVector<MerkleTree> section_trees{
+        ArenaAllocator<MerkleTree>(arena_.get())};
+    section_trees.reserve(section_headers().size());
+    for (size_t i = 0; i < section_headers().size(); i++) {
+      uint64_t size;
+      const uint8_t *const kContents = SectionContents(i, &size);
+      file()->Prefetch(static_cast<uint64_t>(kContents - file()->buffer()),
+                       size);
+      section_trees.emplace_back(kContents, static_cast<size_t>(size),
+                                 arena_.get());
+    }
+    section_trees_.reset(arena_->New<ArenaVector<MerkleTree>>(
+        std::move(section_trees)));
+  });
+  return *section_trees_;
+}
+
+bool ElfBinary::cached() const
+{
+  return cached_;
+}
+
+const ArenaVector<ElfBinary::Relocation>
+&ElfBinary::relocations(const size_t i) const
+{
+  std::call_once(relocations_once_, [this] {
+    ArenaVector<ArenaVector<Relocation>> relocations{
+        ArenaAllocator<ArenaVector<Relocation>>(arena_.get())};
+    relocations.reserve(section_headers().size());
+    for (const SectionHeader &section_header : section_headers()) {
+      if (section_header.kType == SHT_REL
+          || section_header.kType == SHT_RELA) {
+        file()->Prefetch(section_header.kOffset, section_header.kSize);
+      }
+      relocations.push_back(ParseElfRelocations(
+          file()->buffer(), file()->size(), header_.get(), section_header,
+          arena_.get()));
+    }
+    relocations_.reset(arena_->New<ArenaVector<ArenaVector<Relocation>>>(
+        std::move(relocations)));
+  });
+  return (*relocations_)[i];
+}
+
+std::vector<const ElfBinary::SectionHeader*>
+ElfBinary::SectionsOfType(const uint32_t type) const
+{
+  std::vector<const SectionHeader*> sections;
+  for (const uint32_t i : section_index().SectionsOfType(type)) {
+    sections.push_back(&section_headers()[i]);
+  }
+  return sections;
+}
+
+const ElfBinary::SymbolTable
+*ElfBinary::symbol_table(const char *const type) const
+{
+  for (size_t i = 0; i < kSymbolTableTypes; i++) {
+    if (strcmp(type, kSymbolTableNames[i])) {
+      continue;
+    }
+    std::call_once(symbol_tables_once_[i], [this, i] {
+      // Every symbol and most names will be read, so read them in
+      // up front rather than fault them in a page at a time.
+      PrefetchSection(kSymbolTableNames[i]);
+      PrefetchSection(kStringTableNames[i]);
+      symbol_tables_[i].reset(arena_->New<SymbolTable>(SymbolTable::Parse(
+          kSymbolTableNames[i], file()->buffer(), file()->size(),
+          header_.get(), section_headers(), section_index(),
+          arena_.get())));
+    });
+    return symbol_tables_[i].get();
+  }
+  return nullptr;
+}
+
+const ArenaVector<ElfBinary::FrameRange> &ElfBinary::frame_ranges() const
+{
+  std::call_once(frame_ranges_once_, [this] {
+    PrefetchSection(".eh_frame_hdr");
+    PrefetchSection(".eh_frame");
+    frame_ranges_ = ParseElfFrameRanges(
+        file()->buffer(), file()->size(), header_.get(), program_headers(),
+        section_headers(), section_index(), arena_.get());
+  });
+  return frame_ranges_;
+}
+
+const ElfBinary::SymbolTable *ElfBinary::frame_symbol_table() const
 {
-  return symbol_tables_;
+  std::call_once(frame_symbol_table_once_, [this] {
+    frame_symbol_table_.reset(arena_->New<SymbolTable>(
+        SymbolTable::FromFrameRanges(".eh_frame", frame_ranges(),
+                                     section_headers(),
+                                     *symbol_table(".dynsym"),
+                                     arena_.get())));
+  });
+  return frame_symbol_table_.get();
+}
+
+std::vector<const ElfBinary::SymbolTable*> ElfBinary::symbol_tables() const
+{
+  std::vector<const SymbolTable*> symbol_tables;
+  for (const char *const type : kSymbolTableNames) {
+    symbol_tables.push_back(symbol_table(type));
+  }
+  return symbol_tables;
+}
+
+const ElfBinary::SymbolHashTable *ElfBinary::symbol_hash_table() const
+{
+  std::call_once(symbol_hash_table_once_, [this] {
+    symbol_hash_table_.reset(
+        ParseElfSymbolHashTable(file()->buffer(), file()->size(),
+                                header_.get(), arena_.get()));
+  });
+  return symbol_hash_table_.get();
+}
+
+size_t ElfBinary::FindDynamicSymbol(const char *const name) const
+{
+  const SymbolHashTable *const hash_table = symbol_hash_table();
+  if (hash_table) {
+    const size_t kSymbol = hash_table->Find(name);
+    return kSymbol == SymbolHashTable::kNotFound
+        ? SymbolTable::kNoSymbol : kSymbol;
+  }
+  const SymbolTable *const table = symbol_table(".dynsym");
+  const size_t kSymbol = table->FindSymbolByName(name);
+  return kSymbol == SymbolTable::kNoSymbol
+      || table->columns().section_header_indices[kSymbol] == SHN_UNDEF
+      ? SymbolTable::kNoSymbol : kSymbol;
+}
+
+ElfBinary::SectionHeaderRange ElfBinary::section_header_views() const
+{
+  return ParseElfSectionHeaderViews(file()->buffer(), file()->size(),
+                                    header_.get());
+}
+
+ElfBinary::SymbolRange
+ElfBinary::symbol_views(const char *const type) const
+{
+  return ParseElfSymbolViews(type, file()->buffer(), file()->size(),
+                             header_.get(), section_index());
+}
+
+Status ElfBinary::StoreInCache(const BinaryCache &cache) const
+{
+  const File::Identity *const identity = file()->identity();
+  if (!identity) {
+    return Status(Status::Code::kUnsupported,
+                  "binaries read from streams are not cached");
+  }
+  if (cached_) {
+    return Status();
+  }
+  const uint8_t *const buf = file()->buffer();
+  const uint64_t kSize = file()->size();
+  CacheWriter writer;
+  section_index().Serialize(buf, kSize, &writer);
+  for (const SymbolTable *const symbol_table : symbol_tables()) {
+    symbol_table->Serialize(buf, kSize, &writer);
+  }
+  writer.Write<uint64_t>(section_trees().size());
+  for (const MerkleTree &section_tree : section_trees()) {
+    section_tree.Serialize(&writer);
+  }
+  return cache.Store(*identity, writer.contents());
+}
+
+void ElfBinary::LoadFromCache(CacheReader *const reader)
+{
+  // The index holds section numbers, which must be those of the
+  // section headers. Those are cheap to parse, unlike the index.
+  const uint8_t *const buf = file()->buffer();
+  const uint64_t kSize = file()->size();
+  SectionIndex section_index = SectionIndex::Load(
+      reader, buf, kSize, section_headers().size(), arena_.get());
+  std::vector<SymbolTable> symbol_tables;
+  for (const char *const type : kSymbolTableNames) {
+    symbol_tables.push_back(
+        SymbolTable::Load(reader, type, buf, kSize, arena_.get()));
+  }
+  // There must be a tree over the contents of each section.
+  ArenaVector<MerkleTree> section_trees{
+      ArenaAllocator<MerkleTree>(arena_.get())};
+  if (reader->Read<uint64_t>() != section_headers().size()) {
+    reader->Fail();
+  }
+  for (size_t i = 0; reader->ok() && i < section_headers().size(); i++) {
+    uint64_t size;
+    SectionContents(i, &size);
+    section_trees.push_back(MerkleTree::Load(reader, size, arena_.get()));
+  }
+  if (!reader->ok()) {
+    return;
+  }
+
+  std::call_once(section_index_once_, [this, &section_index] {
+    section_index_.reset(
+        arena_->New<SectionIndex>(std::move(section_index)));
+  });
+  for (size_t i = 0; i < kSymbolTableTypes; i++) {
+    std::call_once(symbol_tables_once_[i], [this, &symbol_tables, i] {
+      symbol_tables_[i].reset(
+          arena_->New<SymbolTable>(std::move(symbol_tables[i])));
+    });
+  }
+  std::call_once(section_trees_once_, [this, &section_trees] {
+    section_trees_.reset(arena_->New<ArenaVector<MerkleTree>>(
+        std::move(section_trees)));
+  });
+  cached_ = true;
+}
+
+const uint8_t *ElfBinary::SectionContents(const size_t i,
+                                          uint64_t *const size) const
+{
+  const SectionHeader &section = section_headers()[i];
+  if (section.kType == SHT_NOBITS
+      || !ElfRangeInBounds(section.kOffset, section.kSize, file()->size())) {
+    *size = 0;
+    return file()->buffer();
+  }
+  *size = section.kSize;
+  return file()->buffer() + section.kOffset;
+}
+
+void ElfBinary::PrefetchSection(const char *const name) const
+{
+  const SectionHeader *const section = FindSection(name);
+  if (section && section->kType != SHT_NOBITS) {
+    file()->Prefetch(section->kOffset, section->kSize);
+  }
 }
 
 std::string ElfBinary::ToString() const
@@ -92,20 +466,26 @@ std::string ElfBinary::ToString() const
   std::stringstream res;
   res << filename() << ":\n"
       << header_->ToString() << '\n';
-  for (unsigned i = 0; i < program_headers_.size(); i++) {
+  const ArenaVector<ProgramHeader> &program_headers = this->program_headers();
+  for (unsigned i = 0; i < program_headers.size(); i++) {
     res << "\nProgram Header " << i << ": "
-        << program_headers_[i].ToString() << '\n';
+        << program_headers[i].ToString() << '\n';
   }
-  for (unsigned i = 0; i < section_headers_.size(); i++) {
+  const ArenaVector<SectionHeader> &section_headers = this->section_headers();
+  for (unsigned i = 0; i < section_headers.size(); i++) {
     res << "\nSection Header " << i << ": "
-        << section_headers_[i].ToString() << '\n';
+        << section_headers[i].ToString() << '\n';
+  }
+  const ArenaVector<Note> &notes = this->notes();
+  for (unsigned i = 0; i < notes.size(); i++) {
+    res << "\nNote " << i << ": " << notes[i].ToString() << '\n';
   }
-  for (unsigned i = 0; i < symbol_tables_.size(); i++) {
-    if (!strcmp(symbol_tables_[i].type(), "N/A")) {
+  for (const SymbolTable *symbol_table : symbol_tables()) {
+    if (!strcmp(symbol_table->type(), "N/A")) {
       continue;
     }
-    res << "\nSymbol table " << symbol_tables_[i].type() << ":"
-        << symbol_tables_[i].ToString() << '\n';
+    res << "\nSymbol table " << symbol_table->type() << ":"
+        << symbol_table->ToString() << '\n';
   }
   return res.str();
 }
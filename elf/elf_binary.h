@@ -1,9 +1,14 @@
 #ifndef BINARY_MATCHER_ELF_BINARY_H
 #define BINARY_MATCHER_ELF_BINARY_H
 
+#include "arena.h"
 #include "binary.h"
+#include "binary_cache.h"
+#include "digest.h"
+#include "merkle_tree.h"
 
 #include <memory>
+#include <mutex>
 #include <stdint.h>
 #include <string>
 #include <vector>
@@ -19,46 +24,243 @@ public:
   struct ProgramHeader;
   // Type representing an ELF Section Header.
   struct SectionHeader;
+  // Type representing an ELF Note.
+  struct Note;
   // Type representing an ELF Symbol.
   struct Symbol;
+  // Type representing an ELF Relocation.
+  struct Relocation;
+  // Type representing the code range of an .eh_frame FDE.
+  struct FrameRange;
   // Type representing an ELF Symbol Table.
   class SymbolTable;
+  // Type representing a hash index over names in a string table.
+  class NameIndex;
+  // Type representing an index from addresses to containing ranges.
+  class AddressIndex;
+  // Type representing an index of sections by name and type.
+  class SectionIndex;
+  // Type representing the binary's own hash table of dynamic symbols.
+  class SymbolHashTable;
+  // Type providing a zero-copy view of an ELF Section Header.
+  class SectionHeaderView;
+  // Type providing a zero-copy view of an ELF Symbol.
+  class SymbolView;
+  // Type representing a table of ELF entries as a range of views.
+  template <typename View> class ViewRange;
+  // Range of views over the binary's section headers.
+  using SectionHeaderRange = ViewRange<SectionHeaderView>;
+  // Range of views over the symbols of a symbol table.
+  using SymbolRange = ViewRange<SymbolView>;
 
   // Parses an ElfBinary from the given file.
-  // Returns nullptr in case of failure.
-  static ElfBinary *ParseFile(const File *file);
+  // Only the ELF header is parsed up front; every other component
+  // is parsed, validated and indexed the first time it is requested.
+  // Every component is allocated from an arena that the binary owns,
+  // so destroying the binary releases them all at once.
+  // Every offset read from the file is checked against its size: a
+  // component that lies outside the file is treated as absent.
+  // If the ELF header is truncated or invalid, or the program or
+  // section header tables lie outside the file, returns a status
+  // describing why.
+  // If a cache is given and holds a valid entry for the file, the
+  // section index, symbol tables and section trees are read from it
+  // rather than built from the file.
+  static Result<ElfBinary> ParseFile(std::unique_ptr<const File> file,
+                                     const BinaryCache *const cache = nullptr);
+
+  // Checks that the size bytes at buf, which may be only the start
+  // of a file, begin with a valid ELF header, as ParseFile would.
+  // Lets a caller reject a file before it has all been read.
+  static Status CheckHeader(const uint8_t *const buf, const uint64_t size);
+
+  // Binaries are neither copied nor moved; they are shared by pointer.
+  ElfBinary(const ElfBinary&) = delete;
+  ElfBinary &operator=(const ElfBinary&) = delete;
+
+  ~ElfBinary() override;
 
   // Returns a pointer to the binary's ELF header.
   const Header *header() const;
 
-  // Returns the binary's program headers.
-  const std::vector<ProgramHeader> &program_headers() const;
+  // Returns the binary's program headers, parsing them on first use.
+  // If any program header is invalid, returns an empty vector.
+  const ArenaVector<ProgramHeader> &program_headers() const;
+
+  // Returns the binary's section headers, parsing them on first use.
+  // If any section header is invalid, returns an empty vector.
+  const ArenaVector<SectionHeader> &section_headers() const;
+
+  // Returns an index of the binary's sections by name and type,
+  // building it on first use.
+  const SectionIndex &section_index() const;
+
+  // Returns the first section named name, or nullptr if there is none.
+  const SectionHeader *FindSection(const char *const name) const;
+
+  // Returns the bytes of the file that the i'th section, which must be
+  // below section_headers().size(), occupies, storing their number in
+  // *size. A section that occupies no space in the file, or that
+  // extends beyond its end, occupies none.
+  const uint8_t *SectionContents(const size_t i, uint64_t *const size) const;
+
+  // Returns the digest of the contents of the i'th section, which must
+  // be below section_headers().size(): the root of its Merkle tree (see
+  // section_trees), so it shares the trees' work, and their cache
+  // entry. Sections are treated as SectionContents treats them.
+  ContentDigest SectionDigest(const size_t i) const;
+
+  // Returns the binary's notes, parsing them on first use.
+  const ArenaVector<Note> &notes() const;
+
+  // Returns the first note of the given owner and type, or nullptr if
+  // there is none.
+  const Note *FindNote(const char *const owner, const uint32_t type) const;
+
+  // Returns the binary's NT_GNU_BUILD_ID note, which identifies the
+  // build that produced it, or nullptr if it has none.
+  const Note *build_id() const;
+
+  // Returns a Merkle tree over the contents of each section, in
+  // section header order, building them on first use. Sections are
+  // treated as SectionContents treats them.
+  const ArenaVector<MerkleTree> &section_trees() const;
+
+  // Returns true if the section index, symbol tables and section
+  // trees were read from a cache entry, so that none of them reads
+  // the file.
+  bool cached() const;
+
+  // Returns the relocations held in the i'th section, which must be
+  // below section_headers().size(), parsing those of every SHT_REL and
+  // SHT_RELA section on first use. Any other section holds none.
+  const ArenaVector<Relocation> &relocations(const size_t i) const;
+
+  // Returns the sections of the given type (e.g. SHT_RELA),
+  // in the order they appear in the binary.
+  std::vector<const SectionHeader*> SectionsOfType(const uint32_t type) const;
+
+  // Returns the binary's symbol table of the given type (".dynsym" or
+  // ".symtab"), parsing and indexing it on first use.
+  // Returns nullptr for any other type.
+  const SymbolTable *symbol_table(const char *const type) const;
+
+  // Returns the binary's symbol tables, parsing any not yet parsed.
+  std::vector<const SymbolTable*> symbol_tables() const;
+
+  // Returns the index in .dynsym of the defined dynamic symbol named
+  // name, or SymbolTable::kNoSymbol if there is none. The lookup goes
+  // through symbol_hash_table(), so that .dynsym is neither decoded
+  // nor indexed, unless the binary has no valid hash table; then the
+  // name index of .dynsym is used. Where several defined symbols share
+  // the name, either may be returned.
+  size_t FindDynamicSymbol(const char *const name) const;
 
-  // Returns the binary's section headers.
-  const std::vector<SectionHeader> &section_headers() const;
+  // Returns the ranges of code described by the FDEs of .eh_frame,
+  // ordered by start address, parsing them on first use.
+  const ArenaVector<FrameRange> &frame_ranges() const;
 
-  // Returns the binary's symbol tables.
-  const std::vector<SymbolTable> &symbol_tables() const;
+  // Returns a table of type ".eh_frame" holding a function symbol for
+  // each of frame_ranges(), named after the .dynsym symbol at the same
+  // address where there is one, building it on first use (see
+  // SymbolTable::FromFrameRanges). It outlines the functions of a
+  // stripped binary, whose .symtab is "N/A". Returns a table of type
+  // "N/A" if the binary has no ranges. The table is not cached, nor
+  // listed among symbol_tables().
+  const SymbolTable *frame_symbol_table() const;
+
+  // Returns the hash table that the binary carries for its dynamic
+  // symbols (.gnu.hash, or failing that .hash), locating it on first
+  // use. Lookups through it read only the parts of the file they
+  // need, so are far cheaper than parsing .dynsym for a few symbols.
+  // Returns nullptr if the binary has no valid hash table.
+  const SymbolHashTable *symbol_hash_table() const;
+
+  // Returns views of the binary's section headers, which decode
+  // fields directly from the file on demand.
+  SectionHeaderRange section_header_views() const;
+
+  // Returns views of the symbols in the symbol table of the given
+  // type (".symtab" or ".dynsym"), which decode fields directly from
+  // the file on demand. Returns an empty range if there is no such
+  // table.
+  SymbolRange symbol_views(const char *const type) const;
+
+  // Parses and indexes the section index, symbol tables and section
+  // trees, if not already, and stores them as the cache's entry for
+  // the binary's file, unless they were read from it.
+  Status StoreInCache(const BinaryCache &cache) const override;
 
   Binary::Type GetType() const override;
   std::string ToString() const override;
 private:
-  ElfBinary(const File *file, Header *header,
-                std::vector<ProgramHeader> &&program_headers,
-                std::vector<SectionHeader> &&section_headers,
-                std::vector<SymbolTable> &&symbol_tables);
+  // The number of symbol table types that the binary can hold.
+  static const size_t kSymbolTableTypes = 2;
+
+  ElfBinary(const File *file, std::unique_ptr<Arena> arena, Header *header);
+
+  // Reads the section index, symbol tables and section trees from a
+  // cache entry written by StoreInCache. Leaves them to be built on
+  // first use, as usual, if the entry is not valid.
+  void LoadFromCache(CacheReader *const reader);
+
+  // Advises the kernel that the contents of the first section named
+  // name are about to be read in full, if there is such a section.
+  void PrefetchSection(const char *const name) const;
+
+  // The arena that every component below is allocated from.
+  // Declared first, so that it is destroyed last.
+  std::unique_ptr<Arena> arena_;
 
   // The binary's ELF header.
-  std::unique_ptr<Header> header_;
+  ArenaPtr<Header> header_;
+
+  // Each of the following components is parsed by whichever thread
+  // first requests it, under its once_flag, and is immutable after.
 
   // The binary's program headers.
-  std::vector<ProgramHeader> program_headers_;
+  mutable std::once_flag program_headers_once_;
+  mutable ArenaVector<ProgramHeader> program_headers_;
 
   // The binary's section headers.
-  std::vector<SectionHeader> section_headers_;
+  mutable std::once_flag section_headers_once_;
+  mutable ArenaVector<SectionHeader> section_headers_;
+
+  // The index of the binary's section headers.
+  mutable std::once_flag section_index_once_;
+  mutable ArenaPtr<SectionIndex> section_index_;
+
+  // The binary's symbol tables, indexed as kSymbolTableNames.
+  mutable std::once_flag symbol_tables_once_[kSymbolTableTypes];
+  mutable ArenaPtr<SymbolTable> symbol_tables_[kSymbolTableTypes];
+
+  // The binary's dynamic symbol hash table.
+  mutable std::once_flag symbol_hash_table_once_;
+  mutable ArenaPtr<SymbolHashTable> symbol_hash_table_;
+
+  // The binary's notes.
+  mutable std::once_flag notes_once_;
+  mutable ArenaVector<Note> notes_;
+
+  // The Merkle trees over the binary's sections.
+  mutable std::once_flag section_trees_once_;
+  mutable ArenaPtr<ArenaVector<MerkleTree>> section_trees_;
+
+  // The relocations held in each section, in section header order.
+  mutable std::once_flag relocations_once_;
+  mutable ArenaPtr<ArenaVector<ArenaVector<Relocation>>> relocations_;
+
+  // The ranges of code described by .eh_frame.
+  mutable std::once_flag frame_ranges_once_;
+  mutable ArenaVector<FrameRange> frame_ranges_;
+
+  // The function symbols synthesized from frame_ranges_.
+  mutable std::once_flag frame_symbol_table_once_;
+  mutable ArenaPtr<SymbolTable> frame_symbol_table_;
 
-  // The binary's symbol tables.
-  std::vector<SymbolTable> symbol_tables_;
+  // True if the section index, symbol tables and section trees were
+  // read from a cache entry.
+  bool cached_;
 };
 
 #endif // BINARY_MATCHER_ELF_BINARY_H
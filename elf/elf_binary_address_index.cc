@@ -0,0 +1,230 @@
+#include "binary_cache.h"
+#include "elf/elf_binary_address_index.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+using AddressIndex = ElfBinary::AddressIndex;
+
+namespace {
+
+// Type representing one entry's range while the index is built.
+struct Range {
+  uint64_t start;
+  uint64_t end;
+  uint32_t entry;
+};
+
+// Orders ranges by start address, then by entry, so that the order
+// (and hence every lookup result) is fully determined.
+inline static bool RangeBefore(const Range &a, const Range &b)
+{
+  return a.start != b.start ? a.start < b.start : a.entry < b.entry;
+}
+
+} // namespace
+
+const size_t AddressIndex::kNotFound;
+const uint32_t AddressIndex::kNoRange;
+
+AddressIndex::AddressIndex(AddressIndex&&) = default;
+
+AddressIndex &AddressIndex::operator=(AddressIndex&&) = default;
+
+AddressIndex::~AddressIndex() { }
+
+AddressIndex::AddressIndex()
+  : starts_(),
+    ends_(),
+    enclosing_(),
+    entries_(),
+    eytzinger_(1, 0),
+    eytzinger_ranks_(1, 0) { }
+
+AddressIndex::AddressIndex(const uint64_t *const starts,
+                           const uint64_t *const sizes,
+                           const uint8_t *const include,
+                           const size_t count,
+                           Arena *const arena)
+  : starts_(ArenaAllocator<uint64_t>(arena)),
+    ends_(ArenaAllocator<uint64_t>(arena)),
+    enclosing_(ArenaAllocator<uint32_t>(arena)),
+    entries_(ArenaAllocator<uint32_t>(arena)),
+    eytzinger_(ArenaAllocator<uint64_t>(arena)),
+    eytzinger_ranks_(ArenaAllocator<uint32_t>(arena))
+{
+  std::vector<Range> ranges;
+  ranges.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    if (include && !include[i]) {
+      continue;
+    }
+    // Saturate rather than wrap ranges that run off the address space.
+    const uint64_t kEnd = sizes[i] > UINT64_MAX - starts[i]
+        ? UINT64_MAX : starts[i] + sizes[i];
+    ranges.push_back(Range{starts[i], kEnd, static_cast<uint32_t>(i)});
+  }
+  ParallelSort(ranges.begin(), ranges.end(), RangeBefore);
+
+  const size_t kSize = ranges.size();
+  starts_.resize(kSize);
+  ends_.resize(kSize);
+  enclosing_.resize(kSize);
+  entries_.resize(kSize);
+  // The stack holds the ranges that end after every range following
+  // them so far, latest on top; a range's link is the first of them
+  // that ends after it, and it hides those that end no later.
+  std::vector<uint32_t> stack;
+  for (size_t i = 0; i < kSize; i++) {
+    starts_[i] = ranges[i].start;
+    ends_[i] = ranges[i].end;
+    entries_[i] = ranges[i].entry;
+    while (!stack.empty() && ends_[stack.back()] <= ends_[i]) {
+      stack.pop_back();
+    }
+    enclosing_[i] = stack.empty() ? kNoRange : stack.back();
+    stack.push_back(static_cast<uint32_t>(i));
+  }
+
+  eytzinger_.resize(kSize + 1);
+  eytzinger_ranks_.resize(kSize + 1);
+  BuildEytzinger(0, 1);
+}
+
+size_t AddressIndex::BuildEytzinger(size_t rank, const size_t node)
+{
+  if (node < eytzinger_.size()) {
+    rank = BuildEytzinger(rank, 2*node);
+    eytzinger_[node] = starts_[rank];
+    eytzinger_ranks_[node] = static_cast<uint32_t>(rank);
+    rank = BuildEytzinger(rank + 1, 2*node + 1);
+  }
+  return rank;
+}
+
+size_t AddressIndex::size() const
+{
+  return starts_.size();
+}
+
+size_t AddressIndex::CountStartingAtOrBefore(const uint64_t address) const
+{
+  const size_t kSize = starts_.size();
+  // Descend the implicit tree, going right while the node starts at
+  // or before address. Each level's nodes are contiguous, so the
+  // descendants a few levels down share a cache line to prefetch.
+  size_t node = 1;
+  while (node <= kSize) {
+    if (16*node <= kSize) {
+      __builtin_prefetch(&eytzinger_[16*node]);
+    }
+    node = 2*node + (eytzinger_[node] <= address ? 1 : 0);
+  }
+  // Undo the trailing right turns to reach the first node starting
+  // after address. If there is none, every range starts at or before.
+  node >>= __builtin_ffsll(static_cast<long long>(~node));
+  return node ? eytzinger_ranks_[node] : kSize;
+}
+
+size_t AddressIndex::FindContainingBefore(const uint64_t address,
+                                          const size_t rank) const
+{
+  // Of the ranges starting at or before address, the last one that
+  // contains it ends after every later one, which all end at or before
+  // address, so it is reached by following links from the last.
+  // Each link skips ranges that the one before them encloses, so the
+  // number followed is at most the depth of nesting.
+  uint32_t i = rank ? static_cast<uint32_t>(rank - 1) : kNoRange;
+  while (i != kNoRange) {
+    if (ends_[i] > address) {
+      return entries_[i];
+    }
+    i = enclosing_[i];
+  }
+  return kNotFound;
+}
+
+size_t AddressIndex::FindStartingAt(const uint64_t address) const
+{
+  const size_t kRank = CountStartingAtOrBefore(address);
+  if (kRank && starts_[kRank - 1] == address) {
+    return entries_[kRank - 1];
+  }
+  return kNotFound;
+}
+
+size_t AddressIndex::FindStartingAtOrBefore(const uint64_t address) const
+{
+  const size_t kRank = CountStartingAtOrBefore(address);
+  return kRank ? entries_[kRank - 1] : kNotFound;
+}
+
+size_t AddressIndex::FindContaining(const uint64_t address) const
+{
+  return FindContainingBefore(address, CountStartingAtOrBefore(address));
+}
+
+void AddressIndex::FindContaining(const uint64_t *const addresses,
+                                  const size_t count,
+                                  size_t *const entries) const
+{
+  std::vector<std::pair<uint64_t, size_t>> queries(count);
+  for (size_t i = 0; i < count; i++) {
+    queries[i] = std::make_pair(addresses[i], i);
+  }
+  ParallelSort(queries.begin(), queries.end(),
+               std::less<std::pair<uint64_t, size_t>>());
+
+  size_t rank = 0;
+  for (const std::pair<uint64_t, size_t> &query : queries) {
+    while (rank < starts_.size() && starts_[rank] <= query.first) {
+      rank++;
+    }
+    entries[query.second] = FindContainingBefore(query.first, rank);
+  }
+}
+
+void AddressIndex::Serialize(CacheWriter *const writer) const
+{
+  writer->WriteArray(starts_);
+  writer->WriteArray(ends_);
+  writer->WriteArray(enclosing_);
+  writer->WriteArray(entries_);
+  writer->WriteArray(eytzinger_);
+  writer->WriteArray(eytzinger_ranks_);
+}
+
+AddressIndex AddressIndex::Load(CacheReader *const reader, const size_t count,
+                                Arena *const arena)
+{
+  AddressIndex index;
+  index.starts_ = reader->ReadArray<uint64_t>(arena);
+  const size_t kSize = index.starts_.size();
+  index.ends_ = reader->ReadArray<uint64_t>(arena);
+  index.enclosing_ = reader->ReadArray<uint32_t>(arena);
+  index.entries_ = reader->ReadArray<uint32_t>(count, arena);
+  index.eytzinger_ = reader->ReadArray<uint64_t>(arena);
+  // The unused root rank of an empty index is 0.
+  index.eytzinger_ranks_
+      = reader->ReadArray<uint32_t>(std::max<size_t>(kSize, 1), arena);
+  if (index.ends_.size() != kSize
+      || index.enclosing_.size() != kSize
+      || index.entries_.size() != kSize
+      || index.eytzinger_.size() != kSize + 1
+      || index.eytzinger_ranks_.size() != kSize + 1) {
+    reader->Fail();
+    return AddressIndex();
+  }
+  // Links must lead backwards, or lookups could loop.
+  for (size_t i = 0; i < kSize; i++) {
+    if (index.enclosing_[i] != kNoRange && index.enclosing_[i] >= i) {
+      reader->Fail();
+      return AddressIndex();
+    }
+  }
+  return index;
+}
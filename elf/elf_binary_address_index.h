@@ -0,0 +1,109 @@
+#ifndef BINARY_MATCHER_ELF_BINARY_ADDRESS_INDEX_H
+#define BINARY_MATCHER_ELF_BINARY_ADDRESS_INDEX_H
+
+#include "arena.h"
+#include "binary_cache.h"
+#include "elf/elf_binary.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Type that represents an index from addresses to the entries (e.g.
+// symbols) whose [start, start + size) ranges contain them.
+// Ranges are held sorted by start address, each linked to the last
+// range before it that ends after it does, so that a lookup that
+// finds a range ending before the address jumps straight to the
+// nearest range that might still contain it, rather than scanning
+// every range in between.
+// A copy of the start addresses is laid out in Eytzinger (breadth
+// first) order, so that the binary search at the heart of each
+// lookup walks memory front to back and prefetches well.
+class ElfBinary::AddressIndex {
+public:
+  // The value returned by lookups that find no entry.
+  static const size_t kNotFound = SIZE_MAX;
+
+  // The value of a link to no range.
+  static const uint32_t kNoRange = UINT32_MAX;
+
+  // Constructs an empty index.
+  AddressIndex();
+
+  // Indexes are moved rather than copied.
+  AddressIndex(const AddressIndex&) = delete;
+  AddressIndex &operator=(const AddressIndex&) = delete;
+  AddressIndex(AddressIndex&&);
+  AddressIndex &operator=(AddressIndex&&);
+
+  ~AddressIndex();
+
+  // Builds an index over the given entries, the i'th of which covers
+  // [starts[i], starts[i] + sizes[i]). Only entries for which include
+  // is non-zero, or all entries if include is nullptr, are indexed.
+  // The index is allocated from the arena.
+  AddressIndex(const uint64_t *const starts, const uint64_t *const sizes,
+               const uint8_t *const include, const size_t count,
+               Arena *const arena);
+
+  // Returns the entry starting at address, or kNotFound.
+  // Of entries sharing a start address, returns the last.
+  size_t FindStartingAt(const uint64_t address) const;
+
+  // Returns the entry that starts latest at or before address, or
+  // kNotFound if every entry starts after it. Of entries sharing a
+  // start address, returns the last.
+  size_t FindStartingAtOrBefore(const uint64_t address) const;
+
+  // Returns the entry whose range contains address, or kNotFound.
+  // Where ranges are nested, returns the innermost: the one that
+  // starts latest, and of those, the last.
+  size_t FindContaining(const uint64_t address) const;
+
+  // Looks up the entry whose range contains each of count addresses,
+  // as FindContaining, storing the results in entries. Lookups are
+  // performed in address order in one sweep over the index, which is
+  // far cheaper than count separate searches for large batches.
+  void FindContaining(const uint64_t *const addresses, const size_t count,
+                      size_t *const entries) const;
+
+  // Returns the number of entries in the index.
+  size_t size() const;
+
+  // Appends the index to writer, to be read back by Load.
+  void Serialize(CacheWriter *const writer) const;
+
+  // Reads an index over count entries that Serialize wrote from
+  // reader, allocating it from the arena. Fails the reader if it does
+  // not hold a valid index over that many entries.
+  static AddressIndex Load(CacheReader *const reader, const size_t count,
+                           Arena *const arena);
+
+private:
+  // Returns the number of indexed ranges starting at or before address.
+  size_t CountStartingAtOrBefore(const uint64_t address) const;
+
+  // Returns the innermost range containing address, given that the
+  // first rank ranges are those starting at or before address.
+  size_t FindContainingBefore(const uint64_t address, const size_t rank) const;
+
+  // Fills the Eytzinger array rooted at node with starts_[rank...],
+  // returning the rank following the last one placed.
+  size_t BuildEytzinger(size_t rank, const size_t node);
+
+  // The start addresses of the ranges, sorted.
+  ArenaVector<uint64_t> starts_;
+  // The end addresses of the ranges, in the order of starts_.
+  ArenaVector<uint64_t> ends_;
+  // The position in starts_ of the last range before each one that
+  // ends after it, or kNoRange if there is none. Following these
+  // links visits the ranges that enclose, or end after, each range.
+  ArenaVector<uint32_t> enclosing_;
+  // The entry that each range belongs to.
+  ArenaVector<uint32_t> entries_;
+  // starts_ in Eytzinger order, from index 1.
+  ArenaVector<uint64_t> eytzinger_;
+  // The position in starts_ of each element of eytzinger_.
+  ArenaVector<uint32_t> eytzinger_ranks_;
+};
+
+#endif // BINARY_MATCHER_ELF_BINARY_ADDRESS_INDEX_H
@@ -0,0 +1,204 @@
+#ifndef BINARY_MATCHER_ELF_BINARY_FIELD_H
+#define BINARY_MATCHER_ELF_BINARY_FIELD_H
+
+#include <elf.h>
+#include <stdint.h>
+#include <string.h>
+
+// Helpers for reading fields of an ELF binary.
+// The parsers are templated on the binary's class (ELFCLASS32 or
+// ELFCLASS64) and data encoding (ELFDATA2LSB or ELFDATA2MSB), so
+// that each field's offset, width and byte order are known at
+// compile time and the inner loops contain no per-field branches.
+
+// The ELF data encoding that matches the host's byte order.
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+const uint8_t kHostElfData = ELFDATA2MSB;
+#else
+const uint8_t kHostElfData = ELFDATA2LSB;
+#endif
+
+// An enumeration of the supported combinations of ELF class
+// and data encoding, used to dispatch to a specialised parser.
+enum class ElfEncoding {
+  // Unsupported class or data encoding.
+  kUnknown,
+  // ELF32, little endian.
+  k32Lsb,
+  // ELF32, big endian.
+  k32Msb,
+  // ELF64, little endian.
+  k64Lsb,
+  // ELF64, big endian.
+  k64Msb,
+};
+
+// Determines the encoding of a binary from its class and data fields.
+inline ElfEncoding GetElfEncoding(const uint8_t kClass, const uint8_t kData)
+{
+  if (kClass == ELFCLASS32 && kData == ELFDATA2LSB) {
+    return ElfEncoding::k32Lsb;
+  }
+  if (kClass == ELFCLASS32 && kData == ELFDATA2MSB) {
+    return ElfEncoding::k32Msb;
+  }
+  if (kClass == ELFCLASS64 && kData == ELFDATA2LSB) {
+    return ElfEncoding::k64Lsb;
+  }
+  if (kClass == ELFCLASS64 && kData == ELFDATA2MSB) {
+    return ElfEncoding::k64Msb;
+  }
+  return ElfEncoding::kUnknown;
+}
+
+// Set of helper methods that reverse the byte order of a value.
+
+inline uint8_t ByteSwap(const uint8_t value)
+{
+  return value;
+}
+
+inline uint16_t ByteSwap(const uint16_t value)
+{
+  return __builtin_bswap16(value);
+}
+
+inline uint32_t ByteSwap(const uint32_t value)
+{
+  return __builtin_bswap32(value);
+}
+
+inline uint64_t ByteSwap(const uint64_t value)
+{
+  return __builtin_bswap64(value);
+}
+
+// Loads a T stored with the data encoding kData from buf.
+// buf need not be suitably aligned for T.
+template <typename T, uint8_t kData>
+inline T LoadElfField(const uint8_t *const buf)
+{
+  T value;
+  memcpy(&value, buf, sizeof(value));
+  return kData == kHostElfData ? value : ByteSwap(value);
+}
+
+// Set of helper methods that check that the parts of a binary that
+// its fields refer to lie within the buffer of size bytes holding it,
+// so that a truncated or corrupt file is rejected rather than read
+// past its end.
+
+// Returns true if the length bytes at offset lie within the buffer.
+inline bool ElfRangeInBounds(const uint64_t offset, const uint64_t length,
+                             const uint64_t size)
+{
+  return offset <= size && length <= size - offset;
+}
+
+// Returns true if the table of count entries, each entry_size bytes
+// and at least min_entry_size bytes, at offset lies within the buffer.
+inline bool ElfTableInBounds(const uint64_t offset, const uint64_t count,
+                             const uint64_t entry_size,
+                             const uint64_t min_entry_size,
+                             const uint64_t size)
+{
+  return entry_size >= min_entry_size && entry_size
+      && offset <= size
+      && count <= (size - offset) / entry_size;
+}
+
+// Returns the number of bytes of the class's ELF header, program
+// header, section header, symbol table and relocation entries, the
+// least that the corresponding size fields of a valid binary can hold.
+
+inline uint64_t ElfHeaderMinSize(const uint8_t kClass)
+{
+  return kClass == ELFCLASS32 ? sizeof(Elf32_Ehdr) : sizeof(Elf64_Ehdr);
+}
+
+inline uint64_t ElfProgramHeaderMinSize(const uint8_t kClass)
+{
+  return kClass == ELFCLASS32 ? sizeof(Elf32_Phdr) : sizeof(Elf64_Phdr);
+}
+
+inline uint64_t ElfSectionHeaderMinSize(const uint8_t kClass)
+{
+  return kClass == ELFCLASS32 ? sizeof(Elf32_Shdr) : sizeof(Elf64_Shdr);
+}
+
+inline uint64_t ElfSymbolMinSize(const uint8_t kClass)
+{
+  return kClass == ELFCLASS32 ? sizeof(Elf32_Sym) : sizeof(Elf64_Sym);
+}
+
+inline uint64_t ElfRelocationMinSize(const uint8_t kClass,
+                                     const uint32_t section_type)
+{
+  if (section_type == SHT_RELA) {
+    return kClass == ELFCLASS32 ? sizeof(Elf32_Rela) : sizeof(Elf64_Rela);
+  }
+  return kClass == ELFCLASS32 ? sizeof(Elf32_Rel) : sizeof(Elf64_Rel);
+}
+
+// Locates the string table of length bytes at offset in the buffer,
+// storing in *table_size the number of its bytes up to and including
+// its last NUL. If the table lies outside the buffer or holds no NUL,
+// locates an empty table of one byte instead. Either way, a name at
+// any offset below *table_size ends within the table.
+inline const char *LocateElfStringTable(const uint8_t *const buf,
+                                        const uint64_t size,
+                                        const uint64_t offset,
+                                        uint64_t length,
+                                        uint64_t *const table_size)
+{
+  if (ElfRangeInBounds(offset, length, size)) {
+    while (length && buf[offset + length - 1]) {
+      length--;
+    }
+    if (length) {
+      *table_size = length;
+      return reinterpret_cast<const char*>(buf + offset);
+    }
+  }
+  *table_size = 1;
+  return "";
+}
+
+// Returns the offset in the buffer of size bytes of strings, a table
+// located in it by LocateElfStringTable, or size if strings is the
+// empty table located in place of one outside the buffer. Either way,
+// LocateElfStringTable locates strings again from the offset and the
+// table's size.
+inline uint64_t ElfStringTableOffset(const uint8_t *const buf,
+                                     const uint64_t size,
+                                     const char *const strings)
+{
+  const uintptr_t kStart = reinterpret_cast<uintptr_t>(buf);
+  const uintptr_t kStrings = reinterpret_cast<uintptr_t>(strings);
+  return kStrings >= kStart && kStrings - kStart < size
+      ? kStrings - kStart : size;
+}
+
+// Returns offset if it names a string in a string table of table_size
+// bytes located by LocateElfStringTable, and otherwise the offset of
+// the table's final, empty string.
+inline uint32_t ElfStringOffset(const uint32_t offset,
+                                const uint64_t table_size)
+{
+  return offset < table_size ? offset : static_cast<uint32_t>(table_size - 1);
+}
+
+// Returns the result of calling the helper extract, specialised for
+// the given encoding, on entry. Used by views, which only learn the
+// encoding at runtime, to decode a single field on demand.
+#define DECODE_ELF_FIELD(extract, encoding, entry) \
+  switch (encoding) { \
+    case ElfEncoding::k32Lsb: return extract<ELFCLASS32, ELFDATA2LSB>(entry); \
+    case ElfEncoding::k32Msb: return extract<ELFCLASS32, ELFDATA2MSB>(entry); \
+    case ElfEncoding::k64Lsb: return extract<ELFCLASS64, ELFDATA2LSB>(entry); \
+    case ElfEncoding::k64Msb: return extract<ELFCLASS64, ELFDATA2MSB>(entry); \
+    case ElfEncoding::kUnknown: /* FALLTHROUGH */ \
+    default: return 0; \
+  }
+
+#endif // BINARY_MATCHER_ELF_BINARY_FIELD_H
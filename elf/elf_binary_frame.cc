@@ -0,0 +1,500 @@
+#include "arena.h"
+#include "elf/elf_binary.h"
+#include "elf/elf_binary_field.h"
+#include "elf/elf_binary_frame.h"
+#include "elf/elf_binary_header.h"
+#include "elf/elf_binary_program_header.h"
+#include "elf/elf_binary_section_header.h"
+#include "elf/elf_binary_section_index.h"
+
+#include <algorithm>
+#include <elf.h>
+#include <iomanip>
+#include <stdint.h>
+#include <sstream>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using FrameRange = ElfBinary::FrameRange;
+using Header = ElfBinary::Header;
+using ProgramHeader = ElfBinary::ProgramHeader;
+using SectionHeader = ElfBinary::SectionHeader;
+using SectionIndex = ElfBinary::SectionIndex;
+
+namespace {
+
+// Pointer encodings (DW_EH_PE_*), which pick the format of a pointer
+// with their low bits and what it is relative to with their high bits.
+const uint8_t kPointerOmit = 0xff;
+const uint8_t kPointerFormat = 0x0f;
+const uint8_t kPointerApplication = 0x70;
+const uint8_t kPointerIndirect = 0x80;
+
+// The length that announces a 64-bit length following it.
+const uint32_t kExtendedLength = 0xffffffff;
+
+// The only version of .eh_frame_hdr.
+const uint8_t kFrameHeaderVersion = 1;
+
+// Type representing a cursor over the bytes of a section that lie at
+// address, reading fields before end. A read past end, or of a field
+// that cannot be decoded, clears ok and reads 0.
+struct FrameCursor {
+  const uint8_t *data;
+  uint64_t address;
+  uint64_t position;
+  uint64_t end;
+  bool ok;
+};
+
+// Type representing an entry of .eh_frame: a common information entry
+// (CIE) if its id is 0, and otherwise an FDE.
+struct FrameEntry {
+  // The offset of the entry's CIE id or pointer field.
+  uint64_t id_position;
+  // The entry's CIE id, or the distance from its CIE pointer field
+  // back to its CIE.
+  uint32_t id;
+  // The offset of the field following the CIE id or pointer.
+  uint64_t body;
+  // The offset of the byte following the entry.
+  uint64_t end;
+};
+
+// Reads a T stored with the data encoding kData from cursor.
+template <typename T, uint8_t kData>
+static T ReadFrameField(FrameCursor *const cursor)
+{
+  if (!cursor->ok || cursor->position > cursor->end
+      || sizeof(T) > cursor->end - cursor->position) {
+    cursor->ok = false;
+    return 0;
+  }
+  const T kValue = LoadElfField<T, kData>(cursor->data + cursor->position);
+  cursor->position += sizeof(T);
+  return kValue;
+}
+
+// Reads an unsigned LEB128 number from cursor.
+static uint64_t ReadFrameUleb128(FrameCursor *const cursor)
+{
+  uint64_t value = 0;
+  for (unsigned shift = 0; cursor->ok && cursor->position < cursor->end;
+       shift += 7) {
+    const uint8_t kByte = cursor->data[cursor->position++];
+    if (shift < 64) {
+      value |= static_cast<uint64_t>(kByte & 0x7f) << shift;
+    }
+    if (!(kByte & 0x80)) {
+      return value;
+    }
+  }
+  cursor->ok = false;
+  return 0;
+}
+
+// Reads a signed LEB128 number from cursor.
+static int64_t ReadFrameSleb128(FrameCursor *const cursor)
+{
+  uint64_t value = 0;
+  for (unsigned shift = 0; cursor->ok && cursor->position < cursor->end;
+       shift += 7) {
+    const uint8_t kByte = cursor->data[cursor->position++];
+    if (shift < 64) {
+      value |= static_cast<uint64_t>(kByte & 0x7f) << shift;
+    }
+    if (!(kByte & 0x80)) {
+      if (shift + 7 < 64 && (kByte & 0x40)) {
+        value |= ~0ULL << (shift + 7);
+      }
+      return static_cast<int64_t>(value);
+    }
+  }
+  cursor->ok = false;
+  return 0;
+}
+
+// Reads a pointer of the given encoding from cursor. Data-relative
+// pointers are relative to data_base.
+template <uint8_t kClass, uint8_t kData>
+static uint64_t ReadFramePointer(FrameCursor *const cursor,
+                                 const uint8_t encoding,
+                                 const uint64_t data_base)
+{
+  const uint64_t kFieldAddress = cursor->address + cursor->position;
+  uint64_t value = 0;
+  switch (encoding & kPointerFormat) {
+    case 0x00:
+      value = kClass == ELFCLASS64
+          ? ReadFrameField<uint64_t, kData>(cursor)
+          : ReadFrameField<uint32_t, kData>(cursor);
+      break;
+    case 0x01: value = ReadFrameUleb128(cursor); break;
+    case 0x02: value = ReadFrameField<uint16_t, kData>(cursor); break;
+    case 0x03: value = ReadFrameField<uint32_t, kData>(cursor); break;
+    case 0x04: value = ReadFrameField<uint64_t, kData>(cursor); break;
+    case 0x09:
+      value = static_cast<uint64_t>(ReadFrameSleb128(cursor));
+      break;
+    case 0x0a:
+      value = static_cast<uint64_t>(static_cast<int16_t>(
+          ReadFrameField<uint16_t, kData>(cursor)));
+      break;
+    case 0x0b:
+      value = static_cast<uint64_t>(static_cast<int32_t>(
+          ReadFrameField<uint32_t, kData>(cursor)));
+      break;
+    case 0x0c: value = ReadFrameField<uint64_t, kData>(cursor); break;
+    default:
+      cursor->ok = false;
+      return 0;
+  }
+  // Indirect pointers would have to be followed through memory that
+  // is only filled in at run time.
+  if (encoding & kPointerIndirect) {
+    cursor->ok = false;
+    return 0;
+  }
+  switch (encoding & kPointerApplication) {
+    case 0x00: break;
+    case 0x10: value += kFieldAddress; break;
+    case 0x30: value += data_base; break;
+    default:
+      cursor->ok = false;
+      return 0;
+  }
+  return kClass == ELFCLASS64 ? value : value & 0xffffffff;
+}
+
+// Reads the header of the entry of .eh_frame at offset of the given
+// cursor into entry. Returns false if it is malformed or is the
+// terminating entry of length 0.
+template <uint8_t kData>
+static bool ReadFrameEntry(const FrameCursor &section, const uint64_t offset,
+                           FrameEntry *const entry)
+{
+  FrameCursor cursor = section;
+  cursor.position = offset;
+  uint64_t length = ReadFrameField<uint32_t, kData>(&cursor);
+  if (length == kExtendedLength) {
+    length = ReadFrameField<uint64_t, kData>(&cursor);
+  }
+  if (!cursor.ok || !length || length > cursor.end - cursor.position) {
+    return false;
+  }
+  entry->end = cursor.position + length;
+  entry->id_position = cursor.position;
+  entry->id = ReadFrameField<uint32_t, kData>(&cursor);
+  entry->body = cursor.position;
+  return cursor.ok && entry->body <= entry->end;
+}
+
+// Returns the encoding of the pointers in the FDEs that refer to the
+// CIE at offset of section, or kPointerOmit if it cannot be read.
+template <uint8_t kClass, uint8_t kData>
+static uint8_t ReadCieEncoding(const FrameCursor &section,
+                               const uint64_t offset)
+{
+  FrameEntry entry;
+  if (!ReadFrameEntry<kData>(section, offset, &entry) || entry.id) {
+    return kPointerOmit;
+  }
+  FrameCursor cursor = section;
+  cursor.position = entry.body;
+  cursor.end = entry.end;
+  const uint8_t kVersion = ReadFrameField<uint8_t, kData>(&cursor);
+  const char *const kAugmentation
+      = reinterpret_cast<const char *>(cursor.data + cursor.position);
+  const void *const kTerminator
+      = memchr(kAugmentation, '\0', cursor.end - cursor.position);
+  if (!cursor.ok || !kTerminator || strstr(kAugmentation, "eh")) {
+    return kPointerOmit;
+  }
+  cursor.position += strlen(kAugmentation) + 1;
+  ReadFrameUleb128(&cursor);
+  ReadFrameSleb128(&cursor);
+  if (kVersion == 1) {
+    ReadFrameField<uint8_t, kData>(&cursor);
+  } else {
+    ReadFrameUleb128(&cursor);
+  }
+  // Without augmentation data, pointers are absolute.
+  uint8_t encoding = 0;
+  if (kAugmentation[0] != 'z') {
+    return cursor.ok ? encoding : kPointerOmit;
+  }
+  ReadFrameUleb128(&cursor);
+  for (const char *c = kAugmentation + 1; *c && cursor.ok; c++) {
+    if (*c == 'R') {
+      encoding = ReadFrameField<uint8_t, kData>(&cursor);
+    } else if (*c == 'L') {
+      ReadFrameField<uint8_t, kData>(&cursor);
+    } else if (*c == 'P') {
+      // Only the personality routine's size matters here.
+      const uint8_t kPersonality = ReadFrameField<uint8_t, kData>(&cursor);
+      ReadFramePointer<kClass, kData>(
+          &cursor, static_cast<uint8_t>(kPersonality & kPointerFormat), 0);
+    } else if (*c != 'S' && *c != 'B' && *c != 'G') {
+      break;
+    }
+  }
+  return cursor.ok ? encoding : kPointerOmit;
+}
+
+// Reads the range described by the FDE at offset of section into
+// ranges, looking up the encoding of its CIE in encodings, or reading
+// it into them. Returns false if there is no valid entry at offset.
+template <uint8_t kClass, uint8_t kData>
+static bool ReadFdeRange(const FrameCursor &section, const uint64_t offset,
+                         std::unordered_map<uint64_t, uint8_t> *const
+                             encodings,
+                         ArenaVector<FrameRange> *const ranges)
+{
+  FrameEntry entry;
+  if (!ReadFrameEntry<kData>(section, offset, &entry)) {
+    return false;
+  }
+  if (!entry.id || entry.id > entry.id_position) {
+    return true;
+  }
+  const uint64_t kCie = entry.id_position - entry.id;
+  const auto kFound = encodings->find(kCie);
+  const uint8_t kEncoding = kFound != encodings->end() ? kFound->second
+      : (*encodings)[kCie] = ReadCieEncoding<kClass, kData>(section, kCie);
+  if (kEncoding == kPointerOmit) {
+    return true;
+  }
+
+  FrameCursor cursor = section;
+  cursor.position = entry.body;
+  cursor.end = entry.end;
+  const uint64_t kStart
+      = ReadFramePointer<kClass, kData>(&cursor, kEncoding, 0);
+  const uint64_t kSize = ReadFramePointer<kClass, kData>(
+      &cursor, static_cast<uint8_t>(kEncoding & kPointerFormat), 0);
+  if (cursor.ok && kSize) {
+    ranges->push_back(FrameRange{kStart, kSize});
+  }
+  return true;
+}
+
+// Returns a cursor over the contents of the given section, which is
+// not ok if it has none in the buffer.
+static FrameCursor SectionCursor(const uint8_t *const buf,
+                                 const uint64_t size,
+                                 const SectionHeader &section)
+{
+  const bool kInFile = section.kType != SHT_NOBITS
+      && ElfRangeInBounds(section.kOffset, section.kSize, size);
+  return FrameCursor{
+    kInFile ? buf + section.kOffset : buf,
+    section.kAddress,
+    0,
+    kInFile ? section.kSize : 0,
+    kInFile,
+  };
+}
+
+// Returns a cursor over the bytes of the given segment from address
+// to the end of its contents in the file, which is not ok if address
+// does not lie within them, or they do not lie within the buffer.
+static FrameCursor SegmentCursor(const uint8_t *const buf,
+                                 const uint64_t size,
+                                 const ProgramHeader &segment,
+                                 const uint64_t address)
+{
+  const bool kInFile
+      = ElfRangeInBounds(segment.kOffset, segment.kFileSize, size)
+      && address >= segment.kVirtualAddress
+      && address - segment.kVirtualAddress < segment.kFileSize;
+  const uint64_t kSkipped = address - segment.kVirtualAddress;
+  return FrameCursor{
+    kInFile ? buf + segment.kOffset + kSkipped : buf,
+    address,
+    0,
+    kInFile ? segment.kFileSize - kSkipped : 0,
+    kInFile,
+  };
+}
+
+// Returns a cursor over the first section of the given name, which is
+// not ok if there is none.
+static FrameCursor
+LocateFrameSection(const uint8_t *const buf,
+                   const uint64_t size,
+                   const ArenaVector<SectionHeader> &section_headers,
+                   const SectionIndex &section_index,
+                   const char *const name)
+{
+  const size_t kSection = section_index.Find(name);
+  return kSection == SectionIndex::kNotFound
+      ? FrameCursor{buf, 0, 0, 0, false}
+      : SectionCursor(buf, size, section_headers[kSection]);
+}
+
+// Returns a cursor over the first segment of the given type, which is
+// not ok if there is none.
+static FrameCursor
+LocateFrameSegment(const uint8_t *const buf,
+                   const uint64_t size,
+                   const ArenaVector<ProgramHeader> &program_headers,
+                   const uint32_t type)
+{
+  for (const ProgramHeader &segment : program_headers) {
+    if (segment.kType == type) {
+      return SegmentCursor(buf, size, segment, segment.kVirtualAddress);
+    }
+  }
+  return FrameCursor{buf, 0, 0, 0, false};
+}
+
+// Returns a cursor over the loaded bytes from address to the end of
+// the PT_LOAD segment containing it, which is not ok if there is none.
+static FrameCursor
+LocateLoadedAddress(const uint8_t *const buf,
+                    const uint64_t size,
+                    const ArenaVector<ProgramHeader> &program_headers,
+                    const uint64_t address)
+{
+  for (const ProgramHeader &segment : program_headers) {
+    if (segment.kType != PT_LOAD) {
+      continue;
+    }
+    const FrameCursor kCursor = SegmentCursor(buf, size, segment, address);
+    if (kCursor.ok) {
+      return kCursor;
+    }
+  }
+  return FrameCursor{buf, 0, 0, 0, false};
+}
+
+// Parses the FDE ranges of a binary of the given class and data
+// encoding. See ParseElfFrameRanges.
+template <uint8_t kClass, uint8_t kData>
+static ArenaVector<FrameRange>
+DecodeElfFrameRanges(const uint8_t *const buf,
+                     const uint64_t size,
+                     const ArenaVector<ProgramHeader> &program_headers,
+                     const ArenaVector<SectionHeader> &section_headers,
+                     const SectionIndex &section_index,
+                     Arena *const arena)
+{
+  ArenaVector<FrameRange> ranges{ArenaAllocator<FrameRange>(arena)};
+
+  // .eh_frame_hdr holds the address of .eh_frame, and a binary search
+  // table listing the address of each FDE, ordered by the start of its
+  // range. Both are found through the segments that load them if the
+  // section headers were stripped too.
+  FrameCursor cursor = LocateFrameSection(buf, size, section_headers,
+                                          section_index, ".eh_frame_hdr");
+  if (!cursor.ok) {
+    cursor = LocateFrameSegment(buf, size, program_headers,
+                                PT_GNU_EH_FRAME);
+  }
+  const uint8_t kVersion = ReadFrameField<uint8_t, kData>(&cursor);
+  const uint8_t kFramesEncoding = ReadFrameField<uint8_t, kData>(&cursor);
+  const uint8_t kCountEncoding = ReadFrameField<uint8_t, kData>(&cursor);
+  const uint8_t kTableEncoding = ReadFrameField<uint8_t, kData>(&cursor);
+  const uint64_t kFramesAddress = ReadFramePointer<kClass, kData>(
+      &cursor, kFramesEncoding, cursor.address);
+  const uint64_t kCount = kCountEncoding == kPointerOmit ? 0
+      : ReadFramePointer<kClass, kData>(&cursor, kCountEncoding,
+                                        cursor.address);
+  const bool kHeaderOk = cursor.ok && kVersion == kFrameHeaderVersion;
+
+  FrameCursor frames = LocateFrameSection(buf, size, section_headers,
+                                          section_index, ".eh_frame");
+  if (!frames.ok && kHeaderOk) {
+    frames = LocateLoadedAddress(buf, size, program_headers,
+                                 kFramesAddress);
+  }
+  if (!frames.ok) {
+    return ranges;
+  }
+  std::unordered_map<uint64_t, uint8_t> encodings;
+
+  if (kHeaderOk && kTableEncoding != kPointerOmit && kCount
+      && kCount <= (cursor.end - cursor.position) / 2) {
+    ranges.reserve(kCount);
+    for (uint64_t i = 0; i < kCount && cursor.ok; i++) {
+      ReadFramePointer<kClass, kData>(&cursor, kTableEncoding,
+                                      cursor.address);
+      const uint64_t kEntry = ReadFramePointer<kClass, kData>(
+          &cursor, kTableEncoding, cursor.address);
+      if (cursor.ok && kEntry >= frames.address) {
+        ReadFdeRange<kClass, kData>(frames, kEntry - frames.address,
+                                    &encodings, &ranges);
+      }
+    }
+    if (cursor.ok) {
+      return ranges;
+    }
+    ranges.clear();
+  }
+
+  // Failing that, every entry of .eh_frame is visited in turn, and
+  // the ranges are ordered once all are found.
+  ArenaVector<FrameRange> found{ArenaAllocator<FrameRange>(arena)};
+  FrameEntry entry;
+  for (uint64_t offset = 0; ReadFrameEntry<kData>(frames, offset, &entry);
+       offset = entry.end) {
+    ReadFdeRange<kClass, kData>(frames, offset, &encodings, &found);
+  }
+  std::vector<size_t> order(found.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&found](const size_t a, const size_t b) {
+    return found[a].kStart < found[b].kStart;
+  });
+  ranges.reserve(found.size());
+  for (const size_t i : order) {
+    ranges.push_back(found[i]);
+  }
+  return ranges;
+}
+
+} // namespace
+
+ArenaVector<FrameRange>
+ParseElfFrameRanges(const uint8_t *const buf,
+                    const uint64_t size,
+                    const Header *const header,
+                    const ArenaVector<ProgramHeader> &program_headers,
+                    const ArenaVector<SectionHeader> &section_headers,
+                    const SectionIndex &section_index,
+                    Arena *const arena)
+{
+  if (header->kType == ET_REL) {
+    return ArenaVector<FrameRange>(ArenaAllocator<FrameRange>(arena));
+  }
+  switch (GetElfEncoding(header->kClass, header->kData)) {
+    case ElfEncoding::k32Lsb:
+      return DecodeElfFrameRanges<ELFCLASS32, ELFDATA2LSB>(
+          buf, size, program_headers, section_headers, section_index, arena);
+    case ElfEncoding::k32Msb:
+      return DecodeElfFrameRanges<ELFCLASS32, ELFDATA2MSB>(
+          buf, size, program_headers, section_headers, section_index, arena);
+    case ElfEncoding::k64Lsb:
+      return DecodeElfFrameRanges<ELFCLASS64, ELFDATA2LSB>(
+          buf, size, program_headers, section_headers, section_index, arena);
+    case ElfEncoding::k64Msb:
+      return DecodeElfFrameRanges<ELFCLASS64, ELFDATA2MSB>(
+          buf, size, program_headers, section_headers, section_index, arena);
+    case ElfEncoding::kUnknown: // FALLTHROUGH
+    default:
+      return ArenaVector<FrameRange>(ArenaAllocator<FrameRange>(arena));
+  }
+}
+
+std::string FrameRange::ToString() const
+{
+  std::stringstream res;
+  res << std::hex << std::setfill('0')
+      << "0x" << std::setw(8) << kStart
+      << "-0x" << std::setw(8) << kStart + kSize;
+  return res.str();
+}
@@ -0,0 +1,49 @@
+#ifndef BINARY_MATCHER_ELF_BINARY_FRAME_H
+#define BINARY_MATCHER_ELF_BINARY_FRAME_H
+
+#include "arena.h"
+#include "elf/elf_binary.h"
+#include "elf/elf_binary_header.h"
+#include "elf/elf_binary_program_header.h"
+#include "elf/elf_binary_section_header.h"
+#include "elf/elf_binary_section_index.h"
+
+#include <stdint.h>
+#include <string>
+
+// Type that represents the range of code described by a frame
+// description entry (FDE) of .eh_frame. The compiler emits one for
+// each function that may be unwound through, so they outline the
+// functions of a binary even once its symbols are stripped.
+struct ElfBinary::FrameRange {
+  // The address of the first instruction described.
+  const uint64_t kStart;
+  // The number of bytes of instructions described.
+  const uint64_t kSize;
+
+  // Constructs a string representation of the range.
+  std::string ToString() const;
+};
+
+// Parses the ranges described by the FDEs of .eh_frame from the buffer
+// of size bytes into the arena, ordered by start address. The FDEs are
+// found through the binary search table of .eh_frame_hdr, if the
+// binary has one, and otherwise by walking .eh_frame. Without section
+// headers, .eh_frame_hdr is found through the PT_GNU_EH_FRAME segment,
+// and .eh_frame through the address it holds.
+// Relocatable objects have none: their ranges are left to relocations.
+// Entries that are malformed, lie outside the buffer, or use pointer
+// encodings other than absolute, PC-relative and (in .eh_frame_hdr)
+// data-relative ones are skipped, as are empty ranges.
+ArenaVector<ElfBinary::FrameRange>
+ParseElfFrameRanges(const uint8_t *const buf,
+                    const uint64_t size,
+                    const ElfBinary::Header *const header,
+                    const ArenaVector<ElfBinary::ProgramHeader>
+                        &program_headers,
+                    const ArenaVector<ElfBinary::SectionHeader>
+                        &section_headers,
+                    const ElfBinary::SectionIndex &section_index,
+                    Arena *const arena);
+
+#endif // BINARY_MATCHER_ELF_BINARY_FRAME_H
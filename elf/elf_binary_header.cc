@@ -1,4 +1,6 @@
+#include "arena.h"
 #include "elf/elf_binary.h"
+#include "elf/elf_binary_field.h"
 #include "elf/elf_binary_header.h"
 
 #include <elf.h>
@@ -8,161 +10,206 @@
 using Header = ElfBinary::Header;
 
 #define EXTRACT_ELF_FIELD(bits, offset) \
-  *(reinterpret_cast<const uint##bits##_t*>(buf+(offset)))
+  LoadElfField<uint##bits##_t, kData>(buf+(offset))
 
 namespace {
 
 // Set of helper methods that extract fields from
-// the buffer.
+// the buffer, specialised on the binary's class and data encoding.
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint8_t
 ExtractElfHeaderClass(const uint8_t *const buf)
 {
   return EXTRACT_ELF_FIELD(8, 4);
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint8_t
 ExtractElfHeaderData(const uint8_t *const buf)
 {
   return EXTRACT_ELF_FIELD(8, 5);
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint8_t
 ExtractElfHeaderShortVersion(const uint8_t *const buf)
 {
   return EXTRACT_ELF_FIELD(8, 6);
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint8_t
 ExtractElfHeaderOsAbi(const uint8_t *const buf)
 {
   return EXTRACT_ELF_FIELD(8, 7);
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint8_t
 ExtractElfHeaderAbiVersion(const uint8_t *const buf)
 {
   return EXTRACT_ELF_FIELD(8, 8);
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint16_t
 ExtractElfHeaderType(const uint8_t *const buf)
 {
   return EXTRACT_ELF_FIELD(16, EI_NIDENT);
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint16_t
 ExtractElfHeaderMachine(const uint8_t *const buf)
 {
   return EXTRACT_ELF_FIELD(16, EI_NIDENT+2);
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint32_t
 ExtractElfHeaderLongVersion(const uint8_t *const buf)
 {
   return EXTRACT_ELF_FIELD(32, EI_NIDENT+4);
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint64_t
 ExtractElfHeaderEntryPoint(const uint8_t *const buf)
 {
-  switch (ExtractElfHeaderClass(buf)) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, EI_NIDENT+8);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(64, EI_NIDENT+8);
     default: return ~0ULL;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint64_t
 ExtractElfHeaderProgramHeaderOffset(const uint8_t *const buf)
 {
-  switch (ExtractElfHeaderClass(buf)) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, EI_NIDENT+12);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(64, EI_NIDENT+16);
     default: return ~0ULL;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint64_t
 ExtractElfHeaderSectionHeaderOffset(const uint8_t *const buf)
 {
-  switch (ExtractElfHeaderClass(buf)) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, EI_NIDENT+16);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(64, EI_NIDENT+24);
     default: return ~0ULL;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint32_t
 ExtractElfHeaderFlags(const uint8_t *const buf)
 {
-  switch (ExtractElfHeaderClass(buf)) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, EI_NIDENT+20);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(32, EI_NIDENT+32);
     default: return ~0U;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint16_t
 ExtractElfHeaderHeaderSize(const uint8_t *const buf)
 {
-  switch (ExtractElfHeaderClass(buf)) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(16, EI_NIDENT+24);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(16, EI_NIDENT+36);
     default: return 0xFFFF;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint16_t
 ExtractElfHeaderProgramHeaderSize(const uint8_t *const buf)
 {
-  switch (ExtractElfHeaderClass(buf)) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(16, EI_NIDENT+26);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(16, EI_NIDENT+38);
     default: return 0xFFFF;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint16_t
 ExtractElfHeaderProgramHeaderCount(const uint8_t *const buf)
 {
-  switch (ExtractElfHeaderClass(buf)) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(16, EI_NIDENT+28);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(16, EI_NIDENT+40);
     default: return 0xFFFF;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint16_t
 ExtractElfHeaderSectionHeaderSize(const uint8_t *const buf)
 {
-  switch (ExtractElfHeaderClass(buf)) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(16, EI_NIDENT+30);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(16, EI_NIDENT+42);
     default: return 0xFFFF;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint16_t
 ExtractElfHeaderSectionHeaderCount(const uint8_t *const buf)
 {
-  switch (ExtractElfHeaderClass(buf)) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(16, EI_NIDENT+32);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(16, EI_NIDENT+44);
     default: return 0xFFFF;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint16_t
 ExtractElfHeaderSectionHeaderNamesIndex(const uint8_t *const buf)
 {
-  switch (ExtractElfHeaderClass(buf)) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(16, EI_NIDENT+34);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(16, EI_NIDENT+46);
     default: return 0xFFFF;
   }
 }
 
+// Parses an ELF header of the given class and data encoding
+// from the buffer into the arena.
+template <uint8_t kClass, uint8_t kData>
+static Header *DecodeElfHeader(const uint8_t *const buf, Arena *const arena)
+{
+  return arena->New<Header>(Header{
+    ExtractElfHeaderClass<kClass, kData>(buf),
+    ExtractElfHeaderData<kClass, kData>(buf),
+    ExtractElfHeaderShortVersion<kClass, kData>(buf),
+    ExtractElfHeaderOsAbi<kClass, kData>(buf),
+    ExtractElfHeaderAbiVersion<kClass, kData>(buf),
+    ExtractElfHeaderType<kClass, kData>(buf),
+    ExtractElfHeaderMachine<kClass, kData>(buf),
+    ExtractElfHeaderLongVersion<kClass, kData>(buf),
+    ExtractElfHeaderEntryPoint<kClass, kData>(buf),
+    ExtractElfHeaderProgramHeaderOffset<kClass, kData>(buf),
+    ExtractElfHeaderSectionHeaderOffset<kClass, kData>(buf),
+    ExtractElfHeaderFlags<kClass, kData>(buf),
+    ExtractElfHeaderHeaderSize<kClass, kData>(buf),
+    ExtractElfHeaderProgramHeaderSize<kClass, kData>(buf),
+    ExtractElfHeaderProgramHeaderCount<kClass, kData>(buf),
+    ExtractElfHeaderSectionHeaderSize<kClass, kData>(buf),
+    ExtractElfHeaderSectionHeaderCount<kClass, kData>(buf),
+    ExtractElfHeaderSectionHeaderNamesIndex<kClass, kData>(buf),
+  });
+}
+
 // Set of helper methods that validate individual fields.
 
 inline static bool
@@ -433,28 +480,26 @@ bool ValidElfHeader(const Header *const head)
   return true;
 }
 
-Header *ParseElfHeader(const uint8_t *const buf)
-{
-  return new Header {
-    ExtractElfHeaderClass(buf),
-    ExtractElfHeaderData(buf),
-    ExtractElfHeaderShortVersion(buf),
-    ExtractElfHeaderOsAbi(buf),
-    ExtractElfHeaderAbiVersion(buf),
-    ExtractElfHeaderType(buf),
-    ExtractElfHeaderMachine(buf),
-    ExtractElfHeaderLongVersion(buf),
-    ExtractElfHeaderEntryPoint(buf),
-    ExtractElfHeaderProgramHeaderOffset(buf),
-    ExtractElfHeaderSectionHeaderOffset(buf),
-    ExtractElfHeaderFlags(buf),
-    ExtractElfHeaderHeaderSize(buf),
-    ExtractElfHeaderProgramHeaderSize(buf),
-    ExtractElfHeaderProgramHeaderCount(buf),
-    ExtractElfHeaderSectionHeaderSize(buf),
-    ExtractElfHeaderSectionHeaderCount(buf),
-    ExtractElfHeaderSectionHeaderNamesIndex(buf),
-  };
+Header *ParseElfHeader(const uint8_t *const buf, const uint64_t size,
+                       Arena *const arena)
+{
+  if (size < EI_NIDENT || size < ElfHeaderMinSize(buf[EI_CLASS])) {
+    return nullptr;
+  }
+  switch (GetElfEncoding(buf[EI_CLASS], buf[EI_DATA])) {
+    case ElfEncoding::k32Lsb:
+      return DecodeElfHeader<ELFCLASS32, ELFDATA2LSB>(buf, arena);
+    case ElfEncoding::k32Msb:
+      return DecodeElfHeader<ELFCLASS32, ELFDATA2MSB>(buf, arena);
+    case ElfEncoding::k64Lsb:
+      return DecodeElfHeader<ELFCLASS64, ELFDATA2LSB>(buf, arena);
+    case ElfEncoding::k64Msb:
+      return DecodeElfHeader<ELFCLASS64, ELFDATA2MSB>(buf, arena);
+    case ElfEncoding::kUnknown: // FALLTHROUGH
+    default:
+      // Decode what we can, so that validation reports the problem.
+      return DecodeElfHeader<ELFCLASSNONE, kHostElfData>(buf, arena);
+  }
 }
 
 std::string Header::ToString() const
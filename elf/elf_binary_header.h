@@ -1,6 +1,7 @@
 #ifndef BINARY_MATCHER_ELF_BINARY_HEADER_H
 #define BINARY_MATCHER_ELF_BINARY_HEADER_H
 
+#include "arena.h"
 #include "elf/elf_binary.h"
 
 #include <stdint.h>
@@ -109,9 +110,11 @@ struct ElfBinary::Header {
 // Validates that the given header is a valid ELF header.
 bool ValidElfHeader(const ElfBinary::Header *const head);
 
-// Parses an ELF header from the given buffer.
-// Returns nullptr on failure.
-ElfBinary::Header *ParseElfHeader(const uint8_t *const buf);
+// Parses an ELF header from the given buffer of size bytes into the
+// arena. Returns nullptr if the buffer is too small to hold one.
+ElfBinary::Header *ParseElfHeader(const uint8_t *const buf,
+                                  const uint64_t size,
+                                  Arena *const arena);
 
 
 #endif // BINARY_MATCHER_ELF_BINARY_HEADER_H
@@ -0,0 +1,301 @@
+#include "binary_cache.h"
+#include "elf/elf_binary_name_index.h"
+#include "thread_pool.h"
+
+#include <stddef.h>
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using NameIndex = ElfBinary::NameIndex;
+
+namespace {
+
+// The number of slots in a group.
+const size_t kGroupSize = 16;
+
+// Indexes of fewer entries than this are built as a single shard.
+const size_t kShardThreshold = 1 << 16;
+
+// The most shards that an index is split into.
+const unsigned kMaxShardBits = 8;
+
+// The control byte of a slot that holds no entry.
+// Tags only use the low 7 bits, so can never equal kEmpty.
+const uint8_t kEmpty = 0x80;
+
+// Returns the tag stored in the control byte of a name's slot.
+inline static uint8_t HashTag(const uint64_t hash)
+{
+  return static_cast<uint8_t>(hash & 0x7F);
+}
+
+// Returns the shard that a name belongs to, given the number of top
+// bits of its hash that select a shard.
+inline static size_t HashShard(const uint64_t hash, const unsigned shard_bits)
+{
+  return shard_bits ? static_cast<size_t>(hash >> (64 - shard_bits)) : 0;
+}
+
+// Returns the group within its shard that probing for a name starts at.
+inline static size_t HashGroup(const uint64_t hash, const size_t group_mask)
+{
+  return static_cast<size_t>(hash >> 7) & group_mask;
+}
+
+// Returns a bitmask with bit i set if the i'th control byte
+// of the group equals value.
+inline static uint32_t MatchGroup(const uint8_t *const group,
+                                  const uint8_t value)
+{
+#if defined(__SSE2__)
+  const __m128i kControl
+      = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+  const __m128i kValue = _mm_set1_epi8(static_cast<char>(value));
+  return static_cast<uint32_t>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(kControl, kValue)));
+#else
+  uint32_t mask = 0;
+  for (unsigned i = 0; i < kGroupSize; i++) {
+    if (group[i] == value) {
+      mask |= 1U << i;
+    }
+  }
+  return mask;
+#endif
+}
+
+// Mixes the bits of a partially computed hash.
+inline static uint64_t MixHash(const uint64_t hash)
+{
+  const uint64_t kMixed = hash * 0x9E3779B97F4A7C15ULL;
+  return kMixed ^ (kMixed >> 29);
+}
+
+} // namespace
+
+const size_t NameIndex::kNotFound;
+
+NameIndex::NameIndex(NameIndex&&) = default;
+
+NameIndex &NameIndex::operator=(NameIndex&&) = default;
+
+NameIndex::~NameIndex() { }
+
+uint64_t NameIndex::Hash(const char *const name)
+{
+  const size_t kLength = strlen(name);
+  uint64_t hash = MixHash(kLength);
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= kLength; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, name + i, sizeof(word));
+    hash = MixHash(hash ^ word);
+  }
+  uint64_t tail = 0;
+  memcpy(&tail, name + i, kLength - i);
+  hash = MixHash(hash ^ tail);
+  // Finalize so that both the tag and group bits depend on every byte.
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+NameIndex::NameIndex()
+  : control_(kGroupSize, kEmpty),
+    slots_(kGroupSize, 0),
+    group_mask_(0),
+    shard_bits_(0) { }
+
+NameIndex::NameIndex(const char *const strings,
+                     const uint32_t *const offsets,
+                     const size_t count,
+                     Arena *const arena)
+  : control_(ArenaAllocator<uint8_t>(arena)),
+    slots_(ArenaAllocator<uint32_t>(arena)),
+    group_mask_(0),
+    shard_bits_(0)
+{
+  ThreadPool *const pool = ThreadPool::Default();
+  // Use a power of two shards, at least one per thread, for large
+  // indexes. The input is split into as many chunks for partitioning.
+  if (count >= kShardThreshold) {
+    while (shard_bits_ < kMaxShardBits
+           && (size_t{1} << shard_bits_) < pool->concurrency()) {
+      shard_bits_++;
+    }
+  }
+  const size_t kShards = size_t{1} << shard_bits_;
+  const size_t kChunks = kShards;
+
+  // Hash each chunk's names, counting those that fall in each shard.
+  std::vector<uint64_t> hashes(count);
+  std::vector<size_t> positions(kChunks * kShards, 0);
+  pool->ParallelFor(kChunks, [&](const size_t chunk) {
+    size_t *const counts = &positions[chunk * kShards];
+    for (size_t i = count * chunk / kChunks;
+         i < count * (chunk + 1) / kChunks; i++) {
+      const char *const kName = strings + offsets[i];
+      if (*kName) {
+        hashes[i] = Hash(kName);
+        counts[HashShard(hashes[i], shard_bits_)]++;
+      }
+    }
+  });
+
+  // Turn the counts into each chunk's starting position in each
+  // shard's run of entries, which are ordered by chunk and so by
+  // entry number.
+  std::vector<size_t> shard_starts(kShards + 1, 0);
+  size_t position = 0;
+  for (size_t shard = 0; shard < kShards; shard++) {
+    shard_starts[shard] = position;
+    for (size_t chunk = 0; chunk < kChunks; chunk++) {
+      const size_t kCount = positions[chunk * kShards + shard];
+      positions[chunk * kShards + shard] = position;
+      position += kCount;
+    }
+  }
+  shard_starts[kShards] = position;
+
+  // Size each shard for a load factor of at most 7/8 for the fullest,
+  // so that every probe sequence reaches an empty slot.
+  size_t largest = 0;
+  for (size_t shard = 0; shard < kShards; shard++) {
+    largest = std::max(largest, shard_starts[shard + 1] - shard_starts[shard]);
+  }
+  size_t groups = 1;
+  while (groups * kGroupSize * 7 < largest * 8) {
+    groups *= 2;
+  }
+  group_mask_ = groups - 1;
+  control_.assign(kShards * groups * kGroupSize, kEmpty);
+  slots_.assign(kShards * groups * kGroupSize, 0);
+
+  // Partition the entries by shard.
+  std::vector<uint32_t> entries(position);
+  pool->ParallelFor(kChunks, [&](const size_t chunk) {
+    size_t *const next = &positions[chunk * kShards];
+    for (size_t i = count * chunk / kChunks;
+         i < count * (chunk + 1) / kChunks; i++) {
+      if (strings[offsets[i]]) {
+        entries[next[HashShard(hashes[i], shard_bits_)]++]
+            = static_cast<uint32_t>(i);
+      }
+    }
+  });
+
+  // Fill each shard on its own thread. Shards occupy disjoint groups,
+  // so no locking is needed. Insert in reverse so that, of entries
+  // sharing a name, the last is the first one probing finds.
+  pool->ParallelFor(kShards, [&](const size_t shard) {
+    for (size_t i = shard_starts[shard + 1]; i-- > shard_starts[shard];) {
+      Insert(entries[i], hashes[entries[i]]);
+    }
+  });
+}
+
+size_t NameIndex::ShardBase(const uint64_t hash) const
+{
+  return HashShard(hash, shard_bits_) * (group_mask_ + 1);
+}
+
+void NameIndex::Insert(const uint32_t entry, const uint64_t hash)
+{
+  const size_t kBase = ShardBase(hash);
+  size_t group = HashGroup(hash, group_mask_);
+  for (size_t step = 1; ; step++) {
+    uint8_t *const control = &control_[(kBase + group) * kGroupSize];
+    const uint32_t kEmpties = MatchGroup(control, kEmpty);
+    if (kEmpties) {
+      const size_t kSlot = static_cast<size_t>(__builtin_ctz(kEmpties));
+      control[kSlot] = HashTag(hash);
+      slots_[(kBase + group) * kGroupSize + kSlot] = entry;
+      return;
+    }
+    group = (group + step) & group_mask_;
+  }
+}
+
+size_t NameIndex::Find(const char *const name,
+                       const char *const strings,
+                       const uint32_t *const offsets) const
+{
+  return Find(name, Hash(name), strings, offsets);
+}
+
+size_t NameIndex::Find(const char *const name,
+                       const uint64_t hash,
+                       const char *const strings,
+                       const uint32_t *const offsets) const
+{
+  const uint8_t kTag = HashTag(hash);
+  const size_t kBase = ShardBase(hash);
+  size_t group = HashGroup(hash, group_mask_);
+  // Probing visits each group of the shard at most once.
+  for (size_t step = 1; step <= group_mask_ + 1; step++) {
+    const uint8_t *const control = &control_[(kBase + group) * kGroupSize];
+    uint32_t matches = MatchGroup(control, kTag);
+    while (matches) {
+      const size_t kSlot = static_cast<size_t>(__builtin_ctz(matches));
+      const uint32_t kEntry = slots_[(kBase + group) * kGroupSize + kSlot];
+      if (!strcmp(strings + offsets[kEntry], name)) {
+        return kEntry;
+      }
+      matches &= matches - 1;
+    }
+    if (MatchGroup(control, kEmpty)) {
+      return kNotFound;
+    }
+    group = (group + step) & group_mask_;
+  }
+  return kNotFound;
+}
+
+size_t NameIndex::MemoryUsage() const
+{
+  return control_.size() * sizeof(control_[0])
+      + slots_.size() * sizeof(slots_[0]);
+}
+
+void NameIndex::Serialize(CacheWriter *const writer) const
+{
+  writer->Write<uint64_t>(group_mask_);
+  writer->Write<uint32_t>(shard_bits_);
+  writer->WriteArray(control_);
+  writer->WriteArray(slots_);
+}
+
+NameIndex NameIndex::Load(CacheReader *const reader, const size_t count,
+                          Arena *const arena)
+{
+  NameIndex index;
+  index.group_mask_ = reader->Read<uint64_t>(UINT32_MAX);
+  index.shard_bits_ = reader->Read<uint32_t>(kMaxShardBits + 1);
+  index.control_ = reader->ReadArray<uint8_t>(arena);
+  index.slots_ = reader->ReadArray<uint32_t>(arena);
+
+  // Probing relies on the table's shape, and trusts every occupied
+  // slot to hold an entry.
+  const size_t kSlots = (index.group_mask_ + 1) * kGroupSize
+      << index.shard_bits_;
+  if (index.group_mask_ & (index.group_mask_ + 1)
+      || index.control_.size() != kSlots
+      || index.slots_.size() != kSlots) {
+    reader->Fail();
+    return NameIndex();
+  }
+  for (size_t i = 0; i < kSlots; i++) {
+    if (index.control_[i] != kEmpty && index.slots_[i] >= count) {
+      reader->Fail();
+      return NameIndex();
+    }
+  }
+  return index;
+}
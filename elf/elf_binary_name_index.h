@@ -0,0 +1,91 @@
+#ifndef BINARY_MATCHER_ELF_BINARY_NAME_INDEX_H
+#define BINARY_MATCHER_ELF_BINARY_NAME_INDEX_H
+
+#include "arena.h"
+#include "binary_cache.h"
+#include "elf/elf_binary.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Type that represents a hash index from names to the entries that
+// carry them, where each entry's name is an offset into a string table
+// (e.g. symbols into .strtab or .dynstr).
+// Names are never copied: the index is an open-addressing table that
+// holds only each entry's number and a 7 bit tag of its name's hash,
+// and candidate names are compared in place in the string table.
+// Tags are stored in groups of 16 bytes so that a whole group is
+// probed with one vector comparison.
+// Large indexes are split into shards by the top bits of each name's
+// hash, each an independent table in its own range of groups, so that
+// every shard is built by a single thread without locking.
+class ElfBinary::NameIndex {
+public:
+  // The value returned by lookups that find no entry.
+  static const size_t kNotFound = SIZE_MAX;
+
+  // Hashes a name. Callers performing many lookups of the same name
+  // can hash it once and use the overload of Find that takes a hash.
+  static uint64_t Hash(const char *const name);
+
+  // Constructs an empty index.
+  NameIndex();
+
+  // Indexes are moved rather than copied.
+  NameIndex(const NameIndex&) = delete;
+  NameIndex &operator=(const NameIndex&) = delete;
+  NameIndex(NameIndex&&);
+  NameIndex &operator=(NameIndex&&);
+
+  ~NameIndex();
+
+  // Builds an index over count entries, the i'th of which is named
+  // strings + offsets[i], allocating the index from the arena.
+  // Entries with empty names are not indexed.
+  // Where several entries share a name, lookups return the last.
+  // Large indexes are built in parallel on the default thread pool;
+  // the result does not depend on the number of threads.
+  NameIndex(const char *const strings, const uint32_t *const offsets,
+            const size_t count, Arena *const arena);
+
+  // Returns the number of the entry named name, or kNotFound.
+  // strings and offsets must be those the index was built over.
+  size_t Find(const char *const name, const char *const strings,
+              const uint32_t *const offsets) const;
+
+  // As above, given name's precomputed hash.
+  size_t Find(const char *const name, const uint64_t hash,
+              const char *const strings, const uint32_t *const offsets) const;
+
+  // Returns the number of bytes of memory the index occupies.
+  size_t MemoryUsage() const;
+
+  // Appends the index to writer, to be read back by Load.
+  void Serialize(CacheWriter *const writer) const;
+
+  // Reads an index over count entries that Serialize wrote from
+  // reader, allocating it from the arena. Fails the reader if it does
+  // not hold a valid index over that many entries.
+  static NameIndex Load(CacheReader *const reader, const size_t count,
+                        Arena *const arena);
+
+private:
+  // Returns the first group of the shard that a name's hash selects.
+  size_t ShardBase(const uint64_t hash) const;
+
+  // Inserts entry, whose name has the given hash.
+  void Insert(const uint32_t entry, const uint64_t hash);
+
+  // One control byte per slot: either kEmpty or the tag of the
+  // name of the entry in that slot.
+  ArenaVector<uint8_t> control_;
+  // The entry held in each slot.
+  ArenaVector<uint32_t> slots_;
+  // The number of 16 slot groups in each shard, minus one. Always a
+  // power of two minus one, so that it masks a hash into a group.
+  size_t group_mask_;
+  // The number of top bits of a hash that select its shard.
+  unsigned shard_bits_;
+};
+
+#endif // BINARY_MATCHER_ELF_BINARY_NAME_INDEX_H
@@ -0,0 +1,209 @@
+#include "arena.h"
+#include "elf/elf_binary.h"
+#include "elf/elf_binary_field.h"
+#include "elf/elf_binary_header.h"
+#include "elf/elf_binary_note.h"
+#include "elf/elf_binary_program_header.h"
+#include "elf/elf_binary_section_header.h"
+
+#include <elf.h>
+#include <iomanip>
+#include <stdint.h>
+#include <sstream>
+#include <string.h>
+#include <vector>
+
+using Header = ElfBinary::Header;
+using Note = ElfBinary::Note;
+using ProgramHeader = ElfBinary::ProgramHeader;
+using SectionHeader = ElfBinary::SectionHeader;
+
+#define EXTRACT_ELF_FIELD(bits, offset) \
+  LoadElfField<uint##bits##_t, kData>(buf+(offset))
+
+namespace {
+
+// The size of the fixed part of a note, the same in both classes.
+const uint64_t kNoteHeaderSize = sizeof(Elf64_Nhdr);
+
+// Set of helper methods that extract fields from
+// the buffer, specialised on the binary's class and data encoding.
+
+template <uint8_t kClass, uint8_t kData>
+inline static uint32_t ExtractElfNoteNameSize(const uint8_t *const buf)
+{
+  return EXTRACT_ELF_FIELD(32, 0);
+}
+
+template <uint8_t kClass, uint8_t kData>
+inline static uint32_t
+ExtractElfNoteDescriptionSize(const uint8_t *const buf)
+{
+  return EXTRACT_ELF_FIELD(32, 4);
+}
+
+template <uint8_t kClass, uint8_t kData>
+inline static uint32_t ExtractElfNoteType(const uint8_t *const buf)
+{
+  return EXTRACT_ELF_FIELD(32, 8);
+}
+
+// Returns offset rounded up to a multiple of alignment, a power of two.
+inline static uint64_t AlignElfNoteField(const uint64_t offset,
+                                         const uint64_t alignment)
+{
+  return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+// Converts a note's type into a string. Types are only meaningful
+// relative to the note's owner.
+inline static const char *ElfNoteTypeString(const char *const owner,
+                                            const uint32_t kType)
+{
+  if (strcmp(owner, "GNU")) {
+    return "UNKNOWN";
+  }
+  switch (kType) {
+    case NT_GNU_ABI_TAG: return "GNU_ABI_TAG";
+    case NT_GNU_HWCAP: return "GNU_HWCAP";
+    case NT_GNU_BUILD_ID: return "GNU_BUILD_ID";
+    case NT_GNU_GOLD_VERSION: return "GNU_GOLD_VERSION";
+    case NT_GNU_PROPERTY_TYPE_0: return "GNU_PROPERTY_TYPE_0";
+    default: return "UNKNOWN";
+  }
+}
+
+// Appends the notes in the length bytes at offset in the buffer,
+// each of whose names and descriptions is padded to a multiple of
+// alignment from the start of the bytes, to notes.
+template <uint8_t kClass, uint8_t kData>
+static void DecodeElfNotes(const uint8_t *const buf,
+                           const uint64_t buf_size,
+                           const uint64_t offset,
+                           const uint64_t length,
+                           const uint64_t alignment,
+                           ArenaVector<Note> *const notes)
+{
+  if (!ElfRangeInBounds(offset, length, buf_size)) {
+    return;
+  }
+  const uint8_t *const kStart = buf + offset;
+  uint64_t i = 0;
+  while (length - i >= kNoteHeaderSize) {
+    const uint8_t *const entry = kStart + i;
+    const uint64_t kNameSize = ExtractElfNoteNameSize<kClass, kData>(entry);
+    const uint64_t kDescriptionSize
+        = ExtractElfNoteDescriptionSize<kClass, kData>(entry);
+    const uint64_t kNameOffset = i + kNoteHeaderSize;
+    const uint64_t kDescriptionOffset
+        = AlignElfNoteField(kNameOffset + kNameSize, alignment);
+    if (kDescriptionOffset > length
+        || kDescriptionSize > length - kDescriptionOffset) {
+      return;
+    }
+    // An owner's name must end within the space given for it.
+    const char *const kName = reinterpret_cast<const char*>(
+        kStart + kNameOffset);
+    const bool kNamed = kNameSize && !kName[kNameSize - 1];
+    notes->push_back(Note{
+      kNamed ? kName : "",
+      ExtractElfNoteType<kClass, kData>(entry),
+      kStart + kDescriptionOffset,
+      kDescriptionSize,
+    });
+    i = AlignElfNoteField(kDescriptionOffset + kDescriptionSize, alignment);
+    if (i > length) {
+      return;
+    }
+  }
+}
+
+// Parses the notes of a binary of the given class
+// and data encoding from the buffer.
+template <uint8_t kClass, uint8_t kData>
+static ArenaVector<Note>
+DecodeElfNotes(const uint8_t *const buf,
+               const uint64_t buf_size,
+               const ArenaVector<ProgramHeader> &program_headers,
+               const ArenaVector<SectionHeader> &section_headers,
+               Arena *const arena)
+{
+  ArenaVector<Note> notes{ArenaAllocator<Note>(arena)};
+
+  // Notes in segments are padded to 8 bytes only if the segment is
+  // aligned to 8 (e.g. those holding NT_GNU_PROPERTY_TYPE_0), and to 4
+  // bytes otherwise, whatever the class.
+  bool segments = false;
+  for (const ProgramHeader &program_header : program_headers) {
+    if (program_header.kType != PT_NOTE) {
+      continue;
+    }
+    segments = true;
+    DecodeElfNotes<kClass, kData>(
+        buf, buf_size, program_header.kOffset, program_header.kFileSize,
+        program_header.kAlign == 8 ? 8 : 4, &notes);
+  }
+  if (segments) {
+    return notes;
+  }
+  for (const SectionHeader &section_header : section_headers) {
+    if (section_header.kType != SHT_NOTE) {
+      continue;
+    }
+    DecodeElfNotes<kClass, kData>(
+        buf, buf_size, section_header.kOffset, section_header.kSize,
+        section_header.kAddressAlignment == 8 ? 8 : 4, &notes);
+  }
+  return notes;
+}
+
+} // namespace
+
+#undef EXTRACT_ELF_FIELD
+
+ArenaVector<Note>
+ParseElfNotes(const uint8_t *const buf,
+              const uint64_t size,
+              const Header *const header,
+              const ArenaVector<ProgramHeader> &program_headers,
+              const ArenaVector<SectionHeader> &section_headers,
+              Arena *const arena)
+{
+  switch (GetElfEncoding(header->kClass, header->kData)) {
+    case ElfEncoding::k32Lsb:
+      return DecodeElfNotes<ELFCLASS32, ELFDATA2LSB>(
+          buf, size, program_headers, section_headers, arena);
+    case ElfEncoding::k32Msb:
+      return DecodeElfNotes<ELFCLASS32, ELFDATA2MSB>(
+          buf, size, program_headers, section_headers, arena);
+    case ElfEncoding::k64Lsb:
+      return DecodeElfNotes<ELFCLASS64, ELFDATA2LSB>(
+          buf, size, program_headers, section_headers, arena);
+    case ElfEncoding::k64Msb:
+      return DecodeElfNotes<ELFCLASS64, ELFDATA2MSB>(
+          buf, size, program_headers, section_headers, arena);
+    case ElfEncoding::kUnknown: // FALLTHROUGH
+    default:
+      return ArenaVector<Note>(ArenaAllocator<Note>(arena));
+  }
+}
+
+std::string Note::DescriptionString() const
+{
+  std::stringstream res;
+  res << std::hex << std::setfill('0');
+  for (uint64_t i = 0; i < kDescriptionSize; i++) {
+    res << std::setw(2) << static_cast<unsigned>(kDescription[i]);
+  }
+  return res.str();
+}
+
+std::string Note::ToString() const
+{
+  std::stringstream res;
+  res << "\n  Owner:           " << kOwner
+      << "\n  Type:            " << ElfNoteTypeString(kOwner, kType)
+      << "\n  DescriptionSize: " << kDescriptionSize
+      << "\n  Description:     " << DescriptionString();
+  return res.str();
+}
@@ -0,0 +1,55 @@
+#ifndef BINARY_MATCHER_ELF_BINARY_NOTE_H
+#define BINARY_MATCHER_ELF_BINARY_NOTE_H
+
+#include "arena.h"
+#include "elf/elf_binary.h"
+#include "elf/elf_binary_header.h"
+#include "elf/elf_binary_program_header.h"
+#include "elf/elf_binary_section_header.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Type that represents an ELF note: a typed description, qualified by
+// the name of its owner, carried in a PT_NOTE segment or SHT_NOTE
+// section. The owner and description are used in place in the
+// binary's buffer.
+struct ElfBinary::Note {
+  // The name of the note's owner (e.g. "GNU"), or "" if it has none.
+  const char *const kOwner;
+  // The type of the note, whose meaning depends on its owner.
+  // Potential values for owner "GNU" and their meanings are:
+  //  NT_GNU_ABI_TAG:         The ABI the binary targets.
+  //  NT_GNU_HWCAP:           Synthetic hardware capabilities.
+  //  NT_GNU_BUILD_ID:        A unique identifier of the build.
+  //  NT_GNU_GOLD_VERSION:    The version of gold that linked the binary.
+  //  NT_GNU_PROPERTY_TYPE_0: Program properties.
+  const uint32_t kType;
+  // The description of the note.
+  const uint8_t *const kDescription;
+  // The number of bytes in the description.
+  const uint64_t kDescriptionSize;
+
+  // Constructs a string of the description's bytes in hexadecimal.
+  std::string DescriptionString() const;
+
+  // Constructs a string representation of the note
+  // that contains all of the information in the above fields.
+  std::string ToString() const;
+};
+
+// Parses the notes of a binary from the given buffer of size bytes
+// into the arena. Notes are read from its PT_NOTE segments or, if it
+// has none (e.g. a relocatable object), from its SHT_NOTE sections.
+// A note that does not lie within its segment or section ends the
+// notes read from it.
+ArenaVector<ElfBinary::Note>
+ParseElfNotes(const uint8_t *const buf,
+              const uint64_t size,
+              const ElfBinary::Header *const header,
+              const ArenaVector<ElfBinary::ProgramHeader> &program_headers,
+              const ArenaVector<ElfBinary::SectionHeader> &section_headers,
+              Arena *const arena);
+
+#endif // BINARY_MATCHER_ELF_BINARY_NOTE_H
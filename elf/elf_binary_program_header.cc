@@ -1,4 +1,6 @@
+#include "arena.h"
 #include "elf/elf_binary.h"
+#include "elf/elf_binary_field.h"
 #include "elf/elf_binary_header.h"
 #include "elf/elf_binary_program_header.h"
 
@@ -12,91 +14,91 @@ using Header = ElfBinary::Header;
 using ProgramHeader = ElfBinary::ProgramHeader;
 
 #define EXTRACT_ELF_FIELD(bits, offset) \
-  *(reinterpret_cast<const uint##bits##_t*>(buf+(offset)))
+  LoadElfField<uint##bits##_t, kData>(buf+(offset))
 
 namespace {
 
 // Set of helper methods that extract fields from
-// the buffer.
+// the buffer, specialised on the binary's class and data encoding.
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint32_t
-ExtractElfProgramHeaderType(const uint8_t *const buf,
-    const Header *const)
+ExtractElfProgramHeaderType(const uint8_t *const buf)
 {
   return EXTRACT_ELF_FIELD(32, 0);
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint32_t
-ExtractElfProgramHeaderFlags(const uint8_t *const buf,
-    const Header *const header)
+ExtractElfProgramHeaderFlags(const uint8_t *const buf)
 {
-  switch (header->kClass) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, 24);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(32, 4);
     default: return ~0U;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint64_t
-ExtractElfProgramHeaderOffset(const uint8_t *const buf,
-    const Header *const header)
+ExtractElfProgramHeaderOffset(const uint8_t *const buf)
 {
-  switch (header->kClass) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, 4);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(64, 8);
     default: return ~0ULL;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint64_t
-ExtractElfProgramHeaderVirtualAddress(const uint8_t *const buf,
-    const Header *const header)
+ExtractElfProgramHeaderVirtualAddress(const uint8_t *const buf)
 {
-  switch (header->kClass) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, 8);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(64, 16);
     default: return ~0ULL;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint64_t
-ExtractElfProgramHeaderPhysicalAddress(const uint8_t *const buf,
-    const Header *const header)
+ExtractElfProgramHeaderPhysicalAddress(const uint8_t *const buf)
 {
-  switch (header->kClass) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, 12);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(64, 24);
     default: return ~0ULL;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint64_t
-ExtractElfProgramHeaderFileSize(const uint8_t *const buf,
-    const Header *const header)
+ExtractElfProgramHeaderFileSize(const uint8_t *const buf)
 {
-  switch (header->kClass) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, 16);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(64, 32);
     default: return ~0ULL;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint64_t
-ExtractElfProgramHeaderMemorySize(const uint8_t *const buf,
-    const Header *const header)
+ExtractElfProgramHeaderMemorySize(const uint8_t *const buf)
 {
-  switch (header->kClass) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, 20);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(64, 40);
     default: return ~0ULL;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint64_t
-ExtractElfProgramHeaderAlign(const uint8_t *const buf,
-    const Header *const header)
+ExtractElfProgramHeaderAlign(const uint8_t *const buf)
 {
-  switch (header->kClass) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, 28);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(64, 48);
     default: return ~0ULL;
@@ -121,6 +123,7 @@ ValidElfProgramHeaderType(const uint32_t kType)
     case PT_GNU_STACK: return true;
     case PT_GNU_EH_FRAME: return true;
     case PT_GNU_RELRO: return true;
+    case PT_GNU_PROPERTY: return true;
     case PT_TLS: return true;
     default: break;
   }
@@ -145,11 +148,11 @@ ValidElfProgramHeaderFlags(const uint32_t kFlags)
   return false;
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint32_t
-ExtractElfSectionHeaderInfo(const uint8_t *const buf,
-    const Header *const header)
+ExtractElfSectionHeaderInfo(const uint8_t *const buf)
 {
-  switch (header->kClass) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, 28);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(32, 44);
     default: return ~0u;
@@ -174,6 +177,7 @@ inline static const char
     case PT_GNU_STACK: return "GNU_STACK";
     case PT_GNU_EH_FRAME: return "GNU_EH_FRAME";
     case PT_GNU_RELRO: return "GNU_RELRO";
+    case PT_GNU_PROPERTY: return "GNU_PROPERTY";
     case PT_TLS: return "TLS";
     default: return "UNKNOWN";
   }
@@ -194,6 +198,60 @@ inline static const char
   }
 }
 
+// Parses the program headers of a binary of the given class
+// and data encoding from the buffer.
+template <uint8_t kClass, uint8_t kData>
+static ArenaVector<ProgramHeader>
+DecodeElfProgramHeaders(const uint8_t *const buf,
+                       const uint64_t buf_size,
+                       const Header *const header,
+                       Arena *const arena)
+{
+  const uint64_t kOffset = header->kProgramHeaderOffset;
+  const uint64_t kSize = header->kProgramHeaderSize;
+  uint64_t count = header->kProgramHeaderCount;
+  if (!kOffset || !count) {
+    return ArenaVector<ProgramHeader>(ArenaAllocator<ProgramHeader>(arena));
+  }
+  ArenaVector<ProgramHeader> program_headers{
+      ArenaAllocator<ProgramHeader>(arena)};
+
+  // If count == PN_XNUM, we have to get the count from the section header.
+  if (count == PN_XNUM) {
+    if (!ElfTableInBounds(header->kSectionHeaderOffset, 1,
+                          header->kSectionHeaderSize,
+                          ElfSectionHeaderMinSize(kClass), buf_size)) {
+      return program_headers;
+    }
+    const uint8_t *const section_header_base
+        = buf + header->kSectionHeaderOffset;
+    count = ExtractElfSectionHeaderInfo<kClass, kData>(section_header_base);
+  }
+
+  if (!ElfTableInBounds(kOffset, count, kSize,
+                        ElfProgramHeaderMinSize(kClass), buf_size)) {
+    return program_headers;
+  }
+  const uint8_t *const program_header = buf + kOffset;
+
+  program_headers.reserve(count);
+  for (unsigned i = 0; i < count; i++) {
+    const uint8_t *const entry = program_header + i*kSize;
+    program_headers.push_back(ProgramHeader{
+      ExtractElfProgramHeaderType<kClass, kData>(entry),
+      ExtractElfProgramHeaderFlags<kClass, kData>(entry),
+      ExtractElfProgramHeaderOffset<kClass, kData>(entry),
+      ExtractElfProgramHeaderVirtualAddress<kClass, kData>(entry),
+      ExtractElfProgramHeaderPhysicalAddress<kClass, kData>(entry),
+      ExtractElfProgramHeaderFileSize<kClass, kData>(entry),
+      ExtractElfProgramHeaderMemorySize<kClass, kData>(entry),
+      ExtractElfProgramHeaderAlign<kClass, kData>(entry),
+    });
+  }
+
+  return program_headers;
+}
+
 } // namespace
 
 #undef EXTRACT_ELF_FIELD
@@ -211,40 +269,28 @@ bool ValidElfProgramHeader(const ProgramHeader &program_header)
   return true;
 }
 
-std::vector<ProgramHeader> ParseElfProgramHeaders(const uint8_t *const buf,
-                                                  const Header *const header)
+ArenaVector<ProgramHeader> ParseElfProgramHeaders(const uint8_t *const buf,
+                                                  const uint64_t size,
+                                                  const Header *const header,
+                                                  Arena *const arena)
 {
-  const uint64_t kOffset = header->kProgramHeaderOffset;
-  const uint64_t kSize = header->kProgramHeaderSize;
-  uint64_t count = header->kProgramHeaderCount;
-  if (!kOffset || !count) {
-    return std::vector<ProgramHeader>();
-  }
-  std::vector<ProgramHeader> program_headers;
-
-  const uint8_t *program_header = buf + kOffset;
-
-  // If count == PN_XNUM, we have to get the count from the section header.
-  if (count == PN_XNUM) {
-    const uint8_t *const section_header_base
-        = buf + header->kSectionHeaderOffset;
-    count = ExtractElfSectionHeaderInfo(section_header_base, header);
+  switch (GetElfEncoding(header->kClass, header->kData)) {
+    case ElfEncoding::k32Lsb:
+      return DecodeElfProgramHeaders<ELFCLASS32, ELFDATA2LSB>(
+          buf, size, header, arena);
+    case ElfEncoding::k32Msb:
+      return DecodeElfProgramHeaders<ELFCLASS32, ELFDATA2MSB>(
+          buf, size, header, arena);
+    case ElfEncoding::k64Lsb:
+      return DecodeElfProgramHeaders<ELFCLASS64, ELFDATA2LSB>(
+          buf, size, header, arena);
+    case ElfEncoding::k64Msb:
+      return DecodeElfProgramHeaders<ELFCLASS64, ELFDATA2MSB>(
+          buf, size, header, arena);
+    case ElfEncoding::kUnknown: // FALLTHROUGH
+    default:
+      return ArenaVector<ProgramHeader>(ArenaAllocator<ProgramHeader>(arena));
   }
-
-  for (unsigned i = 0; i < count; i++) {
-    program_headers.push_back(std::move(ProgramHeader{
-      ExtractElfProgramHeaderType(program_header + i*kSize, header),
-      ExtractElfProgramHeaderFlags(program_header + i*kSize, header),
-      ExtractElfProgramHeaderOffset(program_header + i*kSize, header),
-      ExtractElfProgramHeaderVirtualAddress(program_header + i*kSize, header),
-      ExtractElfProgramHeaderPhysicalAddress(program_header + i*kSize, header),
-      ExtractElfProgramHeaderFileSize(program_header + i*kSize, header),
-      ExtractElfProgramHeaderMemorySize(program_header + i*kSize, header),
-      ExtractElfProgramHeaderAlign(program_header + i*kSize, header)
-    }));
-  }
-
-  return program_headers;
 }
 
 std::string ProgramHeader::ToString() const
@@ -1,6 +1,7 @@
 #ifndef BINARY_MATCHER_ELF_BINARY_PROGRAM_HEADER_H
 #define BINARY_MATCHER_ELF_BINARY_PROGRAM_HEADER_H
 
+#include "arena.h"
 #include "elf/elf_binary.h"
 #include "elf/elf_binary_header.h"
 
@@ -24,6 +25,7 @@ struct ElfBinary::ProgramHeader {
   //  PT_GNU_STACK:    GNU Extension.
   //  PT_GNU_EH_FRAME: GNU Extension.
   //  PT_GNU_RELRO:    GNU Extension.
+  //  PT_GNU_PROPERTY: GNU Extension.
   //  PT_TLS:          Thread local storage.
   const uint32_t kType;
   // A bitmask giving the segment's properties.
@@ -56,10 +58,13 @@ struct ElfBinary::ProgramHeader {
 // Validates that the given program header is a valid ELF program header.
 bool ValidElfProgramHeader(const ElfBinary::ProgramHeader &program_header);
 
-// Parses the ELF program headers from the given buffer.
-// Returns an empty vector on failure.
-std::vector<ElfBinary::ProgramHeader>
+// Parses the ELF program headers from the given buffer of size bytes
+// into the arena. Returns an empty vector on failure, including when
+// the program header table does not lie within the buffer.
+ArenaVector<ElfBinary::ProgramHeader>
 ParseElfProgramHeaders(const uint8_t *const buf,
-                       const ElfBinary::Header *const header);
+                       const uint64_t size,
+                       const ElfBinary::Header *const header,
+                       Arena *const arena);
 
 #endif // BINARY_MATCHER_ELF_BINARY_PROGRAM_HEADER_H
@@ -0,0 +1,273 @@
+#include "arena.h"
+#include "elf/elf_binary.h"
+#include "elf/elf_binary_field.h"
+#include "elf/elf_binary_header.h"
+#include "elf/elf_binary_relocation.h"
+#include "elf/elf_binary_section_header.h"
+
+#include <elf.h>
+#include <iomanip>
+#include <stdint.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using Header = ElfBinary::Header;
+using Relocation = ElfBinary::Relocation;
+using SectionHeader = ElfBinary::SectionHeader;
+
+#define EXTRACT_ELF_FIELD(bits, offset) \
+  LoadElfField<uint##bits##_t, kData>(buf+(offset))
+
+namespace {
+
+// Set of helper methods that extract fields from
+// the buffer, specialised on the binary's class and data encoding.
+
+template <uint8_t kClass, uint8_t kData>
+inline static uint64_t ExtractElfRelocationOffset(const uint8_t *const buf)
+{
+  switch (kClass) {
+    case ELFCLASS32: return EXTRACT_ELF_FIELD(32, 0);
+    case ELFCLASS64: return EXTRACT_ELF_FIELD(64, 0);
+    default: return ~0ULL;
+  }
+}
+
+template <uint8_t kClass, uint8_t kData>
+inline static uint32_t ExtractElfRelocationType(const uint8_t *const buf)
+{
+  switch (kClass) {
+    case ELFCLASS32: return ELF32_R_TYPE(EXTRACT_ELF_FIELD(32, 4));
+    case ELFCLASS64:
+      return static_cast<uint32_t>(ELF64_R_TYPE(EXTRACT_ELF_FIELD(64, 8)));
+    default: return 0;
+  }
+}
+
+template <uint8_t kClass, uint8_t kData>
+inline static uint32_t ExtractElfRelocationSymbol(const uint8_t *const buf)
+{
+  switch (kClass) {
+    case ELFCLASS32: return ELF32_R_SYM(EXTRACT_ELF_FIELD(32, 4));
+    case ELFCLASS64:
+      return static_cast<uint32_t>(ELF64_R_SYM(EXTRACT_ELF_FIELD(64, 8)));
+    default: return 0;
+  }
+}
+
+template <uint8_t kClass, uint8_t kData>
+inline static int64_t ExtractElfRelocationAddend(const uint8_t *const buf)
+{
+  switch (kClass) {
+    case ELFCLASS32:
+      return static_cast<int32_t>(EXTRACT_ELF_FIELD(32, 8));
+    case ELFCLASS64:
+      return static_cast<int64_t>(EXTRACT_ELF_FIELD(64, 16));
+    default: return 0;
+  }
+}
+
+// Parses the count relocations of entry_size bytes each at table,
+// which carry addends if addends is true.
+template <uint8_t kClass, uint8_t kData>
+static ArenaVector<Relocation>
+DecodeElfRelocations(const uint8_t *const table,
+                     const uint64_t count,
+                     const uint64_t entry_size,
+                     const bool addends,
+                     Arena *const arena)
+{
+  ArenaVector<Relocation> relocations{ArenaAllocator<Relocation>(arena)};
+  relocations.reserve(static_cast<size_t>(count));
+  for (uint64_t i = 0; i < count; i++) {
+    const uint8_t *const entry = table + i * entry_size;
+    relocations.push_back(Relocation{
+      ExtractElfRelocationOffset<kClass, kData>(entry),
+      ExtractElfRelocationType<kClass, kData>(entry),
+      ExtractElfRelocationSymbol<kClass, kData>(entry),
+      addends ? ExtractElfRelocationAddend<kClass, kData>(entry) : 0,
+    });
+  }
+  return relocations;
+}
+
+// Set of helper methods that return the width of the place patched by
+// each machine's relocations. See ElfRelocationWidth.
+
+inline static uint64_t ElfX86_64RelocationWidth(const uint32_t type)
+{
+  switch (type) {
+    case R_X86_64_64:
+    case R_X86_64_GLOB_DAT:
+    case R_X86_64_JUMP_SLOT:
+    case R_X86_64_RELATIVE:
+    case R_X86_64_DTPMOD64:
+    case R_X86_64_DTPOFF64:
+    case R_X86_64_TPOFF64:
+    case R_X86_64_PC64:
+    case R_X86_64_GOTOFF64:
+    case R_X86_64_GOT64:
+    case R_X86_64_GOTPCREL64:
+    case R_X86_64_GOTPC64:
+    case R_X86_64_GOTPLT64:
+    case R_X86_64_PLTOFF64:
+    case R_X86_64_SIZE64:
+    case R_X86_64_IRELATIVE:
+    case R_X86_64_RELATIVE64:
+      return 8;
+    case R_X86_64_PC32:
+    case R_X86_64_GOT32:
+    case R_X86_64_PLT32:
+    case R_X86_64_GOTPCREL:
+    case R_X86_64_32:
+    case R_X86_64_32S:
+    case R_X86_64_TLSGD:
+    case R_X86_64_TLSLD:
+    case R_X86_64_DTPOFF32:
+    case R_X86_64_GOTTPOFF:
+    case R_X86_64_TPOFF32:
+    case R_X86_64_GOTPC32:
+    case R_X86_64_SIZE32:
+    case R_X86_64_GOTPC32_TLSDESC:
+    case R_X86_64_GOTPCRELX:
+    case R_X86_64_REX_GOTPCRELX:
+      return 4;
+    case R_X86_64_16:
+    case R_X86_64_PC16:
+      return 2;
+    case R_X86_64_8:
+    case R_X86_64_PC8:
+      return 1;
+    case R_X86_64_TLSDESC:
+      return 16;
+    default:
+      return 0;
+  }
+}
+
+inline static uint64_t ElfI386RelocationWidth(const uint32_t type)
+{
+  switch (type) {
+    case R_386_16:
+    case R_386_PC16:
+      return 2;
+    case R_386_8:
+    case R_386_PC8:
+      return 1;
+    case R_386_NONE:
+    case R_386_COPY:
+    case R_386_TLS_GD_PUSH:
+    case R_386_TLS_GD_CALL:
+    case R_386_TLS_GD_POP:
+    case R_386_TLS_LDM_PUSH:
+    case R_386_TLS_LDM_CALL:
+    case R_386_TLS_LDM_POP:
+    case R_386_TLS_DESC_CALL:
+      return 0;
+    case R_386_TLS_DESC:
+      return 8;
+    default:
+      return type < R_386_NUM ? 4 : 0;
+  }
+}
+
+inline static uint64_t ElfAArch64RelocationWidth(const uint32_t type)
+{
+  switch (type) {
+    case R_AARCH64_ABS64:
+    case R_AARCH64_PREL64:
+    case R_AARCH64_GOTREL64:
+    case R_AARCH64_GLOB_DAT:
+    case R_AARCH64_JUMP_SLOT:
+    case R_AARCH64_RELATIVE:
+    case R_AARCH64_TLS_DTPMOD:
+    case R_AARCH64_TLS_DTPREL:
+    case R_AARCH64_TLS_TPREL:
+    case R_AARCH64_IRELATIVE:
+      return 8;
+    case R_AARCH64_ABS32:
+    case R_AARCH64_PREL32:
+    case R_AARCH64_GOTREL32:
+      return 4;
+    case R_AARCH64_ABS16:
+    case R_AARCH64_PREL16:
+      return 2;
+    case R_AARCH64_TLSDESC:
+      return 16;
+    default:
+      // Every other static relocation patches an instruction.
+      return (type >= R_AARCH64_MOVW_UABS_G0
+              && type <= R_AARCH64_LD64_GOTPAGE_LO15)
+          || (type >= R_AARCH64_TLSGD_ADR_PREL21
+              && type <= R_AARCH64_TLSLD_LDST128_DTPREL_LO12_NC)
+          ? 4 : 0;
+  }
+}
+
+} // namespace
+
+#undef EXTRACT_ELF_FIELD
+
+ArenaVector<Relocation>
+ParseElfRelocations(const uint8_t *const buf,
+                    const uint64_t size,
+                    const Header *const header,
+                    const SectionHeader &section_header,
+                    Arena *const arena)
+{
+  const uint32_t kType = section_header.kType;
+  const uint64_t kEntrySize = section_header.kEntrySize;
+  if ((kType != SHT_REL && kType != SHT_RELA) || !kEntrySize
+      || !ElfTableInBounds(section_header.kOffset,
+                           section_header.kSize / kEntrySize, kEntrySize,
+                           ElfRelocationMinSize(header->kClass, kType),
+                           size)) {
+    return ArenaVector<Relocation>(ArenaAllocator<Relocation>(arena));
+  }
+
+  const uint8_t *const kTable = buf + section_header.kOffset;
+  const uint64_t kCount = section_header.kSize / kEntrySize;
+  const bool kAddends = kType == SHT_RELA;
+  switch (GetElfEncoding(header->kClass, header->kData)) {
+    case ElfEncoding::k32Lsb:
+      return DecodeElfRelocations<ELFCLASS32, ELFDATA2LSB>(
+          kTable, kCount, kEntrySize, kAddends, arena);
+    case ElfEncoding::k32Msb:
+      return DecodeElfRelocations<ELFCLASS32, ELFDATA2MSB>(
+          kTable, kCount, kEntrySize, kAddends, arena);
+    case ElfEncoding::k64Lsb:
+      return DecodeElfRelocations<ELFCLASS64, ELFDATA2LSB>(
+          kTable, kCount, kEntrySize, kAddends, arena);
+    case ElfEncoding::k64Msb:
+      return DecodeElfRelocations<ELFCLASS64, ELFDATA2MSB>(
+          kTable, kCount, kEntrySize, kAddends, arena);
+    case ElfEncoding::kUnknown: // FALLTHROUGH
+    default:
+      return ArenaVector<Relocation>(ArenaAllocator<Relocation>(arena));
+  }
+}
+
+uint64_t ElfRelocationWidth(const uint16_t machine, const uint32_t type)
+{
+  switch (machine) {
+    case EM_X86_64: return ElfX86_64RelocationWidth(type);
+    case EM_386: return ElfI386RelocationWidth(type);
+    case EM_AARCH64: return ElfAArch64RelocationWidth(type);
+    default: return 0;
+  }
+}
+
+std::string Relocation::ToString() const
+{
+  std::stringstream res;
+  res << std::hex
+      << "Offset: 0x"
+      << std::setw(8) << std::setfill('0')
+      << kOffset << '\n'
+      << std::dec
+      << "  Type:   " << kType << '\n'
+      << "  Symbol: " << kSymbol << '\n'
+      << "  Addend: " << kAddend << '\n';
+  return res.str();
+}
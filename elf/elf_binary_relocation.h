@@ -0,0 +1,55 @@
+#ifndef BINARY_MATCHER_ELF_BINARY_RELOCATION_H
+#define BINARY_MATCHER_ELF_BINARY_RELOCATION_H
+
+#include "arena.h"
+#include "elf/elf_binary.h"
+#include "elf/elf_binary_header.h"
+#include "elf/elf_binary_section_header.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Type that represents an ELF relocation: an instruction to the linker
+// or loader to patch the bytes at some place with the address of a
+// symbol, carried in an SHT_REL or SHT_RELA section.
+struct ElfBinary::Relocation {
+  // The place patched. In a relocatable object, its offset within the
+  // section that the relocation section applies to; elsewhere, its
+  // address.
+  const uint64_t kOffset;
+  // The type of the relocation, whose meaning depends on the machine.
+  // It determines how many bytes are patched (see ElfRelocationWidth).
+  const uint32_t kType;
+  // The index of the symbol whose address is patched in, within the
+  // symbol table the relocation section links to, or 0 for none.
+  const uint32_t kSymbol;
+  // The constant added to the symbol's address. Only SHT_RELA
+  // sections carry one; an SHT_REL section's is held in the bytes at
+  // the place patched, and is 0 here.
+  const int64_t kAddend;
+
+  // Constructs a string representation of the relocation
+  // that contains all of the information in the above fields.
+  std::string ToString() const;
+};
+
+// Parses the relocations of the given SHT_REL or SHT_RELA section from
+// the buffer of size bytes into the arena. Returns an empty vector if
+// the section is of any other type, or its entries are too small or
+// lie outside the buffer.
+ArenaVector<ElfBinary::Relocation>
+ParseElfRelocations(const uint8_t *const buf,
+                    const uint64_t size,
+                    const ElfBinary::Header *const header,
+                    const ElfBinary::SectionHeader &section_header,
+                    Arena *const arena);
+
+// Returns the number of bytes at the place patched by a relocation of
+// the given type on the given machine, or 0 if it patches none (e.g.
+// R_X86_64_COPY) or the type is not known. Relocations of AArch64
+// instructions patch a field of the instruction; the whole of it is
+// counted. Only x86-64, i386 and AArch64 relocations are known.
+uint64_t ElfRelocationWidth(const uint16_t machine, const uint32_t type);
+
+#endif // BINARY_MATCHER_ELF_BINARY_RELOCATION_H
@@ -1,4 +1,6 @@
+#include "arena.h"
 #include "elf/elf_binary.h"
+#include "elf/elf_binary_field.h"
 #include "elf/elf_binary_header.h"
 #include "elf/elf_binary_section_header.h"
 
@@ -9,111 +11,113 @@
 
 using Header = ElfBinary::Header;
 using SectionHeader = ElfBinary::SectionHeader;
+using SectionHeaderView = ElfBinary::SectionHeaderView;
+using SectionHeaderRange = ElfBinary::SectionHeaderRange;
 
 #define EXTRACT_ELF_FIELD(bits, offset) \
-  *(reinterpret_cast<const uint##bits##_t*>(buf+(offset)))
+  LoadElfField<uint##bits##_t, kData>(buf+(offset))
 
 namespace {
 
 // Set of helper methods that extract fields from
-// the buffer.
+// the buffer, specialised on the binary's class and data encoding.
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint32_t
-ExtractElfSectionHeaderName(const uint8_t *const buf,
-    const Header *const)
+ExtractElfSectionHeaderName(const uint8_t *const buf)
 {
   return EXTRACT_ELF_FIELD(32, 0);
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint32_t
-ExtractElfSectionHeaderType(const uint8_t *const buf,
-    const Header *const)
+ExtractElfSectionHeaderType(const uint8_t *const buf)
 {
   return EXTRACT_ELF_FIELD(32, 4);
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint64_t
-ExtractElfSectionHeaderFlags(const uint8_t *const buf,
-    const Header *const header)
+ExtractElfSectionHeaderFlags(const uint8_t *const buf)
 {
-  switch (header->kClass) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, 8);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(64, 8);
     default: return ~0ULL;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint64_t
-ExtractElfSectionHeaderAddress(const uint8_t *const buf,
-    const Header *const header)
+ExtractElfSectionHeaderAddress(const uint8_t *const buf)
 {
-  switch (header->kClass) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, 12);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(64, 16);
     default: return ~0ULL;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint64_t
-ExtractElfSectionHeaderOffset(const uint8_t *const buf,
-    const Header *const header)
+ExtractElfSectionHeaderOffset(const uint8_t *const buf)
 {
-  switch (header->kClass) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, 16);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(64, 24);
     default: return ~0ULL;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint64_t
-ExtractElfSectionHeaderSize(const uint8_t *const buf,
-    const Header *const header)
+ExtractElfSectionHeaderSize(const uint8_t *const buf)
 {
-  switch (header->kClass) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, 20);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(64, 32);
     default: return ~0ULL;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint32_t
-ExtractElfSectionHeaderLink(const uint8_t *const buf,
-    const Header *const header)
+ExtractElfSectionHeaderLink(const uint8_t *const buf)
 {
-  switch (header->kClass) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, 24);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(32, 40);
     default: return ~0U;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint32_t
-ExtractElfSectionHeaderInfo(const uint8_t *const buf,
-    const Header *const header)
+ExtractElfSectionHeaderInfo(const uint8_t *const buf)
 {
-  switch (header->kClass) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, 28);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(32, 44);
     default: return ~0U;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint64_t
-ExtractElfSectionHeaderAddressAlignment(const uint8_t *const buf,
-    const Header *const header)
+ExtractElfSectionHeaderAddressAlignment(const uint8_t *const buf)
 {
-  switch (header->kClass) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, 32);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(64, 48);
     default: return ~0ULL;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint64_t
-ExtractElfSectionHeaderEntrySize(const uint8_t *const buf,
-    const Header *const header)
+ExtractElfSectionHeaderEntrySize(const uint8_t *const buf)
 {
-  switch (header->kClass) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, 36);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(64, 56);
     default: return ~0ULL;
@@ -202,6 +206,76 @@ inline static const char
   }
 }
 
+// Parses the section headers of a binary of the given class
+// and data encoding from the buffer.
+template <uint8_t kClass, uint8_t kData>
+static ArenaVector<SectionHeader>
+DecodeElfSectionHeaders(const uint8_t *const buf,
+                       const uint64_t buf_size,
+                       const Header *const header,
+                       Arena *const arena)
+{
+  const uint64_t kOffset = header->kSectionHeaderOffset;
+  const uint64_t kSize = header->kSectionHeaderSize;
+  uint64_t count = header->kSectionHeaderCount;
+  if (!kOffset || !count) {
+    return ArenaVector<SectionHeader>(ArenaAllocator<SectionHeader>(arena));
+  }
+  ArenaVector<SectionHeader> section_headers{
+      ArenaAllocator<SectionHeader>(arena)};
+  if (!ElfTableInBounds(kOffset, count, kSize,
+                        ElfSectionHeaderMinSize(kClass), buf_size)) {
+    return section_headers;
+  }
+
+  const uint8_t *section_header_base = buf + kOffset;
+
+  // If the count is 0, then extract the count from the initial
+  // section header.
+  if (count == 0) {
+    count = ExtractElfSectionHeaderLink<kClass, kData>(section_header_base);
+  }
+
+  // A names index outside the table leaves every section unnamed.
+  uint64_t names_size = 1;
+  const char *names = "";
+  if (header->kSectionHeaderNamesIndex < count) {
+    const uint8_t *const section_header_names_section
+        = section_header_base + kSize * header->kSectionHeaderNamesIndex;
+    names = LocateElfStringTable(
+        buf, buf_size,
+        ExtractElfSectionHeaderOffset<kClass, kData>(
+            section_header_names_section),
+        ExtractElfSectionHeaderSize<kClass, kData>(
+            section_header_names_section),
+        &names_size);
+  }
+
+  section_headers.reserve(count);
+  for (unsigned i = 0; i < count; i++) {
+    const uint8_t *section_header = section_header_base + i*kSize;
+    const uint32_t kName = ElfStringOffset(
+        ExtractElfSectionHeaderName<kClass, kData>(section_header),
+        names_size);
+
+    section_headers.push_back(SectionHeader{
+      kName,
+      names + kName,
+      ExtractElfSectionHeaderType<kClass, kData>(section_header),
+      ExtractElfSectionHeaderFlags<kClass, kData>(section_header),
+      ExtractElfSectionHeaderAddress<kClass, kData>(section_header),
+      ExtractElfSectionHeaderOffset<kClass, kData>(section_header),
+      ExtractElfSectionHeaderSize<kClass, kData>(section_header),
+      ExtractElfSectionHeaderLink<kClass, kData>(section_header),
+      ExtractElfSectionHeaderInfo<kClass, kData>(section_header),
+      ExtractElfSectionHeaderAddressAlignment<kClass, kData>(section_header),
+      ExtractElfSectionHeaderEntrySize<kClass, kData>(section_header),
+    });
+  }
+
+  return section_headers;
+}
+
 } // namespace
 
 #undef EXTRACT_ELF_FIELD
@@ -215,56 +289,132 @@ bool ValidElfSectionHeader(const SectionHeader &header)
   return true;
 }
 
-std::vector<SectionHeader>
+ArenaVector<SectionHeader>
 ParseElfSectionHeaders(const uint8_t *const buf,
-                       const Header *const header)
+                       const uint64_t size,
+                       const Header *const header,
+                       Arena *const arena)
+{
+  switch (GetElfEncoding(header->kClass, header->kData)) {
+    case ElfEncoding::k32Lsb:
+      return DecodeElfSectionHeaders<ELFCLASS32, ELFDATA2LSB>(
+          buf, size, header, arena);
+    case ElfEncoding::k32Msb:
+      return DecodeElfSectionHeaders<ELFCLASS32, ELFDATA2MSB>(
+          buf, size, header, arena);
+    case ElfEncoding::k64Lsb:
+      return DecodeElfSectionHeaders<ELFCLASS64, ELFDATA2LSB>(
+          buf, size, header, arena);
+    case ElfEncoding::k64Msb:
+      return DecodeElfSectionHeaders<ELFCLASS64, ELFDATA2MSB>(
+          buf, size, header, arena);
+    case ElfEncoding::kUnknown: // FALLTHROUGH
+    default:
+      return ArenaVector<SectionHeader>(ArenaAllocator<SectionHeader>(arena));
+  }
+}
+
+SectionHeaderRange
+ParseElfSectionHeaderViews(const uint8_t *const buf,
+                           const uint64_t size,
+                           const Header *const header)
 {
+  const ElfEncoding kEncoding = GetElfEncoding(header->kClass, header->kData);
   const uint64_t kOffset = header->kSectionHeaderOffset;
   const uint64_t kSize = header->kSectionHeaderSize;
-  uint64_t count = header->kSectionHeaderCount;
-  if (!kOffset || !count) {
-    return std::vector<SectionHeader>();
+  const uint64_t kCount = header->kSectionHeaderCount;
+  if (kEncoding == ElfEncoding::kUnknown || !kOffset || !kCount
+      || !ElfTableInBounds(kOffset, kCount, kSize,
+                           ElfSectionHeaderMinSize(header->kClass), size)) {
+    return SectionHeaderRange();
   }
-  std::vector<SectionHeader> section_headers;
 
-  const uint8_t *section_header_base = buf + kOffset;
-
-  // If the count is 0, then extract the count from the initial
-  // section header.
-  if (count == 0) {
-    count = ExtractElfSectionHeaderLink(section_header_base, header);
+  // Locate the section header names through a view of their section.
+  uint64_t names_size = 1;
+  const char *names = "";
+  if (header->kSectionHeaderNamesIndex < kCount) {
+    const SectionHeaderView names_section(
+        buf + kOffset + kSize * header->kSectionHeaderNamesIndex,
+        kEncoding, names, names_size);
+    names = LocateElfStringTable(buf, size, names_section.offset(),
+                                 names_section.size(), &names_size);
   }
 
-  const uint8_t *const section_header_names_section
-      = section_header_base + kSize * header->kSectionHeaderNamesIndex;
+  return SectionHeaderRange(buf + kOffset, kCount, kSize, kEncoding,
+                            names, names_size);
+}
 
-  const uint64_t section_header_names_table_offset
-      = ExtractElfSectionHeaderOffset(section_header_names_section, header);
+uint32_t SectionHeaderView::name() const
+{
+  DECODE_ELF_FIELD(ExtractElfSectionHeaderName, encoding_, entry_);
+}
 
-  const uint8_t *const section_header_names_table
-      = buf + section_header_names_table_offset;
+const char *SectionHeaderView::string_name() const
+{
+  return names_ + ElfStringOffset(name(), names_size_);
+}
 
-  for (unsigned i = 0; i < count; i++) {
-    const uint8_t *section_header = section_header_base + i*kSize;
-    const uint32_t kName
-        = ExtractElfSectionHeaderName(section_header, header);
+uint32_t SectionHeaderView::type() const
+{
+  DECODE_ELF_FIELD(ExtractElfSectionHeaderType, encoding_, entry_);
+}
 
-    section_headers.push_back(std::move(SectionHeader{
-      kName,
-      reinterpret_cast<const char*>(section_header_names_table+kName),
-      ExtractElfSectionHeaderType(section_header, header),
-      ExtractElfSectionHeaderFlags(section_header, header),
-      ExtractElfSectionHeaderAddress(section_header, header),
-      ExtractElfSectionHeaderOffset(section_header, header),
-      ExtractElfSectionHeaderSize(section_header, header),
-      ExtractElfSectionHeaderLink(section_header, header),
-      ExtractElfSectionHeaderInfo(section_header, header),
-      ExtractElfSectionHeaderAddressAlignment(section_header, header),
-      ExtractElfSectionHeaderEntrySize(section_header, header),
-    }));
-  }
+uint64_t SectionHeaderView::flags() const
+{
+  DECODE_ELF_FIELD(ExtractElfSectionHeaderFlags, encoding_, entry_);
+}
 
-  return section_headers;
+uint64_t SectionHeaderView::address() const
+{
+  DECODE_ELF_FIELD(ExtractElfSectionHeaderAddress, encoding_, entry_);
+}
+
+uint64_t SectionHeaderView::offset() const
+{
+  DECODE_ELF_FIELD(ExtractElfSectionHeaderOffset, encoding_, entry_);
+}
+
+uint64_t SectionHeaderView::size() const
+{
+  DECODE_ELF_FIELD(ExtractElfSectionHeaderSize, encoding_, entry_);
+}
+
+uint32_t SectionHeaderView::link() const
+{
+  DECODE_ELF_FIELD(ExtractElfSectionHeaderLink, encoding_, entry_);
+}
+
+uint32_t SectionHeaderView::info() const
+{
+  DECODE_ELF_FIELD(ExtractElfSectionHeaderInfo, encoding_, entry_);
+}
+
+uint64_t SectionHeaderView::address_alignment() const
+{
+  DECODE_ELF_FIELD(ExtractElfSectionHeaderAddressAlignment,
+                   encoding_, entry_);
+}
+
+uint64_t SectionHeaderView::entry_size() const
+{
+  DECODE_ELF_FIELD(ExtractElfSectionHeaderEntrySize, encoding_, entry_);
+}
+
+SectionHeader SectionHeaderView::Materialize() const
+{
+  return SectionHeader{
+    ElfStringOffset(name(), names_size_),
+    string_name(),
+    type(),
+    flags(),
+    address(),
+    offset(),
+    size(),
+    link(),
+    info(),
+    address_alignment(),
+    entry_size(),
+  };
 }
 
 std::string SectionHeader::ToString() const
@@ -1,11 +1,15 @@
 #ifndef BINARY_MATCHER_ELF_BINARY_SECTION_HEADER_H
 #define BINARY_MATCHER_ELF_BINARY_SECTION_HEADER_H
 
+#include "arena.h"
 #include "elf/elf_binary.h"
+#include "elf/elf_binary_field.h"
 #include "elf/elf_binary_header.h"
+#include "elf/elf_binary_view_range.h"
 
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 // Type that represents an ELF section header.
 // An elf section header contains information about
@@ -28,13 +32,70 @@ struct ElfBinary::SectionHeader {
   std::string ToString() const;
 };
 
+// Type that provides a view of an ELF section header in place in
+// the binary's buffer. Fields are decoded when requested rather
+// than copied out up front.
+class ElfBinary::SectionHeaderView {
+public:
+  // Constructs a view of the section header at entry, whose name is
+  // an offset into the names_size bytes of the section header string
+  // table names.
+  SectionHeaderView(const uint8_t *const entry,
+                    const ElfEncoding encoding,
+                    const char *const names,
+                    const uint64_t names_size)
+    : entry_(entry),
+      encoding_(encoding),
+      names_(names),
+      names_size_(names_size) { }
+
+  // Accessors for the fields of the section header.
+  // See SectionHeader for a description of each field.
+  uint32_t name() const;
+  const char *string_name() const;
+  uint32_t type() const;
+  uint64_t flags() const;
+  uint64_t address() const;
+  uint64_t offset() const;
+  uint64_t size() const;
+  uint32_t link() const;
+  uint32_t info() const;
+  uint64_t address_alignment() const;
+  uint64_t entry_size() const;
+
+  // Decodes every field of the section header.
+  ElfBinary::SectionHeader Materialize() const;
+
+private:
+  // The section header's entry in the buffer.
+  const uint8_t *entry_;
+  // The class and data encoding of the binary.
+  ElfEncoding encoding_;
+  // The section header string table.
+  const char *names_;
+  // The size of the section header string table.
+  uint64_t names_size_;
+};
+
 // Validates that the given section header is a valid ELF section header.
 bool ValidElfSectionHeader(const ElfBinary::SectionHeader &header);
 
-// Parses the ELF section headers from the given buffer.
-// Returns an empty vector on failure.
-std::vector<ElfBinary::SectionHeader>
+// Parses the ELF section headers from the given buffer of size bytes
+// into the arena. Returns an empty vector on failure, including when
+// the section header table does not lie within the buffer.
+// Names that lie outside the section header string table are empty.
+ArenaVector<ElfBinary::SectionHeader>
 ParseElfSectionHeaders(const uint8_t *const buf,
-                       const ElfBinary::Header *const header);
+                       const uint64_t size,
+                       const ElfBinary::Header *const header,
+                       Arena *const arena);
+
+// Returns views of the ELF section headers in the given buffer of
+// size bytes, without decoding or copying any of them.
+// Returns an empty range on failure.
+ElfBinary::SectionHeaderRange
+ParseElfSectionHeaderViews(const uint8_t *const buf,
+                           const uint64_t size,
+                           const ElfBinary::Header *const header);
 
 #endif // BINARY_MATCHER_ELF_BINARY_SECTION_HEADER_H
@@ -0,0 +1,185 @@
+#include "binary_cache.h"
+#include "elf/elf_binary_field.h"
+#include "elf/elf_binary_section_index.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <elf.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+using NameIndex = ElfBinary::NameIndex;
+using SectionHeader = ElfBinary::SectionHeader;
+using SectionIndex = ElfBinary::SectionIndex;
+
+const size_t SectionIndex::kNotFound;
+
+SectionIndex::SectionIndex()
+  : by_name_(),
+    by_name_names_(),
+    name_starts_(),
+    names_(""),
+    name_index_(),
+    by_type_(),
+    types_(),
+    type_starts_() { }
+
+SectionIndex::SectionIndex(const ArenaVector<SectionHeader> &headers,
+                           Arena *const arena)
+  : by_name_(ArenaAllocator<uint32_t>(arena)),
+    by_name_names_(ArenaAllocator<uint32_t>(arena)),
+    name_starts_(ArenaAllocator<uint32_t>(arena)),
+    names_(""),
+    name_index_(),
+    by_type_(ArenaAllocator<uint32_t>(arena)),
+    types_(ArenaAllocator<uint32_t>(arena)),
+    type_starts_(ArenaAllocator<uint32_t>(arena))
+{
+  // Every section's name is an offset into the same string table.
+  if (!headers.empty()) {
+    names_ = headers[0].kStringName - headers[0].kName;
+  }
+
+  size_t named = 0;
+  for (const SectionHeader &header : headers) {
+    named += header.kType != SHT_NULL && *header.kStringName;
+  }
+  by_name_.reserve(named);
+  for (size_t i = 0; i < headers.size(); i++) {
+    if (headers[i].kType != SHT_NULL && *headers[i].kStringName) {
+      by_name_.push_back(static_cast<uint32_t>(i));
+    }
+  }
+  ParallelSort(by_name_.begin(), by_name_.end(),
+               [&headers](const uint32_t a, const uint32_t b) {
+    const int kOrder = strcmp(headers[a].kStringName, headers[b].kStringName);
+    return kOrder ? kOrder < 0 : a < b;
+  });
+
+  by_name_names_.resize(by_name_.size());
+  name_starts_.resize(by_name_.size());
+  for (size_t i = 0; i < by_name_.size(); i++) {
+    by_name_names_[i] = headers[by_name_[i]].kName;
+    const bool kSameName = i > 0
+        && !strcmp(headers[by_name_[i]].kStringName,
+                   headers[by_name_[i - 1]].kStringName);
+    name_starts_[i] = kSameName ? name_starts_[i - 1]
+                                : static_cast<uint32_t>(i);
+  }
+  name_index_ = NameIndex(names_, by_name_names_.data(),
+                          by_name_names_.size(), arena);
+
+  by_type_.resize(headers.size());
+  for (size_t i = 0; i < headers.size(); i++) {
+    by_type_[i] = static_cast<uint32_t>(i);
+  }
+  std::stable_sort(by_type_.begin(), by_type_.end(),
+                   [&headers](const uint32_t a, const uint32_t b) {
+    return headers[a].kType < headers[b].kType;
+  });
+  for (size_t i = 0; i < by_type_.size(); i++) {
+    const uint32_t kType = headers[by_type_[i]].kType;
+    if (types_.empty() || types_.back() != kType) {
+      types_.push_back(kType);
+      type_starts_.push_back(static_cast<uint32_t>(i));
+    }
+  }
+  type_starts_.push_back(static_cast<uint32_t>(by_type_.size()));
+}
+
+SectionIndex::SectionIndex(SectionIndex&&) = default;
+
+SectionIndex &SectionIndex::operator=(SectionIndex&&) = default;
+
+SectionIndex::~SectionIndex() { }
+
+size_t SectionIndex::Find(const char *const name) const
+{
+  const Sections kSections = SectionsNamed(name);
+  return kSections.empty() ? kNotFound : kSections[0];
+}
+
+SectionIndex::Sections SectionIndex::SectionsNamed(const char *const name) const
+{
+  // The index finds the last of the sections sharing a name, which
+  // are contiguous in by_name_.
+  const size_t kLast = name_index_.Find(name, names_, by_name_names_.data());
+  if (kLast == NameIndex::kNotFound) {
+    return Sections{by_name_.data(), by_name_.data()};
+  }
+  return Sections{by_name_.data() + name_starts_[kLast],
+                  by_name_.data() + kLast + 1};
+}
+
+SectionIndex::Sections SectionIndex::SectionsOfType(const uint32_t type) const
+{
+  const auto it = std::lower_bound(types_.begin(), types_.end(), type);
+  if (it == types_.end() || *it != type) {
+    return Sections{by_type_.data(), by_type_.data()};
+  }
+  const size_t kType = static_cast<size_t>(it - types_.begin());
+  return Sections{by_type_.data() + type_starts_[kType],
+                  by_type_.data() + type_starts_[kType + 1]};
+}
+
+void SectionIndex::Serialize(const uint8_t *const buf, const uint64_t size,
+                             CacheWriter *const writer) const
+{
+  // The names are located again from the extent of the string table
+  // that they occupy.
+  uint64_t names_size = 1;
+  for (const uint32_t kName : by_name_names_) {
+    names_size = std::max<uint64_t>(names_size,
+                                    kName + strlen(names_ + kName) + 1);
+  }
+  writer->Write<uint64_t>(ElfStringTableOffset(buf, size, names_));
+  writer->Write<uint64_t>(names_size);
+  writer->WriteArray(by_name_);
+  writer->WriteArray(by_name_names_);
+  writer->WriteArray(name_starts_);
+  name_index_.Serialize(writer);
+  writer->WriteArray(by_type_);
+  writer->WriteArray(types_);
+  writer->WriteArray(type_starts_);
+}
+
+SectionIndex SectionIndex::Load(CacheReader *const reader,
+                                const uint8_t *const buf, const uint64_t size,
+                                const size_t count, Arena *const arena)
+{
+  SectionIndex index;
+  const uint64_t kNamesOffset = reader->Read<uint64_t>();
+  const uint64_t kNamesSize = reader->Read<uint64_t>();
+  uint64_t names_size = 0;
+  index.names_ = LocateElfStringTable(buf, size, kNamesOffset, kNamesSize,
+                                      &names_size);
+  index.by_name_ = reader->ReadArray<uint32_t>(count, arena);
+  const size_t kNamed = index.by_name_.size();
+  index.by_name_names_ = reader->ReadArray<uint32_t>(names_size, arena);
+  index.name_starts_ = reader->ReadArray<uint32_t>(kNamed, arena);
+  index.name_index_ = NameIndex::Load(reader, kNamed, arena);
+  index.by_type_ = reader->ReadArray<uint32_t>(count, arena);
+  index.types_ = reader->ReadArray<uint32_t>(arena);
+  index.type_starts_
+      = reader->ReadArray<uint32_t>(index.by_type_.size() + 1, arena);
+
+  bool valid = names_size == kNamesSize
+      && index.by_name_names_.size() == kNamed
+      && index.name_starts_.size() == kNamed
+      && index.type_starts_.size() == index.types_.size() + 1
+      && index.type_starts_.back() == index.by_type_.size();
+  // Each group of sections must begin no later than it ends.
+  for (size_t i = 0; valid && i < kNamed; i++) {
+    valid = index.name_starts_[i] <= i;
+  }
+  for (size_t i = 1; valid && i < index.type_starts_.size(); i++) {
+    valid = index.type_starts_[i - 1] <= index.type_starts_[i];
+  }
+  if (!valid) {
+    reader->Fail();
+    return SectionIndex();
+  }
+  return index;
+}
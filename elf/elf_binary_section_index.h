@@ -0,0 +1,98 @@
+#ifndef BINARY_MATCHER_ELF_BINARY_SECTION_INDEX_H
+#define BINARY_MATCHER_ELF_BINARY_SECTION_INDEX_H
+
+#include "arena.h"
+#include "binary_cache.h"
+#include "elf/elf_binary.h"
+#include "elf/elf_binary_name_index.h"
+#include "elf/elf_binary_section_header.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Type that represents an index of a binary's sections by name and
+// by type, so that finding a section costs one hash probe rather
+// than a comparison against every section header.
+// Section numbers are held grouped by name and by type, each group
+// in section order, and lookups return a group in place.
+class ElfBinary::SectionIndex {
+public:
+  // The value returned by lookups that find no section.
+  static const size_t kNotFound = SIZE_MAX;
+
+  // Type representing the numbers of a group of sections,
+  // in the order the sections appear in the binary.
+  struct Sections {
+    const uint32_t *const kBegin;
+    const uint32_t *const kEnd;
+
+    const uint32_t *begin() const { return kBegin; }
+    const uint32_t *end() const { return kEnd; }
+    size_t size() const { return static_cast<size_t>(kEnd - kBegin); }
+    bool empty() const { return kBegin == kEnd; }
+    size_t operator[](const size_t i) const { return kBegin[i]; }
+  };
+
+  // Constructs an index of no sections.
+  SectionIndex();
+
+  // Builds an index of the given section headers, allocated from the
+  // arena. Sections of type SHT_NULL, and unnamed sections, are not
+  // indexed by name.
+  SectionIndex(const ArenaVector<ElfBinary::SectionHeader> &headers,
+               Arena *const arena);
+
+  // Indexes are moved rather than copied.
+  SectionIndex(const SectionIndex&) = delete;
+  SectionIndex &operator=(const SectionIndex&) = delete;
+  SectionIndex(SectionIndex&&);
+  SectionIndex &operator=(SectionIndex&&);
+
+  ~SectionIndex();
+
+  // Returns the number of the first section named name, or kNotFound.
+  size_t Find(const char *const name) const;
+
+  // Returns the numbers of the sections named name.
+  Sections SectionsNamed(const char *const name) const;
+
+  // Returns the numbers of the sections of the given type.
+  Sections SectionsOfType(const uint32_t type) const;
+
+  // Appends the index to writer, to be read back by Load. The index
+  // must have been built from section headers parsed from the buffer
+  // of size bytes.
+  void Serialize(const uint8_t *const buf, const uint64_t size,
+                 CacheWriter *const writer) const;
+
+  // Reads an index that Serialize wrote from reader, given the same
+  // buffer, whose binary has count section headers, allocating it from
+  // the arena. Fails the reader if it does not hold a valid index of
+  // that many sections.
+  static SectionIndex Load(CacheReader *const reader,
+                           const uint8_t *const buf, const uint64_t size,
+                           const size_t count, Arena *const arena);
+
+private:
+  // Section numbers, sorted by name and then by number.
+  ArenaVector<uint32_t> by_name_;
+  // The name of each section in by_name_, as an offset into names_.
+  ArenaVector<uint32_t> by_name_names_;
+  // The position in by_name_ of the first section sharing the
+  // name of the section at each position.
+  ArenaVector<uint32_t> name_starts_;
+  // The section header string table.
+  const char *names_;
+  // Index from names to the last position in by_name_ holding them.
+  ElfBinary::NameIndex name_index_;
+  // Section numbers, sorted by type and then by number.
+  ArenaVector<uint32_t> by_type_;
+  // The distinct types of the sections, sorted. A binary has only a
+  // handful, so finding one is a search of a single cache line.
+  ArenaVector<uint32_t> types_;
+  // The position in by_type_ of the first section of each type in
+  // types_, followed by the number of sections.
+  ArenaVector<uint32_t> type_starts_;
+};
+
+#endif // BINARY_MATCHER_ELF_BINARY_SECTION_INDEX_H
@@ -0,0 +1,289 @@
+#include "elf/elf_binary_symbol_hash_table.h"
+#include "elf/elf_binary_section_header.h"
+
+#include <elf.h>
+#include <string.h>
+
+using Header = ElfBinary::Header;
+using SectionHeaderRange = ElfBinary::SectionHeaderRange;
+using SectionHeaderView = ElfBinary::SectionHeaderView;
+using SymbolHashTable = ElfBinary::SymbolHashTable;
+using SymbolRange = ElfBinary::SymbolRange;
+
+namespace {
+
+// The size of the header that starts a GNU hash table: the number
+// of buckets, the index of the first hashed symbol, the number of
+// Bloom filter words and the Bloom filter's second hash shift.
+const uint64_t kGnuHeaderSize = 16;
+
+// The size of the header that starts a SysV hash table: the number
+// of buckets and the number of chain entries.
+const uint64_t kSysVHeaderSize = 8;
+
+// Loads a T stored with the given encoding's byte order from buf.
+template <typename T>
+inline static T LoadWord(const uint8_t *const buf, const ElfEncoding encoding)
+{
+  switch (encoding) {
+    case ElfEncoding::k32Lsb: // FALLTHROUGH
+    case ElfEncoding::k64Lsb:
+      return LoadElfField<T, ELFDATA2LSB>(buf);
+    case ElfEncoding::k32Msb: // FALLTHROUGH
+    case ElfEncoding::k64Msb:
+      return LoadElfField<T, ELFDATA2MSB>(buf);
+    case ElfEncoding::kUnknown: // FALLTHROUGH
+    default:
+      return 0;
+  }
+}
+
+// Returns the size in bytes of a GNU Bloom filter word, which is
+// the size of an address in the binary's class.
+inline static uint64_t BloomWordSize(const ElfEncoding encoding)
+{
+  return encoding == ElfEncoding::k32Lsb || encoding == ElfEncoding::k32Msb
+      ? 4 : 8;
+}
+
+} // namespace
+
+const size_t SymbolHashTable::kNotFound;
+
+SymbolHashTable::SymbolHashTable(const Type type,
+                                 const uint8_t *const table,
+                                 const ElfEncoding encoding,
+                                 const SymbolRange &symbols)
+  : type_(type),
+    table_(table),
+    encoding_(encoding),
+    symbols_(symbols) { }
+
+uint32_t SymbolHashTable::GnuHash(const char *const name)
+{
+  uint32_t hash = 5381;
+  for (const char *c = name; *c; c++) {
+    hash = hash*33 + static_cast<uint8_t>(*c);
+  }
+  return hash;
+}
+
+uint32_t SymbolHashTable::SysVHash(const char *const name)
+{
+  uint32_t hash = 0;
+  for (const char *c = name; *c; c++) {
+    hash = (hash << 4) + static_cast<uint8_t>(*c);
+    const uint32_t kHigh = hash & 0xF0000000;
+    hash ^= kHigh >> 24;
+    hash &= ~kHigh;
+  }
+  return hash;
+}
+
+SymbolHashTable::Type SymbolHashTable::type() const
+{
+  return type_;
+}
+
+const SymbolRange &SymbolHashTable::symbols() const
+{
+  return symbols_;
+}
+
+size_t SymbolHashTable::Find(const char *const name) const
+{
+  switch (type_) {
+    case Type::kGnu: return FindGnu(name);
+    case Type::kSysV: return FindSysV(name);
+    default: return kNotFound;
+  }
+}
+
+uint32_t SymbolHashTable::Word(const uint64_t i) const
+{
+  return LoadWord<uint32_t>(table_ + 4*i, encoding_);
+}
+
+uint64_t SymbolHashTable::BloomWord(const uint64_t i) const
+{
+  const uint8_t *const kBloom = table_ + kGnuHeaderSize;
+  if (BloomWordSize(encoding_) == 4) {
+    return LoadWord<uint32_t>(kBloom + 4*i, encoding_);
+  }
+  return LoadWord<uint64_t>(kBloom + 8*i, encoding_);
+}
+
+bool SymbolHashTable::Matches(const size_t i, const char *const name) const
+{
+  const ElfBinary::SymbolView symbol = symbols_[i];
+  return symbol.section_header_index() != SHN_UNDEF
+      && !strcmp(symbol.string_name(), name);
+}
+
+size_t SymbolHashTable::FindGnu(const char *const name) const
+{
+  const uint32_t kBuckets = Word(0);
+  const uint32_t kSymbolOffset = Word(1);
+  const uint32_t kBloomSize = Word(2);
+  const uint32_t kBloomShift = Word(3);
+  const uint64_t kBloomBits = 8*BloomWordSize(encoding_);
+  const uint32_t kHash = GnuHash(name);
+
+  // The Bloom filter rejects most absent names without touching
+  // the buckets or chains. Each name sets two bits of one word.
+  const uint64_t kBloomWord = BloomWord((kHash / kBloomBits) % kBloomSize);
+  const uint64_t kBloomMask = (1ULL << (kHash % kBloomBits))
+      | (1ULL << ((kHash >> kBloomShift) % kBloomBits));
+  if ((kBloomWord & kBloomMask) != kBloomMask) {
+    return kNotFound;
+  }
+
+  // The buckets and chains are arrays of 32 bit words following the
+  // Bloom filter. Symbols in a bucket are consecutive, and each one's
+  // chain entry holds its hash, with the low bit set on the last.
+  const uint64_t kBucketsStart
+      = (kGnuHeaderSize + kBloomSize*BloomWordSize(encoding_)) / 4;
+  const uint64_t kChainsStart = kBucketsStart + kBuckets;
+  const uint32_t kFirst = Word(kBucketsStart + kHash % kBuckets);
+  if (kFirst < kSymbolOffset) {
+    return kNotFound;
+  }
+  for (size_t i = kFirst; i < symbols_.size(); i++) {
+    const uint32_t kChainHash = Word(kChainsStart + i - kSymbolOffset);
+    if ((kChainHash | 1) == (kHash | 1) && Matches(i, name)) {
+      return i;
+    }
+    if (kChainHash & 1) {
+      break;
+    }
+  }
+  return kNotFound;
+}
+
+size_t SymbolHashTable::FindSysV(const char *const name) const
+{
+  const uint32_t kBuckets = Word(0);
+  const uint32_t kChains = Word(1);
+  const uint64_t kBucketsStart = kSysVHeaderSize / 4;
+  const uint64_t kChainsStart = kBucketsStart + kBuckets;
+
+  // Bound the walk by the number of chain entries, so that a
+  // malformed table with a cycle in a chain cannot loop forever.
+  uint32_t i = Word(kBucketsStart + SysVHash(name) % kBuckets);
+  for (uint32_t steps = 0; i != STN_UNDEF && steps < kChains; steps++) {
+    if (i >= kChains) {
+      break;
+    }
+    if (Matches(i, name)) {
+      return i;
+    }
+    i = Word(kChainsStart + i);
+  }
+  return kNotFound;
+}
+
+bool ValidElfSymbolHashTable(const SymbolHashTable::Type type,
+                             const uint8_t *const table, const uint64_t size,
+                             const ElfEncoding encoding,
+                             const uint64_t symbol_count)
+{
+  if (encoding == ElfEncoding::kUnknown) {
+    return false;
+  }
+
+  switch (type) {
+    case SymbolHashTable::Type::kGnu: {
+      if (size < kGnuHeaderSize) {
+        return false;
+      }
+      const uint64_t kBuckets = LoadWord<uint32_t>(table, encoding);
+      const uint64_t kSymbolOffset = LoadWord<uint32_t>(table + 4, encoding);
+      const uint64_t kBloomSize = LoadWord<uint32_t>(table + 8, encoding);
+      const uint64_t kBloomShift = LoadWord<uint32_t>(table + 12, encoding);
+      if (!kBuckets || !kBloomSize || kBloomShift >= 32
+          || kSymbolOffset > symbol_count) {
+        return false;
+      }
+      // Every field is at most 32 bits, so the sum cannot overflow.
+      return kGnuHeaderSize + kBloomSize*BloomWordSize(encoding)
+          + 4*kBuckets + 4*(symbol_count - kSymbolOffset) <= size;
+    }
+    case SymbolHashTable::Type::kSysV: {
+      if (size < kSysVHeaderSize) {
+        return false;
+      }
+      const uint64_t kBuckets = LoadWord<uint32_t>(table, encoding);
+      const uint64_t kChains = LoadWord<uint32_t>(table + 4, encoding);
+      return kBuckets && kChains <= symbol_count
+          && kSysVHeaderSize + 4*(kBuckets + kChains) <= size;
+    }
+    default:
+      return false;
+  }
+}
+
+SymbolHashTable *ParseElfSymbolHashTable(const uint8_t *const buf,
+                                         const uint64_t size,
+                                         const Header *const header,
+                                         Arena *const arena)
+{
+  const SectionHeaderRange section_headers
+      = ParseElfSectionHeaderViews(buf, size, header);
+
+  // Prefer the GNU table, whose Bloom filter and contiguous chains
+  // make lookups cheaper, over the SysV table where both exist.
+  const size_t kNotFound = section_headers.size();
+  size_t hash_index = kNotFound;
+  SymbolHashTable::Type type = SymbolHashTable::Type::kSysV;
+  for (size_t i = 0; i < section_headers.size(); i++) {
+    const uint32_t kType = section_headers[i].type();
+    if (kType == SHT_GNU_HASH) {
+      hash_index = i;
+      type = SymbolHashTable::Type::kGnu;
+      break;
+    }
+    if (kType == SHT_HASH && hash_index == kNotFound) {
+      hash_index = i;
+    }
+  }
+  if (hash_index == kNotFound) {
+    return nullptr;
+  }
+
+  // The hash table links to the symbol table it indexes, which in
+  // turn links to the string table holding the symbols' names.
+  const SectionHeaderView hash_header = section_headers[hash_index];
+  if (hash_header.link() >= section_headers.size()) {
+    return nullptr;
+  }
+  const SectionHeaderView symbol_table_header
+      = section_headers[hash_header.link()];
+  if (symbol_table_header.link() >= section_headers.size()
+      || !symbol_table_header.entry_size()) {
+    return nullptr;
+  }
+  const SectionHeaderView string_table_header
+      = section_headers[symbol_table_header.link()];
+
+  const ElfEncoding kEncoding = GetElfEncoding(header->kClass, header->kData);
+  const uint64_t kEntrySize = symbol_table_header.entry_size();
+  const uint64_t kEntries = symbol_table_header.size() / kEntrySize;
+  if (!ElfTableInBounds(symbol_table_header.offset(), kEntries, kEntrySize,
+                        ElfSymbolMinSize(header->kClass), size)
+      || !ElfRangeInBounds(hash_header.offset(), hash_header.size(), size)) {
+    return nullptr;
+  }
+  uint64_t strings_size = 0;
+  const char *const strings = LocateElfStringTable(
+      buf, size, string_table_header.offset(), string_table_header.size(),
+      &strings_size);
+  const SymbolRange symbols(buf + symbol_table_header.offset(), kEntries,
+                            kEntrySize, kEncoding, strings, strings_size);
+
+  const uint8_t *const table = buf + hash_header.offset();
+  if (!ValidElfSymbolHashTable(type, table, hash_header.size(), kEncoding,
+                               symbols.size())) {
+    return nullptr;
+  }
+  return arena->New<SymbolHashTable>(type, table, kEncoding, symbols);
+}
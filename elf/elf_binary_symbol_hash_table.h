@@ -0,0 +1,99 @@
+#ifndef BINARY_MATCHER_ELF_BINARY_SYMBOL_HASH_TABLE_H
+#define BINARY_MATCHER_ELF_BINARY_SYMBOL_HASH_TABLE_H
+
+#include "arena.h"
+#include "elf/elf_binary.h"
+#include "elf/elf_binary_field.h"
+#include "elf/elf_binary_header.h"
+#include "elf/elf_binary_symbol_table.h"
+#include "elf/elf_binary_view_range.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Type that represents the hash table that the binary carries for its
+// dynamic symbols (.gnu.hash, or failing that, the SysV .hash), used
+// in place in the binary's buffer.
+// A lookup reads the table's Bloom filter word (GNU only), one bucket,
+// a short hash chain and the names of the candidate symbols, so that
+// finding a few symbols touches a few pages of the file rather than
+// decoding and indexing the whole of .dynsym.
+class ElfBinary::SymbolHashTable {
+public:
+  // The kinds of hash table an ELF binary can carry.
+  enum class Type {
+    // A .gnu.hash section (SHT_GNU_HASH).
+    kGnu,
+    // A SysV .hash section (SHT_HASH).
+    kSysV,
+  };
+
+  // The value returned by lookups that find no symbol.
+  static const size_t kNotFound = SIZE_MAX;
+
+  // Constructs a hash table of the given type over symbols from the
+  // contents of its section, table, which must have passed
+  // ValidElfSymbolHashTable.
+  SymbolHashTable(const Type type, const uint8_t *const table,
+                  const ElfEncoding encoding,
+                  const ElfBinary::SymbolRange &symbols);
+
+  // Hashes a name as the GNU hash table does.
+  static uint32_t GnuHash(const char *const name);
+
+  // Hashes a name as the SysV hash table does.
+  static uint32_t SysVHash(const char *const name);
+
+  // Returns the type of the table.
+  Type type() const;
+
+  // Returns views of the symbols that the table indexes.
+  const ElfBinary::SymbolRange &symbols() const;
+
+  // Returns the index of the defined symbol named name, or kNotFound.
+  size_t Find(const char *const name) const;
+
+private:
+  // Implementations of Find for each type of table.
+  size_t FindGnu(const char *const name) const;
+  size_t FindSysV(const char *const name) const;
+
+  // Returns true if the i'th symbol is defined and named name.
+  bool Matches(const size_t i, const char *const name) const;
+
+  // Returns the i'th 32 bit word of the table.
+  uint32_t Word(const uint64_t i) const;
+
+  // Returns the i'th word of the GNU table's Bloom filter.
+  uint64_t BloomWord(const uint64_t i) const;
+
+  // The type of the table.
+  Type type_;
+  // The contents of the table's section.
+  const uint8_t *table_;
+  // The class and data encoding of the binary.
+  ElfEncoding encoding_;
+  // The symbols that the table indexes.
+  ElfBinary::SymbolRange symbols_;
+};
+
+// Validates that the contents of a hash table section of the given
+// type fit within its size and refer only to the symbol_count symbols
+// of the table it indexes.
+bool ValidElfSymbolHashTable(const ElfBinary::SymbolHashTable::Type type,
+                             const uint8_t *const table, const uint64_t size,
+                             const ElfEncoding encoding,
+                             const uint64_t symbol_count);
+
+// Locates the binary's .gnu.hash section, or failing that its .hash
+// section, and the dynamic symbols it indexes, from the given buffer
+// of size bytes, allocating the table from the arena.
+// Returns nullptr if there is no such section, it is invalid, or it or
+// its symbols do not lie within the buffer.
+ElfBinary::SymbolHashTable *
+ParseElfSymbolHashTable(const uint8_t *const buf,
+                        const uint64_t size,
+                        const ElfBinary::Header *const header,
+                        Arena *const arena);
+
+#endif // BINARY_MATCHER_ELF_BINARY_SYMBOL_HASH_TABLE_H
@@ -0,0 +1,99 @@
+#include "elf/elf_binary.h"
+#include "elf/elf_binary_symbol_hash_table.h"
+#include "elf/elf_binary_symbol_table.h"
+#include "file.h"
+#include "test.h"
+
+#include <elf.h>
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+using SymbolHashTable = ElfBinary::SymbolHashTable;
+using SymbolTable = ElfBinary::SymbolTable;
+
+namespace {
+
+// Returns the path of a shared library that this program has loaded,
+// whose name contains name, or an empty string if there is none.
+static std::string LoadedLibrary(const char *const name)
+{
+  FILE *const maps = fopen("/proc/self/maps", "r");
+  if (!maps) {
+    return std::string();
+  }
+  std::string path;
+  char line[4096];
+  while (path.empty() && fgets(line, sizeof(line), maps)) {
+    const char *const kPath = strchr(line, '/');
+    if (kPath && strstr(kPath, name)) {
+      path.assign(kPath, strcspn(kPath, "\n"));
+    }
+  }
+  fclose(maps);
+  return path;
+}
+
+static void TestHashes()
+{
+  EXPECT_EQ(SymbolHashTable::GnuHash(""), 0x1505U);
+  EXPECT_EQ(SymbolHashTable::GnuHash("printf"), 0x156b2bb8U);
+  EXPECT_EQ(SymbolHashTable::GnuHash("exit"), 0x7c967e3fU);
+  EXPECT_EQ(SymbolHashTable::SysVHash(""), 0U);
+  EXPECT_EQ(SymbolHashTable::SysVHash("printf"), 0x077905a6U);
+  EXPECT_EQ(SymbolHashTable::SysVHash("_ZNSt8ios_base4InitC1Ev"),
+            0x0c0d71d6U);
+}
+
+// Checks that every defined symbol of the C++ runtime this program
+// loads is found through its hash table, and that other names are not.
+static void TestFindDynamicSymbol()
+{
+  const std::string kPath = LoadedLibrary("libstdc++");
+  if (kPath.empty()) {
+    fprintf(stderr, "skipping: libstdc++ is not loaded\n");
+    return;
+  }
+  Result<File> file = File::Open(kPath.c_str());
+  EXPECT(file.ok());
+  if (!file.ok()) {
+    return;
+  }
+  Result<ElfBinary> elf
+      = ElfBinary::ParseFile(std::unique_ptr<const File>(file.release()));
+  EXPECT(elf.ok());
+  if (!elf.ok()) {
+    return;
+  }
+  EXPECT(elf.get()->symbol_hash_table() != nullptr);
+
+  const SymbolTable *const dynsym = elf.get()->symbol_table(".dynsym");
+  size_t defined = 0;
+  for (size_t i = 0; i < dynsym->size(); i++) {
+    if (dynsym->columns().section_header_indices[i] == SHN_UNDEF
+        || !*dynsym->name(i)) {
+      continue;
+    }
+    defined++;
+    const size_t kFound = elf.get()->FindDynamicSymbol(dynsym->name(i));
+    EXPECT(kFound != SymbolTable::kNoSymbol);
+    if (kFound != SymbolTable::kNoSymbol) {
+      EXPECT(!strcmp(dynsym->name(kFound), dynsym->name(i)));
+      EXPECT(dynsym->columns().section_header_indices[kFound] != SHN_UNDEF);
+    }
+  }
+  EXPECT(defined > 0);
+  EXPECT_EQ(elf.get()->FindDynamicSymbol("no such symbol"),
+            SymbolTable::kNoSymbol);
+  EXPECT_EQ(elf.get()->FindDynamicSymbol(""), SymbolTable::kNoSymbol);
+}
+
+} // namespace
+
+int main()
+{
+  RUN_TEST(TestHashes);
+  RUN_TEST(TestFindDynamicSymbol);
+  return TestStatus();
+}
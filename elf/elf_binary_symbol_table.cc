@@ -1,200 +1,596 @@
+#include "elf/elf_binary_field.h"
+#include "elf/elf_binary_section_index.h"
 #include "elf/elf_binary_symbol_table.h"
+#include "parallel.h"
+#include "thread_pool.h"
 
+#include <algorithm>
 #include <elf.h>
 #include <sstream>
 #include <string>
 #include <string.h>
 
+using AddressIndex = ElfBinary::AddressIndex;
+using FrameRange = ElfBinary::FrameRange;
 using Header = ElfBinary::Header;
+using NameIndex = ElfBinary::NameIndex;
 using SectionHeader = ElfBinary::SectionHeader;
+using SectionIndex = ElfBinary::SectionIndex;
+using SectionHeaderView = ElfBinary::SectionHeaderView;
 using Symbol = ElfBinary::Symbol;
+using SymbolRange = ElfBinary::SymbolRange;
+using SymbolView = ElfBinary::SymbolView;
 using SymbolTable = ElfBinary::SymbolTable;
 
 #define EXTRACT_ELF_FIELD(bits, offset) \
-  *(reinterpret_cast<const uint##bits##_t*>(buf+(offset)))
+  LoadElfField<uint##bits##_t, kData>(buf+(offset))
 
 namespace {
 
 // Set of helper methods that extract fields from
-// the buffer.
+// the buffer, specialised on the binary's class and data encoding.
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint32_t
-ExtractElfSymbolName(const uint8_t *const buf,
-    const Header *const)
+ExtractElfSymbolName(const uint8_t *const buf)
 {
   return EXTRACT_ELF_FIELD(32, 0);
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint64_t
-ExtractElfSymbolValue(const uint8_t *const buf,
-    const Header *const header)
+ExtractElfSymbolValue(const uint8_t *const buf)
 {
-  switch (header->kClass) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, 4);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(64, 8);
     default: return ~0ULL;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint64_t
-ExtractElfSymbolSize(const uint8_t *const buf,
-    const Header *const header)
+ExtractElfSymbolSize(const uint8_t *const buf)
 {
-  switch (header->kClass) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(32, 8);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(64, 16);
     default: return ~0ULL;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint8_t
-ExtractElfSymbolInfo(const uint8_t *const buf,
-    const Header *const header)
+ExtractElfSymbolInfo(const uint8_t *const buf)
 {
-  switch (header->kClass) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(8, 12);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(8, 4);
     default: return 0xFF;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint8_t
-ExtractElfSymbolOther(const uint8_t *const buf,
-    const Header *const header)
+ExtractElfSymbolOther(const uint8_t *const buf)
 {
-  switch (header->kClass) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(8, 13);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(8, 5);
     default: return 0xFF;
   }
 }
 
+template <uint8_t kClass, uint8_t kData>
 inline static uint16_t
-ExtractElfSymbolSectionHeaderIndex(const uint8_t *const buf,
-    const Header *const header)
+ExtractElfSymbolSectionHeaderIndex(const uint8_t *const buf)
 {
-  switch (header->kClass) {
+  switch (kClass) {
     case ELFCLASS32: return EXTRACT_ELF_FIELD(16, 14);
     case ELFCLASS64: return EXTRACT_ELF_FIELD(16, 6);
     default: return 0xFFFF;
   }
 }
 
+// Parses symbols [kBegin, kEnd) of a binary of the given class and
+// data encoding from the symbol table into columns. Names are offsets
+// into a string table of kStringsSize bytes.
+template <uint8_t kClass, uint8_t kData>
+static void DecodeElfSymbols(const uint8_t *const symbol_table_base,
+                             const size_t kBegin,
+                             const size_t kEnd,
+                             const uint64_t kEntrySize,
+                             const uint64_t kStringsSize,
+                             SymbolTable::Columns *const columns)
+{
+  for (size_t i = kBegin; i < kEnd; i++) {
+    const uint8_t *symbol_table_entry = symbol_table_base + i*kEntrySize;
+    columns->names[i] = ElfStringOffset(
+        ExtractElfSymbolName<kClass, kData>(symbol_table_entry),
+        kStringsSize);
+    columns->values[i]
+        = ExtractElfSymbolValue<kClass, kData>(symbol_table_entry);
+    columns->sizes[i]
+        = ExtractElfSymbolSize<kClass, kData>(symbol_table_entry);
+    columns->infos[i]
+        = ExtractElfSymbolInfo<kClass, kData>(symbol_table_entry);
+    columns->others[i]
+        = ExtractElfSymbolOther<kClass, kData>(symbol_table_entry);
+    columns->section_header_indices[i]
+        = ExtractElfSymbolSectionHeaderIndex<kClass, kData>(
+            symbol_table_entry);
+  }
+}
+
+// The fewest symbols worth decoding or classifying on another thread.
+const size_t kSymbolGrain = 1 << 14;
+
+// Returns the name of the string table that goes with the symbol table
+// of the given type (".strtab" for ".symtab", ".dynstr" for ".dynsym"),
+// or an empty string if the type does not name a symbol table.
+static std::string StringTableName(const char *const table_type)
+{
+  std::string name(table_type);
+  const size_t kSym = name.find("sym");
+  if (kSym == std::string::npos) {
+    return std::string();
+  }
+  return name.replace(kSym, 3, "str");
+}
+
 } // namespace
 
 #undef EXTRACT_ELF_FIELD
 
+const size_t SymbolTable::kNoSymbol;
+
+SymbolTable::Columns::Columns(Arena *const arena)
+  : names(ArenaAllocator<uint32_t>(arena)),
+    values(ArenaAllocator<uint64_t>(arena)),
+    sizes(ArenaAllocator<uint64_t>(arena)),
+    infos(ArenaAllocator<uint8_t>(arena)),
+    others(ArenaAllocator<uint8_t>(arena)),
+    section_header_indices(ArenaAllocator<uint16_t>(arena)) { }
+
+SymbolTable::Columns::Columns(Columns&&) = default;
+
+SymbolTable::Columns::~Columns() { }
+
 const char *SymbolTable::type() const
 {
   return type_;
 }
 
-const Symbol *SymbolTable::GetSymbolByAddress(const uint32_t address) const
+size_t SymbolTable::size() const
 {
-  auto it = address_to_symbol_.find(address);
-  if (it == address_to_symbol_.end()) {
-    return nullptr;
-  }
-  return it->second;
+  return columns_.values.size();
 }
 
-const Symbol *SymbolTable::GetSymbolByName(const char *const name) const
+const SymbolTable::Columns &SymbolTable::columns() const
 {
-  auto it = name_to_symbol_.find(name);
-  if (it == name_to_symbol_.end()) {
-    return nullptr;
-  }
-  return it->second;
+  return columns_;
+}
+
+const char *SymbolTable::name(const size_t i) const
+{
+  return strings_ + columns_.names[i];
+}
+
+Symbol SymbolTable::symbol(const size_t i) const
+{
+  return Symbol{
+    columns_.names[i],
+    name(i),
+    columns_.values[i],
+    columns_.sizes[i],
+    columns_.infos[i],
+    columns_.others[i],
+    columns_.section_header_indices[i],
+  };
+}
+
+size_t SymbolTable::FindSymbolByAddress(const uint64_t address) const
+{
+  return address_index_.FindStartingAt(address);
+}
+
+size_t SymbolTable::FindSymbolAtOrBefore(const uint64_t address) const
+{
+  return address_index_.FindStartingAtOrBefore(address);
+}
+
+size_t SymbolTable::FindSymbolContaining(const uint64_t address) const
+{
+  return address_index_.FindContaining(address);
+}
+
+void SymbolTable::FindSymbolsContaining(const uint64_t *const addresses,
+                                        const size_t count,
+                                        size_t *const symbols) const
+{
+  address_index_.FindContaining(addresses, count, symbols);
+}
+
+size_t SymbolTable::FindSymbolByName(const char *const name) const
+{
+  return name_index_.Find(name, strings_, columns_.names.data());
+}
+
+size_t SymbolTable::FindSymbolByName(const char *const name,
+                                     const uint64_t hash) const
+{
+  return name_index_.Find(name, hash, strings_, columns_.names.data());
 }
 
 std::string SymbolTable::ToString() const
 {
   std::stringstream res;
-  for (unsigned i = 0; i < symbols_.size(); i++) {
-    res << symbols_[i].ToString() << '\n';
+  for (size_t i = 0; i < size(); i++) {
+    res << symbol(i).ToString() << '\n';
   }
   return res.str();
 }
 
-SymbolTable::SymbolTable(
-    const char *const type,
-    std::vector<Symbol> &&symbols,
-    std::unordered_map<uint64_t, Symbol*> &&address_to_symbol,
-    std::unordered_map<std::string, Symbol*> &&name_to_symbol)
+SymbolTable::SymbolTable(const char *const type,
+                         const char *const strings,
+                         const uint64_t strings_size,
+                         Arena *const arena)
     : type_(type),
-      symbols_(symbols),
-      address_to_symbol_(address_to_symbol),
-      name_to_symbol_(name_to_symbol) { }
+      strings_(strings),
+      strings_size_(strings_size),
+      columns_(arena),
+      address_index_(),
+      name_index_() { }
+
+SymbolTable::SymbolTable(SymbolTable&&) = default;
 
 SymbolTable::~SymbolTable() { }
 
 SymbolTable SymbolTable::Parse(
     const char *const table_type,
     const uint8_t *const buf,
+    const uint64_t size,
     const Header *const header,
-    const std::vector<SectionHeader> &section_headers)
+    const ArenaVector<SectionHeader> &section_headers,
+    const SectionIndex &section_index,
+    Arena *const arena)
 {
-  std::string strtab_name(table_type);
-  strtab_name.replace(strtab_name.find("sym"), 3, "str");
-
-  const SectionHeader *symbol_table_header = nullptr;
-  const SectionHeader *string_table_header = nullptr;
-
-  // Extract the string and symbol table headers.
-  for (const SectionHeader &section_header : section_headers) {
-    if (!strcmp(table_type, section_header.kStringName)) {
-      symbol_table_header = &section_header;
-    }
-    if (!strcmp(strtab_name.c_str(), section_header.kStringName)) {
-      string_table_header = &section_header;
-    }
+  const std::string kStringTableName = StringTableName(table_type);
+  if (kStringTableName.empty()) {
+    return SymbolTable("N/A", "", 1, arena);
   }
 
-  if (!symbol_table_header || !string_table_header) {
-    return SymbolTable("N/A",
-                       std::vector<Symbol>(),
-                       std::unordered_map<uint64_t, Symbol*>(),
-                       std::unordered_map<std::string, Symbol*>());
+  // Look up the symbol and string table headers.
+  const size_t kSymbolTableIndex = section_index.Find(table_type);
+  const size_t kStringTableIndex
+      = section_index.Find(kStringTableName.c_str());
+  const SectionHeader *const symbol_table_header
+      = kSymbolTableIndex == SectionIndex::kNotFound
+      ? nullptr : &section_headers[kSymbolTableIndex];
+  const SectionHeader *const string_table_header
+      = kStringTableIndex == SectionIndex::kNotFound
+      ? nullptr : &section_headers[kStringTableIndex];
+
+  if (!symbol_table_header || !string_table_header
+      || !symbol_table_header->kEntrySize) {
+    return SymbolTable("N/A", "", 1, arena);
   }
 
   const uint64_t kSize = symbol_table_header->kSize ;
   const uint64_t kEntrySize = symbol_table_header->kEntrySize;
   const uint64_t kEntries = kSize / kEntrySize;
+  if (!ElfTableInBounds(symbol_table_header->kOffset, kEntries, kEntrySize,
+                        ElfSymbolMinSize(header->kClass), size)) {
+    return SymbolTable("N/A", "", 1, arena);
+  }
 
   const uint8_t *const symbol_table_base
         = buf + symbol_table_header->kOffset;
-  const char *const string_table_base
-      = reinterpret_cast<const char*>(buf) + string_table_header->kOffset;
+  uint64_t strings_size = 0;
+  const char *const string_table_base = LocateElfStringTable(
+      buf, size, string_table_header->kOffset, string_table_header->kSize,
+      &strings_size);
 
-  std::vector<Symbol> symbols;
-  symbols.reserve(kEntries);
+  SymbolTable table(table_type, string_table_base, strings_size, arena);
+  Columns &columns = table.columns_;
+  columns.names.resize(kEntries);
+  columns.values.resize(kEntries);
+  columns.sizes.resize(kEntries);
+  columns.infos.resize(kEntries);
+  columns.others.resize(kEntries);
+  columns.section_header_indices.resize(kEntries);
 
-  for (unsigned i = 0; i < kEntries; i++) {
-    const uint8_t *symbol_table_entry = symbol_table_base + i*kEntrySize;
+  // Each chunk of symbols decodes into its own slice of the columns.
+  const ElfEncoding kEncoding = GetElfEncoding(header->kClass, header->kData);
+  ParallelForRange(kEntries, kSymbolGrain,
+                   [&](const size_t begin, const size_t end) {
+    switch (kEncoding) {
+      case ElfEncoding::k32Lsb:
+        DecodeElfSymbols<ELFCLASS32, ELFDATA2LSB>(
+            symbol_table_base, begin, end, kEntrySize, strings_size,
+            &columns);
+        break;
+      case ElfEncoding::k32Msb:
+        DecodeElfSymbols<ELFCLASS32, ELFDATA2MSB>(
+            symbol_table_base, begin, end, kEntrySize, strings_size,
+            &columns);
+        break;
+      case ElfEncoding::k64Lsb:
+        DecodeElfSymbols<ELFCLASS64, ELFDATA2LSB>(
+            symbol_table_base, begin, end, kEntrySize, strings_size,
+            &columns);
+        break;
+      case ElfEncoding::k64Msb:
+        DecodeElfSymbols<ELFCLASS64, ELFDATA2MSB>(
+            symbol_table_base, begin, end, kEntrySize, strings_size,
+            &columns);
+        break;
+      case ElfEncoding::kUnknown: // FALLTHROUGH
+      default:
+        break;
+    }
+  });
+
+  // Index by address only the symbols that name a location.
+  std::vector<uint8_t> locates(kEntries);
+  ParallelForRange(kEntries, kSymbolGrain,
+                   [&](const size_t begin, const size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      const uint8_t kType = ELF64_ST_TYPE(columns.infos[i]);
+      locates[i] = columns.section_header_indices[i] != SHN_UNDEF
+          && kType != STT_SECTION
+          && kType != STT_FILE;
+    }
+  });
+
+  // The indexes are independent, so build them concurrently.
+  ThreadPool::Default()->ParallelFor(2, [&](const size_t i) {
+    if (i == 0) {
+      table.address_index_ = AddressIndex(columns.values.data(),
+                                          columns.sizes.data(),
+                                          locates.data(),
+                                          kEntries,
+                                          arena);
+    } else {
+      table.name_index_ = NameIndex(string_table_base,
+                                    columns.names.data(),
+                                    columns.names.size(),
+                                    arena);
+    }
+  });
 
-    symbols.push_back(Symbol{
-      ExtractElfSymbolName(symbol_table_entry, header),
-      string_table_base + ExtractElfSymbolName(symbol_table_entry, header),
-      ExtractElfSymbolValue(symbol_table_entry, header),
-      ExtractElfSymbolSize(symbol_table_entry, header),
-      ExtractElfSymbolInfo(symbol_table_entry, header),
-      ExtractElfSymbolOther(symbol_table_entry, header),
-      ExtractElfSymbolSectionHeaderIndex(symbol_table_entry, header),
-    });
+  return table;
+}
+
+SymbolTable SymbolTable::FromFrameRanges(
+    const char *const table_type,
+    const ArenaVector<FrameRange> &ranges,
+    const ArenaVector<SectionHeader> &section_headers,
+    const SymbolTable &names,
+    Arena *const arena)
+{
+  if (ranges.empty()) {
+    return SymbolTable("N/A", "", 1, arena);
   }
 
-  std::unordered_map<uint64_t, Symbol*> address_to_symbol;
-  std::unordered_map<std::string, Symbol*> name_to_symbol;
-  address_to_symbol.reserve(kEntries);
-  name_to_symbol.reserve(kEntries);
+  // The ranges are ordered by start, so the sections that may hold
+  // them are ordered by address and found by a cursor that only moves
+  // forward.
+  std::vector<uint16_t> executable;
+  for (size_t i = 0; i < section_headers.size() && i < SHN_LORESERVE; i++) {
+    if ((section_headers[i].kFlags & SHF_EXECINSTR)
+        && section_headers[i].kSize) {
+      executable.push_back(static_cast<uint16_t>(i));
+    }
+  }
+  std::stable_sort(executable.begin(), executable.end(),
+                   [&section_headers](const uint16_t a, const uint16_t b) {
+    return section_headers[a].kAddress < section_headers[b].kAddress;
+  });
+  size_t after = 0;
 
-  for (Symbol &symbol : symbols) {
-    address_to_symbol[symbol.kValue] = &symbol;
-    name_to_symbol[std::string(symbol.kStringName)] = &symbol;
+  // Names are laid out as a string table, which starts with the empty
+  // name, and is only copied into the arena once complete.
+  SymbolTable table(table_type, "", 1, arena);
+  Columns &columns = table.columns_;
+  std::string strings(1, '\0');
+  for (const FrameRange &range : ranges) {
+    const size_t kNamed = names.FindSymbolByAddress(range.kStart);
+    columns.names.push_back(static_cast<uint32_t>(strings.size()));
+    if (kNamed != kNoSymbol && *names.name(kNamed)) {
+      strings += names.name(kNamed);
+    } else {
+      std::stringstream name;
+      name << "sub_" << std::hex << range.kStart;
+      strings += name.str();
+    }
+    strings += '\0';
+    columns.values.push_back(range.kStart);
+    columns.sizes.push_back(range.kSize);
+    columns.infos.push_back(ELF64_ST_INFO(
+        kNamed != kNoSymbol ? STB_GLOBAL : STB_LOCAL, STT_FUNC));
+    columns.others.push_back(STV_DEFAULT);
+    // The range lies in the last section starting at or before it, if
+    // that extends past its start.
+    while (after < executable.size()
+           && section_headers[executable[after]].kAddress <= range.kStart) {
+      after++;
+    }
+    uint16_t section = SHN_ABS;
+    if (after) {
+      const SectionHeader &header = section_headers[executable[after - 1]];
+      if (range.kStart - header.kAddress < header.kSize) {
+        section = executable[after - 1];
+      }
+    }
+    columns.section_header_indices.push_back(section);
   }
+  char *const kStrings
+      = static_cast<char *>(arena->Allocate(strings.size(), 1));
+  memcpy(kStrings, strings.data(), strings.size());
+  table.strings_ = kStrings;
+  table.strings_size_ = strings.size();
+
+  table.address_index_ = AddressIndex(columns.values.data(),
+                                      columns.sizes.data(),
+                                      nullptr,
+                                      ranges.size(),
+                                      arena);
+  table.name_index_ = NameIndex(kStrings,
+                                columns.names.data(),
+                                columns.names.size(),
+                                arena);
+  return table;
+}
+
+void SymbolTable::Serialize(const uint8_t *const buf, const uint64_t size,
+                            CacheWriter *const writer) const
+{
+  writer->Write<uint32_t>(strcmp(type_, "N/A") != 0);
+  writer->Write<uint64_t>(ElfStringTableOffset(buf, size, strings_));
+  writer->Write<uint64_t>(strings_size_);
+  writer->WriteArray(columns_.names);
+  writer->WriteArray(columns_.values);
+  writer->WriteArray(columns_.sizes);
+  writer->WriteArray(columns_.infos);
+  writer->WriteArray(columns_.others);
+  writer->WriteArray(columns_.section_header_indices);
+  address_index_.Serialize(writer);
+  name_index_.Serialize(writer);
+}
 
-  return SymbolTable(table_type,
-                     std::move(symbols),
-                     std::move(address_to_symbol),
-                     std::move(name_to_symbol));
+SymbolTable SymbolTable::Load(CacheReader *const reader,
+                              const char *const table_type,
+                              const uint8_t *const buf,
+                              const uint64_t size,
+                              Arena *const arena)
+{
+  const bool kPresent = reader->Read<uint32_t>(2);
+  const uint64_t kStringsOffset = reader->Read<uint64_t>();
+  const uint64_t kStringsSize = reader->Read<uint64_t>();
+  uint64_t strings_size = 0;
+  const char *const strings = LocateElfStringTable(
+      buf, size, kStringsOffset, kStringsSize, &strings_size);
+
+  SymbolTable table(kPresent ? table_type : "N/A", strings, strings_size,
+                    arena);
+  Columns &columns = table.columns_;
+  columns.names = reader->ReadArray<uint32_t>(strings_size, arena);
+  const size_t kEntries = columns.names.size();
+  columns.values = reader->ReadArray<uint64_t>(arena);
+  columns.sizes = reader->ReadArray<uint64_t>(arena);
+  columns.infos = reader->ReadArray<uint8_t>(arena);
+  columns.others = reader->ReadArray<uint8_t>(arena);
+  columns.section_header_indices = reader->ReadArray<uint16_t>(arena);
+  table.address_index_ = AddressIndex::Load(reader, kEntries, arena);
+  table.name_index_ = NameIndex::Load(reader, kEntries, arena);
+
+  if (strings_size != kStringsSize
+      || columns.values.size() != kEntries
+      || columns.sizes.size() != kEntries
+      || columns.infos.size() != kEntries
+      || columns.others.size() != kEntries
+      || columns.section_header_indices.size() != kEntries) {
+    reader->Fail();
+    return SymbolTable("N/A", "", 1, arena);
+  }
+  return table;
+}
+
+SymbolRange ParseElfSymbolViews(const char *const table_type,
+                                const uint8_t *const buf,
+                                const uint64_t size,
+                                const Header *const header,
+                                const SectionIndex &section_index)
+{
+  const std::string kStringTableName = StringTableName(table_type);
+  if (kStringTableName.empty()) {
+    return SymbolRange();
+  }
+
+  const ElfBinary::SectionHeaderRange section_headers
+      = ParseElfSectionHeaderViews(buf, size, header);
+
+  // Look up the indices of the symbol and string table headers.
+  const size_t kSymbolTableIndex = section_index.Find(table_type);
+  const size_t kStringTableIndex
+      = section_index.Find(kStringTableName.c_str());
+  if (kSymbolTableIndex >= section_headers.size()
+      || kStringTableIndex >= section_headers.size()) {
+    return SymbolRange();
+  }
+
+  const SectionHeaderView symbol_table_header
+      = section_headers[kSymbolTableIndex];
+  const SectionHeaderView string_table_header
+      = section_headers[kStringTableIndex];
+  const uint64_t kEntrySize = symbol_table_header.entry_size();
+  if (!kEntrySize) {
+    return SymbolRange();
+  }
+  const uint64_t kEntries = symbol_table_header.size() / kEntrySize;
+  if (!ElfTableInBounds(symbol_table_header.offset(), kEntries, kEntrySize,
+                        ElfSymbolMinSize(header->kClass), size)) {
+    return SymbolRange();
+  }
+
+  uint64_t strings_size = 0;
+  const char *const strings = LocateElfStringTable(
+      buf, size, string_table_header.offset(), string_table_header.size(),
+      &strings_size);
+  return SymbolRange(
+      buf + symbol_table_header.offset(),
+      kEntries,
+      kEntrySize,
+      GetElfEncoding(header->kClass, header->kData),
+      strings,
+      strings_size);
+}
+
+uint32_t SymbolView::name() const
+{
+  DECODE_ELF_FIELD(ExtractElfSymbolName, encoding_, entry_);
+}
+
+const char *SymbolView::string_name() const
+{
+  return strings_ + ElfStringOffset(name(), strings_size_);
+}
+
+uint64_t SymbolView::value() const
+{
+  DECODE_ELF_FIELD(ExtractElfSymbolValue, encoding_, entry_);
+}
+
+uint64_t SymbolView::size() const
+{
+  DECODE_ELF_FIELD(ExtractElfSymbolSize, encoding_, entry_);
+}
+
+uint8_t SymbolView::info() const
+{
+  DECODE_ELF_FIELD(ExtractElfSymbolInfo, encoding_, entry_);
+}
+
+uint8_t SymbolView::other() const
+{
+  DECODE_ELF_FIELD(ExtractElfSymbolOther, encoding_, entry_);
+}
+
+uint16_t SymbolView::section_header_index() const
+{
+  DECODE_ELF_FIELD(ExtractElfSymbolSectionHeaderIndex, encoding_, entry_);
+}
+
+Symbol SymbolView::Materialize() const
+{
+  return Symbol{
+    ElfStringOffset(name(), strings_size_),
+    string_name(),
+    value(),
+    size(),
+    info(),
+    other(),
+    section_header_index(),
+  };
 }
@@ -1,48 +1,232 @@
 #ifndef BINARY_MATCHER_ELF_BINARY_SYMBOL_TABLE_H
 #define BINARY_MATCHER_ELF_BINARY_SYMBOL_TABLE_H
 
+#include "arena.h"
+#include "binary_cache.h"
 #include "elf/elf_binary.h"
+#include "elf/elf_binary_address_index.h"
+#include "elf/elf_binary_field.h"
+#include "elf/elf_binary_frame.h"
 #include "elf/elf_binary_header.h"
+#include "elf/elf_binary_name_index.h"
 #include "elf/elf_binary_section_header.h"
 #include "elf/elf_binary_symbol.h"
+#include "elf/elf_binary_view_range.h"
 
+#include <stddef.h>
 #include <stdint.h>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
+// Type that represents an ELF symbol table.
+// Symbols are stored column-wise, one array per field, so that a scan
+// over one field (e.g. every symbol's value) touches only that
+// field's memory, and no per-symbol padding or pointers are stored.
 class ElfBinary::SymbolTable {
 public:
+  // Type holding the fields of every symbol in the table.
+  // The i'th element of each array belongs to the i'th symbol.
+  struct Columns {
+    // Offsets of the symbols' names into the string table.
+    ArenaVector<uint32_t> names;
+    // The symbols' values.
+    ArenaVector<uint64_t> values;
+    // The symbols' sizes.
+    ArenaVector<uint64_t> sizes;
+    // The symbols' types and bindings.
+    ArenaVector<uint8_t> infos;
+    // The symbols' visibilities.
+    ArenaVector<uint8_t> others;
+    // The indices of the sections the symbols are defined in.
+    ArenaVector<uint16_t> section_header_indices;
+
+    // Constructs empty columns, which grow into the arena.
+    explicit Columns(Arena *const arena);
+    Columns(Columns&&);
+    ~Columns();
+  };
+
+  // The index returned by lookups that find no symbol.
+  static const size_t kNoSymbol = SIZE_MAX;
+
+  // Parses the symbol table of the given type (".dynsym" or ".symtab")
+  // from the buffer of size bytes, allocating its columns and indexes
+  // from the arena. If the binary has no such table, or it does not lie
+  // within the buffer, returns an empty table of type "N/A". Names that
+  // lie outside the string table are empty.
+  // Large tables are decoded and indexed in parallel on the default
+  // thread pool; the result does not depend on the number of threads.
   static SymbolTable Parse(
       const char *const type,
       const uint8_t *const buf,
+      const uint64_t size,
       const ElfBinary::Header *const header,
-      const std::vector<ElfBinary::SectionHeader> &section_headers);
+      const ArenaVector<ElfBinary::SectionHeader> &section_headers,
+      const ElfBinary::SectionIndex &section_index,
+      Arena *const arena);
 
+  // Synthesizes a table of the given type holding a function symbol
+  // for each of the ranges, which must be ordered by start address
+  // (see ParseElfFrameRanges), allocating it from the arena. Each
+  // symbol is named after a symbol of names that starts where it does,
+  // if there is one, and otherwise sub_ followed by its address in
+  // hex, and is defined in the executable section containing its
+  // start, or SHN_ABS if there is none. Returns an empty table of type
+  // "N/A" if there are no ranges.
+  // Stripped binaries keep .eh_frame, as the unwinder needs it, so
+  // this outlines their functions without disassembling them.
+  static SymbolTable FromFrameRanges(
+      const char *const type,
+      const ArenaVector<ElfBinary::FrameRange> &ranges,
+      const ArenaVector<ElfBinary::SectionHeader> &section_headers,
+      const SymbolTable &names,
+      Arena *const arena);
+
+  // Returns the type of the table.
   const char *type() const;
 
-  const ElfBinary::Symbol *GetSymbolByAddress(const uint32_t address) const;
-  const ElfBinary::Symbol *GetSymbolByName(const char *const name) const;
+  // Returns the number of symbols in the table.
+  size_t size() const;
+
+  // Returns the columns holding the table's symbols.
+  const Columns &columns() const;
+
+  // Returns the name of the i'th symbol.
+  const char *name(const size_t i) const;
+
+  // Returns a materialized copy of the i'th symbol.
+  ElfBinary::Symbol symbol(const size_t i) const;
+
+  // Returns the index of a symbol whose value is the given address,
+  // or kNoSymbol if there is none. Where several symbols share the
+  // address, returns the last of them.
+  // Only symbols defined in some section, other than section and file
+  // symbols, are found by address.
+  size_t FindSymbolByAddress(const uint64_t address) const;
+
+  // Returns the index of the symbol with the greatest value at or
+  // below the given address, or kNoSymbol if there is none. Where
+  // several symbols share that value, returns the last of them.
+  // Symbols are found as FindSymbolByAddress finds them.
+  size_t FindSymbolAtOrBefore(const uint64_t address) const;
+
+  // Returns the index of the symbol whose [value, value + size) range
+  // contains the given address, or kNoSymbol if there is none.
+  // Where symbols are nested, returns the innermost.
+  size_t FindSymbolContaining(const uint64_t address) const;
+
+  // Finds the symbol containing each of count addresses, as
+  // FindSymbolContaining, storing their indices in symbols.
+  // Much faster than separate lookups for large batches.
+  void FindSymbolsContaining(const uint64_t *const addresses,
+                             const size_t count,
+                             size_t *const symbols) const;
+
+  // Returns the index of a symbol with the given name, or kNoSymbol
+  // if there is none. Where several symbols share the name, returns
+  // the last of them.
+  size_t FindSymbolByName(const char *const name) const;
+
+  // As above, given the name's hash as computed by NameIndex::Hash.
+  size_t FindSymbolByName(const char *const name, const uint64_t hash) const;
 
   // Constructs a string representation of the symbol table
   // that contains each symbol in the table's string representation.
   std::string ToString() const;
 
-  // Default copy and assignment constructors do the right thing.
-  SymbolTable(const SymbolTable&) = default;
-  SymbolTable &operator=(const ElfBinary::SymbolTable&) = default;
+  // Appends the table and its indexes to writer, to be read back by
+  // Load. The table must have been parsed from the buffer of size
+  // bytes.
+  void Serialize(const uint8_t *const buf, const uint64_t size,
+                 CacheWriter *const writer) const;
+
+  // Reads a table of the given type that Serialize wrote from reader,
+  // given the same buffer, allocating its columns and indexes from the
+  // arena. Fails the reader if it does not hold a valid table.
+  static SymbolTable Load(CacheReader *const reader,
+                          const char *const type,
+                          const uint8_t *const buf,
+                          const uint64_t size,
+                          Arena *const arena);
+
+  // Tables are moved rather than copied; delete copy and assignment.
+  SymbolTable(const SymbolTable&) = delete;
+  SymbolTable &operator=(const ElfBinary::SymbolTable&) = delete;
+  SymbolTable(SymbolTable&&);
 
   ~SymbolTable();
 private:
-  SymbolTable(const char *const type,
-      std::vector<ElfBinary::Symbol> &&symbols,
-      std::unordered_map<uint64_t, Symbol*> &&address_to_symbol,
-      std::unordered_map<std::string, Symbol*> &&name_to_symbol);
-
-  const char *const type_;
-  const std::vector<ElfBinary::Symbol> symbols_;
-  const std::unordered_map<uint64_t, Symbol*> address_to_symbol_;
-  const std::unordered_map<std::string, Symbol*> name_to_symbol_;
+  // Constructs an empty table of the given type, whose symbol names
+  // are offsets into the strings_size bytes of strings, and whose
+  // columns grow into the arena.
+  SymbolTable(const char *const type, const char *const strings,
+              const uint64_t strings_size, Arena *const arena);
+
+  // The type of the table.
+  const char *type_;
+  // The string table that symbol names are offsets into.
+  const char *strings_;
+  // The size of the string table.
+  uint64_t strings_size_;
+  // The symbols in the table.
+  Columns columns_;
+  // Indices of the symbols, keyed by the range of addresses they cover.
+  ElfBinary::AddressIndex address_index_;
+  // Indices of the symbols, keyed by name.
+  ElfBinary::NameIndex name_index_;
+};
+
+// Type that provides a view of an ELF symbol in place in the
+// binary's buffer. Fields are decoded when requested rather than
+// copied out up front.
+class ElfBinary::SymbolView {
+public:
+  // Constructs a view of the symbol at entry, whose name is an
+  // offset into the strings_size bytes of the string table strings.
+  SymbolView(const uint8_t *const entry,
+             const ElfEncoding encoding,
+             const char *const strings,
+             const uint64_t strings_size)
+    : entry_(entry),
+      encoding_(encoding),
+      strings_(strings),
+      strings_size_(strings_size) { }
+
+  // Accessors for the fields of the symbol.
+  // See Symbol for a description of each field.
+  uint32_t name() const;
+  const char *string_name() const;
+  uint64_t value() const;
+  uint64_t size() const;
+  uint8_t info() const;
+  uint8_t other() const;
+  uint16_t section_header_index() const;
+
+  // Decodes every field of the symbol.
+  ElfBinary::Symbol Materialize() const;
+
+private:
+  // The symbol's entry in the buffer.
+  const uint8_t *entry_;
+  // The class and data encoding of the binary.
+  ElfEncoding encoding_;
+  // The string table associated with the symbol table.
+  const char *strings_;
+  // The size of the string table.
+  uint64_t strings_size_;
 };
 
+// Returns views of the symbols in the symbol table of the given
+// type (".symtab" or ".dynsym") in the given buffer of size bytes,
+// without decoding or copying any of them. The table and its string
+// table are found through the binary's section index.
+// Returns an empty range if there is no such table, or it does not
+// lie within the buffer.
+ElfBinary::SymbolRange
+ParseElfSymbolViews(const char *const type,
+                    const uint8_t *const buf,
+                    const uint64_t size,
+                    const ElfBinary::Header *const header,
+                    const ElfBinary::SectionIndex &section_index);
+
 #endif // BINARY_MATCHER_ELF_BINARY_SYMBOL_TABLE_H
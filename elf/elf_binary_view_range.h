@@ -0,0 +1,121 @@
+#ifndef BINARY_MATCHER_ELF_BINARY_VIEW_RANGE_H
+#define BINARY_MATCHER_ELF_BINARY_VIEW_RANGE_H
+
+#include "elf/elf_binary.h"
+#include "elf/elf_binary_field.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Type representing a table of fixed-size ELF entries (e.g. section
+// headers or symbols) in the binary's buffer, presented as a range of
+// View objects. Nothing is decoded or allocated until an entry's
+// fields are requested through its view.
+// View must be constructible from the entry's address, the binary's
+// encoding, and the string table that the entries' names index into
+// and its size, as located by LocateElfStringTable.
+template <typename View>
+class ElfBinary::ViewRange {
+public:
+  // Forward iterator over the views in the range.
+  class Iterator {
+  public:
+    Iterator(const uint8_t *const entry, const size_t entry_size,
+             const ElfEncoding encoding, const char *const strings,
+             const uint64_t strings_size)
+      : entry_(entry),
+        entry_size_(entry_size),
+        encoding_(encoding),
+        strings_(strings),
+        strings_size_(strings_size) { }
+
+    View operator*() const
+    {
+      return View(entry_, encoding_, strings_, strings_size_);
+    }
+
+    Iterator &operator++()
+    {
+      entry_ += entry_size_;
+      return *this;
+    }
+
+    bool operator==(const Iterator &other) const
+    {
+      return entry_ == other.entry_;
+    }
+
+    bool operator!=(const Iterator &other) const
+    {
+      return entry_ != other.entry_;
+    }
+
+  private:
+    const uint8_t *entry_;
+    size_t entry_size_;
+    ElfEncoding encoding_;
+    const char *strings_;
+    uint64_t strings_size_;
+  };
+
+  // Constructs an empty range.
+  ViewRange()
+    : base_(nullptr),
+      count_(0),
+      entry_size_(0),
+      encoding_(ElfEncoding::kUnknown),
+      strings_(""),
+      strings_size_(1) { }
+
+  // Constructs a range of count entries, each entry_size bytes,
+  // starting at base, whose names index into the strings_size bytes
+  // of strings.
+  ViewRange(const uint8_t *const base, const size_t count,
+            const size_t entry_size, const ElfEncoding encoding,
+            const char *const strings, const uint64_t strings_size)
+    : base_(base),
+      count_(count),
+      entry_size_(entry_size),
+      encoding_(encoding),
+      strings_(strings),
+      strings_size_(strings_size) { }
+
+  // Returns the number of entries in the range.
+  size_t size() const { return count_; }
+
+  // Returns true if the range has no entries.
+  bool empty() const { return count_ == 0; }
+
+  // Returns a view of the i'th entry.
+  View operator[](const size_t i) const
+  {
+    return View(base_ + i*entry_size_, encoding_, strings_, strings_size_);
+  }
+
+  Iterator begin() const
+  {
+    return Iterator(base_, entry_size_, encoding_, strings_, strings_size_);
+  }
+
+  Iterator end() const
+  {
+    return Iterator(base_ + count_*entry_size_,
+                    entry_size_, encoding_, strings_, strings_size_);
+  }
+
+private:
+  // The first entry in the table.
+  const uint8_t *base_;
+  // The number of entries in the table.
+  size_t count_;
+  // The size of each entry.
+  size_t entry_size_;
+  // The class and data encoding of the binary.
+  ElfEncoding encoding_;
+  // The string table that entry names are offsets into.
+  const char *strings_;
+  // The size of the string table.
+  uint64_t strings_size_;
+};
+
+#endif // BINARY_MATCHER_ELF_BINARY_VIEW_RANGE_H
@@ -1,47 +1,202 @@
 #include "file.h"
+#include "status.h"
 
 #include <errno.h>
 #include <fcntl.h>
+#include <memory>
 #include <stdio.h>
-#include <stdlib.h>
+#include <string.h>
+#include <string>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
-File::File(const char *const filename)
-  : filename_(filename),
-    fd_(-1),
-    size_(0),
-    buf_(nullptr)
+namespace {
+
+// Returns a status describing the failure of the named system call
+// on filename, from errno.
+static Status SystemError(const char *const call,
+                          const char *const filename)
+{
+  return Status(Status::Code::kIoError,
+                std::string(call) + " " + filename + ": " + strerror(errno));
+}
+
+// The size of the buffer first allocated for a stream. It doubles
+// each time it fills, so a stream of n bytes is read with O(log n)
+// remappings, none of which copy its contents.
+const size_t kStreamInitialCapacity = 1 << 20;
+
+// Converts an access pattern into the madvise advice describing it.
+inline static int AccessAdvice(const File::Access kAccess)
+{
+  switch (kAccess) {
+    case File::Access::kNormal: return MADV_NORMAL;
+    case File::Access::kSequential: return MADV_SEQUENTIAL;
+    case File::Access::kRandom: return MADV_RANDOM;
+    case File::Access::kWillNeed: return MADV_WILLNEED;
+    default: return MADV_NORMAL;
+  }
+}
+
+} // namespace
+
+File::Options::Options()
+  : access(Access::kNormal),
+    populate(false),
+    huge_pages(false) { }
+
+Result<File> File::Open(const char *const filename, const Options &options)
 {
-  fd_ = open(filename, O_RDONLY);
-  if (fd_ < 0) {
-    perror("open");
-    exit(1);
+  const int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return SystemError("open", filename);
   }
   struct stat buf;
-  if (fstat(fd_, &buf) < 0) {
-    perror("stat");
-    exit(1);
+  if (fstat(fd, &buf) < 0) {
+    const Status status = SystemError("stat", filename);
+    close(fd);
+    return status;
   }
-  size_ = static_cast<size_t>(buf.st_size);
-  buf_ = static_cast<uint8_t*>(
-    mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0)
-  );
-  if (buf_ == MAP_FAILED) {
-    perror("mmap");
-    exit(1);
+  const Identity kIdentity{
+    static_cast<uint64_t>(buf.st_dev),
+    static_cast<uint64_t>(buf.st_ino),
+    static_cast<uint64_t>(buf.st_size),
+    static_cast<int64_t>(buf.st_mtim.tv_sec) * 1000000000
+        + buf.st_mtim.tv_nsec,
+  };
+  Result<File> file = Map(fd, filename, kIdentity, options);
+
+  // The mapping outlives the descriptor, so close it now rather than
+  // hold one open for every File.
+  close(fd);
+  return file;
+}
+
+Result<File> File::Map(const int fd, const char *const filename,
+                       const Identity &identity, const Options &options)
+{
+  const size_t size = static_cast<size_t>(identity.size);
+  // mmap rejects empty mappings, and an empty file needs none.
+  void *map = nullptr;
+  if (size) {
+    const int kFlags = MAP_SHARED | (options.populate ? MAP_POPULATE : 0);
+    map = mmap(nullptr, size, PROT_READ, kFlags, fd, 0);
+    if (map == MAP_FAILED) {
+      return SystemError("mmap", filename);
+    }
+    madvise(map, size, AccessAdvice(options.access));
+#ifdef MADV_HUGEPAGE
+    if (options.huge_pages) {
+      madvise(map, size, MADV_HUGEPAGE);
+    }
+#endif
   }
+  return std::unique_ptr<File>(
+      new File(filename, static_cast<uint8_t*>(map), size, size, false,
+               identity));
 }
 
-File::~File()
+Result<File> File::ReadStream(const int fd, const char *const filename,
+                              const size_t prefix_size,
+                              const StreamInspector &inspect)
+{
+  size_t capacity = kStreamInitialCapacity;
+  void *map = mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (map == MAP_FAILED) {
+    return SystemError("mmap", filename);
+  }
+
+  size_t size = 0;
+  bool inspected = !inspect;
+  Status status;
+  while (status.ok()) {
+    if (size == capacity) {
+      // Growing the mapping moves its pages rather than copying them.
+      void *const grown = mremap(map, capacity, 2*capacity, MREMAP_MAYMOVE);
+      if (grown == MAP_FAILED) {
+        status = SystemError("mremap", filename);
+        break;
+      }
+      map = grown;
+      capacity *= 2;
+    }
+    // Read as much as the buffer can take, so that a fast producer
+    // is drained in few calls.
+    const ssize_t kRead
+        = read(fd, static_cast<uint8_t*>(map) + size, capacity - size);
+    if (kRead < 0) {
+      if (errno != EINTR) {
+        status = SystemError("read", filename);
+      }
+      continue;
+    }
+    if (kRead == 0) {
+      break;
+    }
+    size += static_cast<size_t>(kRead);
+    if (!inspected && size >= prefix_size) {
+      inspected = true;
+      status = inspect(static_cast<const uint8_t*>(map), size);
+    }
+  }
+  if (status.ok() && !inspected) {
+    status = inspect(static_cast<const uint8_t*>(map), size);
+  }
+  if (!status.ok()) {
+    munmap(map, capacity);
+    return status;
+  }
+
+  // The contents are read only from here on, as a mapped file's are.
+  mprotect(map, capacity, PROT_READ);
+  return std::unique_ptr<File>(
+      new File(filename, static_cast<uint8_t*>(map), size, capacity, true,
+               Identity()));
+}
+
+File::File(const char *const filename, uint8_t *const buf, const size_t size,
+           const size_t capacity, const bool streamed,
+           const Identity &identity)
+  : filename_(filename),
+    size_(size),
+    buf_(buf),
+    capacity_(capacity),
+    streamed_(streamed),
+    identity_(identity) { }
+
+void File::Prefetch(const uint64_t offset, const uint64_t length) const
+{
+  Advise(offset, length, MADV_WILLNEED);
+}
+
+void File::Release(const uint64_t offset, const uint64_t length) const
+{
+  // Dropping pages of anonymous memory would discard the contents.
+  if (!streamed_) {
+    Advise(offset, length, MADV_DONTNEED);
+  }
+}
+
+void File::Advise(const uint64_t offset, const uint64_t length,
+                  const int advice) const
 {
-  if (close(fd_) == -1) {
-    perror("close");
-    exit(1);
+  if (offset >= size_ || !length) {
+    return;
   }
-  if (munmap(buf_, size_) == -1) {
+  const uint64_t kEnd = length < size_ - offset ? offset + length : size_;
+
+  // madvise applies to whole pages, starting on a page boundary.
+  static const uint64_t kPageSize
+      = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  const uint64_t kStart = offset & ~(kPageSize - 1);
+  madvise(buf_ + kStart, kEnd - kStart, advice);
+}
+
+File::~File()
+{
+  if (buf_ && munmap(buf_, capacity_) == -1) {
     perror("munmap");
-    exit(1);
   }
 }
@@ -1,6 +1,9 @@
 #ifndef BINARY_MATCHER_FILE_H
 #define BINARY_MATCHER_FILE_H
 
+#include "status.h"
+
+#include <functional>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -11,40 +14,148 @@
 // of the File.
 class File {
 public:
-  // Constructs a File with the given filename.
-  // If there is an error constructing the file, prints
-  // an error to stderr and exits the program.
-  File(const char *const filename);
+  // An enumeration of the patterns in which a file's contents may be
+  // read, passed to the kernel so that it can tune its readahead.
+  enum class Access {
+    // No particular pattern; the kernel's default readahead.
+    kNormal,
+    // Read from start to end; read ahead aggressively, and drop
+    // pages soon after they have been read.
+    kSequential,
+    // Read in no particular order; read only the pages faulted on.
+    kRandom,
+    // Read in full, soon; start reading in the whole file now.
+    kWillNeed,
+  };
+
+  // Options controlling how a file is mapped.
+  struct Options {
+    // Constructs the default options: kNormal access, with neither
+    // populate nor huge_pages.
+    Options();
+
+    // The pattern in which the file's contents will be read.
+    Access access;
+    // If true, read in the whole file while mapping it
+    // (MAP_POPULATE), so that no later read faults.
+    bool populate;
+    // If true, advise the kernel to back the mapping with
+    // transparent huge pages where it can, so that a large file
+    // needs fewer TLB entries and page faults.
+    bool huge_pages;
+  };
+
+  // Identifies the version of a file on disk that a File was mapped
+  // from: modifying or replacing the file changes its identity, so
+  // that anything derived from its contents can be checked against it.
+  struct Identity {
+    // The device and inode number of the file.
+    uint64_t device;
+    uint64_t inode;
+    // The size of the file.
+    uint64_t size;
+    // The time the file was last modified, in nanoseconds since the
+    // epoch.
+    int64_t modified;
+  };
+
+  // Opens and maps the file with the given filename, which must
+  // outlive the File, as the options direct.
+  // If the file cannot be opened, stat'd or mapped, returns a
+  // status describing the error. Advice the kernel rejects is
+  // ignored, since it affects only performance.
+  static Result<File> Open(const char *const filename,
+                           const Options &options = Options());
+
+  // Maps the open file fd, which has the given identity, naming the
+  // result filename, as Open does once it has opened and stat'd the
+  // file. fd is not closed, and may be closed as soon as this returns.
+  static Result<File> Map(const int fd, const char *const filename,
+                          const Identity &identity,
+                          const Options &options = Options());
+
+  // Function inspecting the first bytes of a stream as it is read.
+  // Returning a failed status stops the read.
+  using StreamInspector
+      = std::function<Status(const uint8_t *prefix, size_t size)>;
+
+  // Reads the whole of the stream fd, which need not be seekable
+  // (e.g. a pipe, or stdin), into a page-aligned buffer that grows as
+  // the stream does, and names the result filename, which must
+  // outlive the File. The stream is not closed.
+  // Once prefix_size bytes, or the whole stream if it is shorter,
+  // have arrived, inspect is passed them. If it fails, the rest of
+  // the stream is left unread and its status returned, so that a
+  // stream that does not hold what is expected is rejected at once.
+  // If reading fails, returns a status describing the error.
+  static Result<File> ReadStream(const int fd, const char *const filename,
+                                 const size_t prefix_size,
+                                 const StreamInspector &inspect);
 
   // Delete copy constructor and assignment.
   File(const File&) = delete;
   File &operator=(const File&) = delete;
 
   // Releases the resources associated with the File.
-  // If there is an error releasing resources, prints
-  // an error to stderr and exits the program.
   ~File();
 
   // Returns the filename associated with the File.
   const char *filename() const { return filename_; }
 
   // Returns the raw memory buffer that the File manages.
+  // An empty file has no buffer, and returns nullptr.
   const uint8_t *buffer() const { return buf_; }
 
   // Returns the total size of the File.
   size_t size() const { return size_; }
+
+  // Returns the identity of the file that the File was mapped from,
+  // or nullptr if it was read from a stream, which has none.
+  const Identity *identity() const { return streamed_ ? nullptr : &identity_; }
+
+  // Advises the kernel that the length bytes at offset are about to
+  // be read, so that it reads them in ahead of the faults that would
+  // otherwise read them a few pages at a time. The range is clamped
+  // to the file, and the call returns without waiting for the read.
+  void Prefetch(const uint64_t offset, const uint64_t length) const;
+
+  // Advises the kernel that the length bytes at offset will not be
+  // read again soon, so that their pages can be dropped from the
+  // process. Reading them again faults them back in, usually from
+  // the page cache. The range is clamped to the file.
+  // A File read from a stream has no file to fault pages back in
+  // from, so it keeps every page.
+  void Release(const uint64_t offset, const uint64_t length) const;
 private:
+  // Constructs a File that owns the mapping of capacity bytes at buf,
+  // of which the first size bytes hold its contents. If streamed, the
+  // mapping is anonymous memory that the contents were read into, and
+  // identity is ignored.
+  File(const char *const filename, uint8_t *const buf, const size_t size,
+       const size_t capacity, const bool streamed, const Identity &identity);
+
+  // Passes advice on the length bytes at offset to the kernel.
+  void Advise(const uint64_t offset, const uint64_t length,
+              const int advice) const;
+
   // The filename of the File.
   const char *const filename_;
 
-  // The file descriptor of the File.
-  int fd_;
-
   // The size of the File.
   size_t size_;
 
   // The underlying buffer that the File uses.
   uint8_t *buf_;
+
+  // The size of the mapping at buf_, which for a stream may exceed
+  // the size of the File.
+  size_t capacity_;
+
+  // True if the File was read from a stream into anonymous memory.
+  bool streamed_;
+
+  // The identity of the file mapped, unless streamed_.
+  Identity identity_;
 };
 
 #endif // BINARY_MATCHER_FILE_H
@@ -0,0 +1,604 @@
+#include "file.h"
+#include "file_loader.h"
+#include "status.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <mutex>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// The most files loaded at once through io_uring.
+const size_t kRingFiles = 64;
+
+// The number of submission entries in the ring. A file has at most
+// two operations queued at once: its stat and its read, once open.
+const unsigned kRingEntries = 2 * kRingFiles;
+
+// The number of threads that load files when io_uring is unavailable.
+// Loading waits on the disk rather than the CPU, so there are more of
+// them than there are hardware threads.
+const size_t kLoaderThreads = 16;
+
+// The number of bytes read from the start of each file as it is
+// opened, so that the headers the parser reads first are in the page
+// cache by the time the file is mapped.
+const unsigned kHeaderReadSize = 4096;
+
+// An enumeration of the operations that load a file through the ring.
+enum class Operation : uint64_t {
+  kOpen,
+  kStat,
+  kRead,
+};
+
+// The number of distinct operations, by which user data is scaled.
+const uint64_t kOperations = 3;
+
+// Converts an operation into the name of the call it stands for.
+inline static const char *OperationString(const Operation kOperation)
+{
+  switch (kOperation) {
+    case Operation::kOpen: return "open";
+    case Operation::kStat: return "stat";
+    case Operation::kRead: return "read";
+    default: return "UNKNOWN";
+  }
+}
+
+// Returns a status describing the failure, with the given errno, of
+// the named system call on filename.
+static Status LoadError(const char *const call, const char *const filename,
+                        const int error)
+{
+  return Status(Status::Code::kIoError,
+                std::string(call) + " " + filename + ": " + strerror(error));
+}
+
+// Returns the identity of the file described by attributes.
+inline static File::Identity StatxIdentity(const struct statx &attributes)
+{
+  return File::Identity{
+    static_cast<uint64_t>(makedev(attributes.stx_dev_major,
+                                  attributes.stx_dev_minor)),
+    attributes.stx_ino,
+    attributes.stx_size,
+    attributes.stx_mtime.tv_sec * 1000000000
+        + static_cast<int64_t>(attributes.stx_mtime.tv_nsec),
+  };
+}
+
+// Class that owns an io_uring instance: a queue of submitted
+// operations that the kernel consumes, and a queue of completions
+// that it posts their results to. See man 7 io_uring.
+class Ring {
+public:
+  // Sets up a ring of entries submission entries. If the kernel does
+  // not support io_uring, or any operation that loading uses, the
+  // ring is not ok.
+  explicit Ring(const unsigned entries);
+
+  // Delete copy constructor and assignment.
+  Ring(const Ring&) = delete;
+  Ring &operator=(const Ring&) = delete;
+
+  // Tears down the ring.
+  ~Ring();
+
+  // Returns true if the ring was set up.
+  bool ok() const;
+
+  // Returns the number of submission entries that NextEntry can
+  // return before the kernel takes those already queued.
+  unsigned available() const;
+
+  // Returns the number of operations that the kernel took from the
+  // submission queue whose completions were not yet removed.
+  unsigned in_flight() const;
+
+  // Returns the next submission entry, cleared, for Submit to submit.
+  // Returns nullptr if every entry is queued.
+  io_uring_sqe *NextEntry();
+
+  // Submits the entries returned by NextEntry since the last call,
+  // waiting for at least one operation to complete if wait is set.
+  // The kernel may take only some of them, or none if it is short of
+  // resources, leaving the rest queued for the next call.
+  // Returns false if the kernel rejects the submission.
+  bool Submit(const bool wait);
+
+  // Waits for at least one operation to complete, submitting nothing.
+  // Returns false if the kernel fails the wait.
+  bool Wait();
+
+  // Removes the oldest completion into *cqe, returning false if there
+  // is none.
+  bool NextCompletion(io_uring_cqe *const cqe);
+
+private:
+  // Returns true if the kernel supports the given operation.
+  bool Supports(const unsigned opcode) const;
+
+  // Unmaps the queues and closes the ring.
+  void Close();
+
+  // The ring's file descriptor, or -1 if it is not set up.
+  int fd_;
+  // The submission queue ring, its entries and the completion queue
+  // ring, as mapped from the kernel, and their sizes.
+  void *sq_ring_;
+  size_t sq_ring_size_;
+  void *sqes_;
+  size_t sqes_size_;
+  void *cq_ring_;
+  size_t cq_ring_size_;
+  // Fields of the submission queue ring.
+  unsigned *sq_head_;
+  unsigned *sq_tail_;
+  unsigned sq_mask_;
+  unsigned sq_entries_;
+  unsigned *sq_array_;
+  // The tail of the submission queue, including entries not yet
+  // submitted.
+  unsigned sq_next_;
+  // Fields of the completion queue ring.
+  unsigned *cq_head_;
+  unsigned *cq_tail_;
+  unsigned cq_mask_;
+  io_uring_cqe *cqes_;
+  // The number of completions removed, counted from the head of the
+  // submission queue as it was set up, so that it can be compared
+  // with the number of entries the kernel took.
+  unsigned completed_;
+};
+
+// Returns the field at offset bytes into ring.
+template <typename T>
+inline static T *RingField(void *const ring, const uint32_t offset)
+{
+  return reinterpret_cast<T*>(static_cast<uint8_t*>(ring) + offset);
+}
+
+// Maps the part of the ring fd at the given offset.
+static void *MapRing(const int fd, const size_t size, const off_t offset)
+{
+  return mmap(nullptr, size, PROT_READ | PROT_WRITE,
+              MAP_SHARED | MAP_POPULATE, fd, offset);
+}
+
+Ring::Ring(const unsigned entries)
+  : fd_(-1),
+    sq_ring_(MAP_FAILED),
+    sq_ring_size_(0),
+    sqes_(MAP_FAILED),
+    sqes_size_(0),
+    cq_ring_(MAP_FAILED),
+    cq_ring_size_(0),
+    sq_head_(nullptr),
+    sq_tail_(nullptr),
+    sq_mask_(0),
+    sq_entries_(0),
+    sq_array_(nullptr),
+    sq_next_(0),
+    cq_head_(nullptr),
+    cq_tail_(nullptr),
+    cq_mask_(0),
+    cqes_(nullptr),
+    completed_(0)
+{
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  const long kFd = syscall(__NR_io_uring_setup, entries, &params);
+  if (kFd < 0) {
+    return;
+  }
+  fd_ = static_cast<int>(kFd);
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  cq_ring_size_
+      = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  sq_ring_ = MapRing(fd_, sq_ring_size_, IORING_OFF_SQ_RING);
+  sqes_ = MapRing(fd_, sqes_size_, IORING_OFF_SQES);
+  cq_ring_ = MapRing(fd_, cq_ring_size_, IORING_OFF_CQ_RING);
+  if (sq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED
+      || cq_ring_ == MAP_FAILED) {
+    Close();
+    return;
+  }
+
+  sq_head_ = RingField<unsigned>(sq_ring_, params.sq_off.head);
+  sq_tail_ = RingField<unsigned>(sq_ring_, params.sq_off.tail);
+  sq_mask_ = *RingField<unsigned>(sq_ring_, params.sq_off.ring_mask);
+  sq_entries_ = params.sq_entries;
+  sq_array_ = RingField<unsigned>(sq_ring_, params.sq_off.array);
+  sq_next_ = *sq_tail_;
+  completed_ = *sq_head_;
+  cq_head_ = RingField<unsigned>(cq_ring_, params.cq_off.head);
+  cq_tail_ = RingField<unsigned>(cq_ring_, params.cq_off.tail);
+  cq_mask_ = *RingField<unsigned>(cq_ring_, params.cq_off.ring_mask);
+  cqes_ = RingField<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+
+  if (!Supports(IORING_OP_OPENAT) || !Supports(IORING_OP_STATX)
+      || !Supports(IORING_OP_READ)) {
+    Close();
+  }
+}
+
+Ring::~Ring()
+{
+  Close();
+}
+
+bool Ring::ok() const
+{
+  return fd_ >= 0;
+}
+
+unsigned Ring::available() const
+{
+  return sq_entries_
+      - (sq_next_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE));
+}
+
+unsigned Ring::in_flight() const
+{
+  return __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) - completed_;
+}
+
+io_uring_sqe *Ring::NextEntry()
+{
+  const unsigned kHead = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+  if (sq_next_ - kHead >= sq_entries_) {
+    return nullptr;
+  }
+  const unsigned kIndex = sq_next_ & sq_mask_;
+  sq_array_[kIndex] = kIndex;
+  sq_next_++;
+  io_uring_sqe *const sqe = static_cast<io_uring_sqe*>(sqes_) + kIndex;
+  memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+bool Ring::Submit(const bool wait)
+{
+  __atomic_store_n(sq_tail_, sq_next_, __ATOMIC_RELEASE);
+  for (;;) {
+    const unsigned kQueued
+        = sq_next_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    const long kResult = syscall(__NR_io_uring_enter, fd_, kQueued,
+                                 wait ? 1 : 0,
+                                 wait ? IORING_ENTER_GETEVENTS : 0,
+                                 nullptr, 0);
+    if (kResult >= 0) {
+      return true;
+    }
+    // The kernel is short of resources, or of room for completions;
+    // both pass once the pending completions are consumed.
+    if (errno == EAGAIN || errno == EBUSY) {
+      return true;
+    }
+    if (errno != EINTR) {
+      return false;
+    }
+  }
+}
+
+bool Ring::Wait()
+{
+  for (;;) {
+    if (syscall(__NR_io_uring_enter, fd_, 0, 1, IORING_ENTER_GETEVENTS,
+                nullptr, 0) >= 0) {
+      return true;
+    }
+    if (errno != EINTR) {
+      return false;
+    }
+  }
+}
+
+bool Ring::NextCompletion(io_uring_cqe *const cqe)
+{
+  const unsigned kHead = *cq_head_;
+  if (kHead == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+  *cqe = cqes_[kHead & cq_mask_];
+  __atomic_store_n(cq_head_, kHead + 1, __ATOMIC_RELEASE);
+  completed_++;
+  return true;
+}
+
+bool Ring::Supports(const unsigned opcode) const
+{
+  // A probe is followed by an entry for every operation.
+  const unsigned kProbedOperations = 256;
+  std::vector<uint8_t> buffer(
+      sizeof(io_uring_probe) + kProbedOperations * sizeof(io_uring_probe_op));
+  io_uring_probe *const probe
+      = reinterpret_cast<io_uring_probe*>(buffer.data());
+  if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE,
+              probe, kProbedOperations) < 0) {
+    return false;
+  }
+  return opcode <= probe->last_op
+      && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+}
+
+void Ring::Close()
+{
+  if (sq_ring_ != MAP_FAILED) {
+    munmap(sq_ring_, sq_ring_size_);
+    sq_ring_ = MAP_FAILED;
+  }
+  if (sqes_ != MAP_FAILED) {
+    munmap(sqes_, sqes_size_);
+    sqes_ = MAP_FAILED;
+  }
+  if (cq_ring_ != MAP_FAILED) {
+    munmap(cq_ring_, cq_ring_size_);
+    cq_ring_ = MAP_FAILED;
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+// Type tracking the loading of one file through the ring.
+struct Slot {
+  // The position of the file's name among those loaded.
+  size_t index;
+  // The file's descriptor, once it has been opened.
+  int fd;
+  // The errno of the first operation on the file to fail, or 0.
+  int error;
+  // The operation that failed.
+  Operation failed;
+  // The number of the file's operations that have yet to complete.
+  unsigned pending;
+  // The file's attributes, which the kernel writes once stat'd.
+  struct statx attributes;
+  // The start of the file, which the kernel reads into.
+  uint8_t header[kHeaderReadSize];
+};
+
+// Queues the operation on slot number slot in the ring, which must
+// have an entry available.
+inline static io_uring_sqe *QueueOperation(Ring *const ring,
+                                           const size_t slot,
+                                           const Operation kOperation)
+{
+  io_uring_sqe *const sqe = ring->NextEntry();
+  sqe->opcode = static_cast<uint8_t>(
+      kOperation == Operation::kOpen ? IORING_OP_OPENAT
+      : kOperation == Operation::kStat ? IORING_OP_STATX
+      : IORING_OP_READ);
+  sqe->user_data = slot * kOperations + static_cast<uint64_t>(kOperation);
+  return sqe;
+}
+
+// Queues the stat and the read of the open file of slot number kSlot
+// in the ring, which must have two entries available.
+static void QueueStatAndRead(Ring *const ring, const size_t kSlot,
+                             Slot *const slot)
+{
+  // Stat the open file rather than its path, as File::Open does, so
+  // that the identity is that of the file mapped even if the path is
+  // replaced in between.
+  io_uring_sqe *const stat = QueueOperation(ring, kSlot, Operation::kStat);
+  stat->fd = slot->fd;
+  stat->addr = reinterpret_cast<uint64_t>("");
+  stat->statx_flags = AT_EMPTY_PATH;
+  stat->len = STATX_SIZE | STATX_INO | STATX_MTIME;
+  stat->off = reinterpret_cast<uint64_t>(&slot->attributes);
+
+  // Read the first page, so that it is cached when it is mapped.
+  io_uring_sqe *const read = QueueOperation(ring, kSlot, Operation::kRead);
+  read->fd = slot->fd;
+  read->addr = reinterpret_cast<uint64_t>(slot->header);
+  read->len = kHeaderReadSize;
+  read->off = 0;
+}
+
+// Waits for every operation that the kernel took from the ring to
+// complete, recording the descriptors of the files opened in their
+// slots, so that none writes to the slots once they are freed.
+// Returns false if the ring cannot be waited on.
+static bool DrainRing(Ring *const ring, std::vector<Slot> *const slots)
+{
+  while (ring->in_flight()) {
+    if (!ring->Wait()) {
+      return false;
+    }
+    io_uring_cqe cqe;
+    while (ring->NextCompletion(&cqe)) {
+      if (static_cast<Operation>(cqe.user_data % kOperations)
+              == Operation::kOpen
+          && cqe.res >= 0) {
+        (*slots)[static_cast<size_t>(cqe.user_data / kOperations)].fd
+            = cqe.res;
+      }
+    }
+  }
+  return true;
+}
+
+// Loads the named files through the ring, calling ready with each as
+// it completes. If the ring fails, calls ready with a failed status
+// for every file not yet loaded.
+static void LoadFilesThroughRing(Ring *const ring,
+                                 const std::vector<const char*> &filenames,
+                                 const File::Options &options,
+                                 const FileReady &ready)
+{
+  std::vector<Slot> slots(std::min(kRingFiles, filenames.size()));
+  std::vector<size_t> free_slots;
+  for (size_t i = slots.size(); i > 0; i--) {
+    slots[i - 1].fd = -1;
+    free_slots.push_back(i - 1);
+  }
+  // The slots whose files are open, whose stat and read wait for room
+  // in the ring.
+  std::vector<size_t> opened;
+
+  size_t next = 0;
+  size_t loading = 0;
+  std::vector<bool> delivered(filenames.size());
+  while (next < filenames.size() || loading) {
+    // The kernel may leave entries queued, so operations are only
+    // queued as far as the ring has room; the rest wait for the next
+    // round. Opened files go first, as they hold descriptors.
+    while (!opened.empty() && ring->available() >= 2) {
+      QueueStatAndRead(ring, opened.back(), &slots[opened.back()]);
+      opened.pop_back();
+    }
+    // Fill every free slot with the next file, starting with its open.
+    while (next < filenames.size() && !free_slots.empty()
+           && ring->available() >= 1) {
+      const size_t kSlot = free_slots.back();
+      free_slots.pop_back();
+      Slot &slot = slots[kSlot];
+      slot.index = next;
+      slot.fd = -1;
+      slot.error = 0;
+      slot.pending = 1;
+
+      io_uring_sqe *const open = QueueOperation(ring, kSlot, Operation::kOpen);
+      open->fd = AT_FDCWD;
+      open->addr = reinterpret_cast<uint64_t>(filenames[next]);
+      open->open_flags = O_RDONLY | O_CLOEXEC;
+
+      next++;
+      loading++;
+    }
+
+    if (!ring->Submit(true)) {
+      // Nothing more can be loaded; report why for every file. The
+      // operations the kernel took still write into their slots, and
+      // its opens still return descriptors, so they are waited for
+      // first. If even that fails, the slots are never freed, rather
+      // than written to once they are.
+      const int kError = errno;
+      const bool kDrained = DrainRing(ring, &slots);
+      for (const Slot &slot : slots) {
+        if (slot.fd >= 0) {
+          close(slot.fd);
+        }
+      }
+      if (!kDrained) {
+        static_cast<void>(new std::vector<Slot>(std::move(slots)));
+      }
+      for (size_t i = 0; i < filenames.size(); i++) {
+        if (!delivered[i]) {
+          ready(i, LoadError("io_uring_enter", filenames[i], kError));
+        }
+      }
+      return;
+    }
+
+    io_uring_cqe cqe;
+    while (ring->NextCompletion(&cqe)) {
+      const size_t kSlot = static_cast<size_t>(cqe.user_data / kOperations);
+      const Operation kOperation
+          = static_cast<Operation>(cqe.user_data % kOperations);
+      Slot &slot = slots[kSlot];
+      slot.pending--;
+      if (cqe.res < 0 && !slot.error) {
+        slot.error = -cqe.res;
+        slot.failed = kOperation;
+      }
+      if (kOperation == Operation::kOpen && cqe.res >= 0) {
+        slot.fd = cqe.res;
+        if (!slot.error) {
+          // The stat and read are counted from now, so that the slot
+          // is not taken to be complete while they wait for room.
+          slot.pending += 2;
+          opened.push_back(kSlot);
+        }
+      }
+      if (slot.pending) {
+        continue;
+      }
+
+      // Every operation on the file is complete, so none will write to
+      // the slot again.
+      const char *const kFilename = filenames[slot.index];
+      Result<File> file = slot.error
+          ? Result<File>(LoadError(OperationString(slot.failed), kFilename,
+                                   slot.error))
+          : File::Map(slot.fd, kFilename, StatxIdentity(slot.attributes),
+                      options);
+      if (slot.fd >= 0) {
+        close(slot.fd);
+        slot.fd = -1;
+      }
+      free_slots.push_back(kSlot);
+      loading--;
+      delivered[slot.index] = true;
+      ready(slot.index, std::move(file));
+    }
+  }
+}
+
+// Loads the named files on a pool of threads, calling ready with each
+// on the calling thread as it completes.
+static void LoadFilesOnThreads(const std::vector<const char*> &filenames,
+                               const File::Options &options,
+                               const FileReady &ready)
+{
+  std::mutex mutex;
+  std::condition_variable loaded;
+  std::deque<std::pair<size_t, Result<File>>> files;
+  {
+    ThreadPool pool(std::min(kLoaderThreads, filenames.size()));
+    for (size_t i = 0; i < filenames.size(); i++) {
+      pool.Submit([&, i] {
+        Result<File> file = File::Open(filenames[i], options);
+        std::lock_guard<std::mutex> lock(mutex);
+        files.emplace_back(i, std::move(file));
+        loaded.notify_one();
+      });
+    }
+    for (size_t i = 0; i < filenames.size(); i++) {
+      std::unique_lock<std::mutex> lock(mutex);
+      loaded.wait(lock, [&files] { return !files.empty(); });
+      std::pair<size_t, Result<File>> file = std::move(files.front());
+      files.pop_front();
+      lock.unlock();
+      ready(file.first, std::move(file.second));
+    }
+  }
+}
+
+} // namespace
+
+void LoadFiles(const std::vector<const char*> &filenames,
+               const File::Options &options,
+               const FileReady &ready)
+{
+  if (filenames.empty()) {
+    return;
+  }
+  Ring ring(kRingEntries);
+  if (ring.ok()) {
+    LoadFilesThroughRing(&ring, filenames, options, ready);
+    return;
+  }
+  LoadFilesOnThreads(filenames, options, ready);
+}
@@ -0,0 +1,28 @@
+#ifndef BINARY_MATCHER_FILE_LOADER_H
+#define BINARY_MATCHER_FILE_LOADER_H
+
+#include "file.h"
+#include "status.h"
+
+#include <functional>
+#include <stddef.h>
+#include <vector>
+
+// Function receiving a loaded file: the position of its name among
+// those loaded, and the File, or the status describing why it could
+// not be loaded.
+using FileReady = std::function<void(size_t index, Result<File> file)>;
+
+// Opens, stats and maps every named file, as File::Open does, with
+// many files in flight at once, so that a batch of files on a cold
+// cache costs a few round trips to the disk rather than one per file.
+// Opens, stats and a read of each file's first page are submitted
+// through io_uring where the kernel supports it, and otherwise issued
+// from a pool of threads. Either way, ready is called with each file
+// on the calling thread, in the order the files finish loading rather
+// than the order of filenames, which must outlive the Files.
+void LoadFiles(const std::vector<const char*> &filenames,
+               const File::Options &options,
+               const FileReady &ready);
+
+#endif // BINARY_MATCHER_FILE_LOADER_H
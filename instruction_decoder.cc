@@ -0,0 +1,308 @@
+#include "instruction_decoder.h"
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace {
+
+// The operands that follow an x86-64 opcode, as flags.
+// The opcode is followed by a ModRM byte.
+const uint16_t M = 1 << 0;
+// An 8-bit immediate.
+const uint16_t I8 = 1 << 1;
+// A 16-bit immediate.
+const uint16_t I16 = 1 << 2;
+// An immediate of the operand size, at most 32 bits.
+const uint16_t IZ = 1 << 3;
+// An immediate of the operand size, up to 64 bits (MOV r, imm).
+const uint16_t IV = 1 << 4;
+// An 8-bit branch displacement.
+const uint16_t R8 = 1 << 5;
+// A 32-bit branch displacement.
+const uint16_t R32 = 1 << 6;
+// A memory offset of the address size (MOV with moffs).
+const uint16_t MO = 1 << 7;
+// The opcode is invalid in 64-bit mode.
+const uint16_t X = 1 << 8;
+
+// The operands of each opcode of the one-byte map. Prefixes and the
+// escapes to other maps are decoded before the table is consulted.
+const uint16_t kOneByteMap[256] = {
+  // 0x00
+  M, M, M, M, I8, IZ, X, X, M, M, M, M, I8, IZ, X, 0,
+  // 0x10
+  M, M, M, M, I8, IZ, X, X, M, M, M, M, I8, IZ, X, X,
+  // 0x20
+  M, M, M, M, I8, IZ, 0, X, M, M, M, M, I8, IZ, 0, X,
+  // 0x30
+  M, M, M, M, I8, IZ, 0, X, M, M, M, M, I8, IZ, 0, X,
+  // 0x40
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  // 0x50
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  // 0x60
+  X, X, X, M, 0, 0, 0, 0, IZ, M|IZ, I8, M|I8, 0, 0, 0, 0,
+  // 0x70
+  R8, R8, R8, R8, R8, R8, R8, R8, R8, R8, R8, R8, R8, R8, R8, R8,
+  // 0x80
+  M|I8, M|IZ, X, M|I8, M, M, M, M, M, M, M, M, M, M, M, M,
+  // 0x90
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, X, 0, 0, 0, 0, 0,
+  // 0xa0
+  MO, MO, MO, MO, 0, 0, 0, 0, I8, IZ, 0, 0, 0, 0, 0, 0,
+  // 0xb0
+  I8, I8, I8, I8, I8, I8, I8, I8, IV, IV, IV, IV, IV, IV, IV, IV,
+  // 0xc0
+  M|I8, M|I8, I16, 0, X, X, M|I8, M|IZ, I16|I8, 0, I16, 0, 0, I8, X, 0,
+  // 0xd0
+  M, M, M, M, X, X, X, 0, M, M, M, M, M, M, M, M,
+  // 0xe0
+  R8, R8, R8, R8, I8, I8, I8, I8, R32, R32, X, R8, 0, 0, 0, 0,
+  // 0xf0
+  0, 0, 0, 0, 0, 0, M, M, 0, 0, 0, 0, 0, 0, M, M,
+};
+
+// The operands of each opcode of the two-byte (0x0f) map. The escapes
+// to the three-byte maps are decoded before the table is consulted.
+const uint16_t kTwoByteMap[256] = {
+  // 0x00
+  M, M, M, M, X, 0, 0, 0, 0, 0, X, 0, X, M, 0, M|I8,
+  // 0x10
+  M, M, M, M, M, M, M, M, M, M, M, M, M, M, M, M,
+  // 0x20
+  M, M, M, M, X, X, X, X, M, M, M, M, M, M, M, M,
+  // 0x30
+  0, 0, 0, 0, 0, 0, X, 0, X, X, X, X, X, X, X, X,
+  // 0x40
+  M, M, M, M, M, M, M, M, M, M, M, M, M, M, M, M,
+  // 0x50
+  M, M, M, M, M, M, M, M, M, M, M, M, M, M, M, M,
+  // 0x60
+  M, M, M, M, M, M, M, M, M, M, M, M, M, M, M, M,
+  // 0x70
+  M|I8, M|I8, M|I8, M|I8, M, M, M, 0, M, M, M, M, M, M, M, M,
+  // 0x80
+  R32, R32, R32, R32, R32, R32, R32, R32,
+  R32, R32, R32, R32, R32, R32, R32, R32,
+  // 0x90
+  M, M, M, M, M, M, M, M, M, M, M, M, M, M, M, M,
+  // 0xa0
+  0, 0, 0, M, M|I8, M, X, X, 0, 0, 0, M, M|I8, M, M, M,
+  // 0xb0
+  M, M, M, M, M, M, M, M, M, M, M|I8, M, M, M, M, M,
+  // 0xc0
+  M, M, M|I8, M, M|I8, M|I8, M|I8, M, 0, 0, 0, 0, 0, 0, 0, 0,
+  // 0xd0
+  M, M, M, M, M, M, M, M, M, M, M, M, M, M, M, M,
+  // 0xe0
+  M, M, M, M, M, M, M, M, M, M, M, M, M, M, M, M,
+  // 0xf0
+  M, M, M, M, M, M, M, M, M, M, M, M, M, M, M, M,
+};
+
+// Returns true if byte is a legacy prefix: a lock, repeat, segment,
+// operand size or address size prefix.
+inline static bool IsLegacyPrefix(const uint8_t byte)
+{
+  switch (byte) {
+    case 0xf0: case 0xf2: case 0xf3:
+    case 0x26: case 0x2e: case 0x36: case 0x3e: case 0x64: case 0x65:
+    case 0x66: case 0x67:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Returns the operands of opcode in the given map of a VEX or EVEX
+// prefix, or if xop is true of an XOP prefix.
+inline static uint16_t VexOperands(const bool xop, const uint8_t map,
+                                   const uint8_t opcode)
+{
+  if (xop) {
+    switch (map) {
+      case 8: return M|I8;
+      case 9: return M;
+      case 10: return M|IZ;
+      default: return X;
+    }
+  }
+  switch (map) {
+    case 1:
+      // VZEROUPPER and VZEROALL take no operands.
+      if (opcode == 0x77) {
+        return 0;
+      }
+      return (kTwoByteMap[opcode] & I8) ? M|I8 : M;
+    case 2: return M;
+    case 3: return M|I8;
+    // The maps of EVEX's half-precision instructions.
+    case 5: return M;
+    case 6: return M;
+    default: return X;
+  }
+}
+
+// Returns the value of the bits-bit field value, sign extended.
+inline static int64_t SignExtend(const uint32_t value, const unsigned bits)
+{
+  const uint32_t kSign = 1U << (bits - 1);
+  return static_cast<int64_t>(value ^ kSign) - static_cast<int64_t>(kSign);
+}
+
+} // namespace
+
+X86_64Instruction DecodeX86_64Instruction(const uint8_t *const code,
+                                          const size_t size)
+{
+  const X86_64Instruction kInvalid{0, 0, 0};
+  const size_t kLimit = std::min(size, kMaxX86_64InstructionSize);
+  size_t i = 0;
+  bool operand16 = false;
+  bool address32 = false;
+  bool rex_w = false;
+
+  // A REX prefix only counts if it is the last prefix.
+  while (i < kLimit && (IsLegacyPrefix(code[i]) || (code[i] & 0xf0) == 0x40)) {
+    operand16 |= code[i] == 0x66;
+    address32 |= code[i] == 0x67;
+    rex_w = (code[i] & 0xf8) == 0x48;
+    i++;
+  }
+  if (i >= kLimit) {
+    return kInvalid;
+  }
+
+  const uint8_t kOpcode = code[i++];
+  uint16_t operands;
+  if (kOpcode == 0xc4 || kOpcode == 0xc5 || kOpcode == 0x62
+      || (kOpcode == 0x8f && i < kLimit && (code[i] & 0x1f) >= 8)) {
+    // The prefix carries the opcode map, and is followed by the opcode.
+    const bool kXop = kOpcode == 0x8f;
+    const size_t kPayload = kOpcode == 0xc5 ? 1 : kOpcode == 0x62 ? 3 : 2;
+    if (i + kPayload >= kLimit) {
+      return kInvalid;
+    }
+    const uint8_t kMap = kOpcode == 0xc5 ? 1
+        : kOpcode == 0x62 ? code[i] & 0x07
+        : code[i] & 0x1f;
+    i += kPayload;
+    operands = VexOperands(kXop, kMap, code[i++]);
+  } else if (kOpcode == 0x0f) {
+    if (i >= kLimit) {
+      return kInvalid;
+    }
+    const uint8_t kSecond = code[i++];
+    if (kSecond == 0x38 || kSecond == 0x3a) {
+      if (i >= kLimit) {
+        return kInvalid;
+      }
+      i++;
+      operands = kSecond == 0x3a ? M|I8 : M;
+    } else {
+      operands = kTwoByteMap[kSecond];
+    }
+  } else {
+    operands = kOneByteMap[kOpcode];
+    // Only TEST, of the group of F6 and F7, takes an immediate.
+    if ((kOpcode == 0xf6 || kOpcode == 0xf7) && i < kLimit
+        && ((code[i] >> 3) & 7) < 2) {
+      operands |= kOpcode == 0xf6 ? I8 : IZ;
+    }
+    // XBEGIN's immediate is the displacement of its fallback.
+    if (kOpcode == 0xc7 && i < kLimit && code[i] == 0xf8) {
+      operands = M|R32;
+    }
+  }
+  if (operands & X) {
+    return kInvalid;
+  }
+
+  X86_64Instruction instruction{0, 0, 0};
+  if (operands & M) {
+    if (i >= kLimit) {
+      return kInvalid;
+    }
+    const uint8_t kModRm = code[i++];
+    const uint8_t kMod = kModRm >> 6;
+    const uint8_t kRm = kModRm & 7;
+    size_t displacement = kMod == 1 ? 1 : kMod == 2 ? 4 : 0;
+    if (kMod != 3 && kRm == 4) {
+      if (i >= kLimit) {
+        return kInvalid;
+      }
+      if (kMod == 0 && (code[i] & 7) == 5) {
+        displacement = 4;
+      }
+      i++;
+    }
+    if (kMod == 0 && kRm == 5) {
+      instruction.relative_offset = static_cast<uint8_t>(i);
+      instruction.relative_size = 4;
+      displacement = 4;
+    }
+    i += displacement;
+  }
+
+  size_t immediate = 0;
+  immediate += (operands & I8) ? 1 : 0;
+  immediate += (operands & I16) ? 2 : 0;
+  immediate += (operands & IZ) ? (operand16 ? 2 : 4) : 0;
+  immediate += (operands & IV) ? (rex_w ? 8 : operand16 ? 2 : 4) : 0;
+  immediate += (operands & MO) ? (address32 ? 4 : 8) : 0;
+  if (operands & (R8 | R32)) {
+    instruction.relative_offset = static_cast<uint8_t>(i);
+    instruction.relative_size = (operands & R8) ? 1 : 4;
+    immediate += instruction.relative_size;
+  }
+  i += immediate;
+  if (i > kLimit) {
+    return kInvalid;
+  }
+  instruction.length = static_cast<uint8_t>(i);
+  return instruction;
+}
+
+int64_t X86_64RelativeDisplacement(const uint8_t *const code,
+                                   const X86_64Instruction &instruction)
+{
+  // The field is little endian and signed.
+  const uint8_t *const kField = code + instruction.relative_offset;
+  uint32_t value = 0;
+  for (uint8_t i = instruction.relative_size; i-- > 0;) {
+    value = value << 8 | kField[i];
+  }
+  return SignExtend(value, 8U * instruction.relative_size);
+}
+
+AArch64RelativeField DecodeAArch64RelativeField(const uint32_t instruction)
+{
+  // B and BL.
+  if ((instruction & 0x7c000000) == 0x14000000) {
+    return AArch64RelativeField{
+      0x03ffffff, SignExtend(instruction & 0x03ffffff, 26) * 4, false};
+  }
+  // B.cond, CBZ and CBNZ, and literal loads.
+  if ((instruction & 0xff000000) == 0x54000000
+      || (instruction & 0x7e000000) == 0x34000000
+      || (instruction & 0x3b000000) == 0x18000000) {
+    return AArch64RelativeField{
+      0x00ffffe0, SignExtend((instruction >> 5) & 0x7ffff, 19) * 4, false};
+  }
+  // TBZ and TBNZ.
+  if ((instruction & 0x7e000000) == 0x36000000) {
+    return AArch64RelativeField{
+      0x0007ffe0, SignExtend((instruction >> 5) & 0x3fff, 14) * 4, false};
+  }
+  // ADR and ADRP, whose offset is split into high and low bits.
+  if ((instruction & 0x1f000000) == 0x10000000) {
+    const bool kPage = (instruction & 0x80000000) != 0;
+    const int64_t kOffset = SignExtend(
+        (((instruction >> 5) & 0x7ffff) << 2) | ((instruction >> 29) & 3),
+        21);
+    return AArch64RelativeField{
+      0x60ffffe0, kPage ? kOffset * 4096 : kOffset, kPage};
+  }
+  return AArch64RelativeField{0, 0, false};
+}
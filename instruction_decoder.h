@@ -0,0 +1,63 @@
+#ifndef BINARY_MATCHER_INSTRUCTION_DECODER_H
+#define BINARY_MATCHER_INSTRUCTION_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The most bytes that an x86-64 instruction can occupy.
+const size_t kMaxX86_64InstructionSize = 15;
+
+// The number of bytes of every AArch64 instruction.
+const size_t kAArch64InstructionSize = 4;
+
+// Type describing the layout of a decoded x86-64 instruction.
+struct X86_64Instruction {
+  // The number of bytes of the instruction, or 0 if the bytes do not
+  // begin a valid instruction.
+  uint8_t length;
+  // The offset within the instruction of the field holding its
+  // displacement from the end of the instruction (a relative branch's
+  // target, or a RIP-relative operand), and the number of bytes of the
+  // field, which is 0 if it has none. The field is little endian and
+  // signed.
+  uint8_t relative_offset;
+  uint8_t relative_size;
+};
+
+// Type describing the PC-relative field of an AArch64 instruction.
+struct AArch64RelativeField {
+  // The bits of the instruction that hold the field, or 0 if it has
+  // none.
+  uint32_t mask;
+  // The offset in bytes, from the instruction's address, of the
+  // location that the field refers to; for ADRP, from the address of
+  // the instruction's 4 KiB page instead.
+  int64_t offset;
+  // True if the field is ADRP's, whose offset is from a page.
+  bool page;
+};
+
+// Decodes the length of the x86-64 instruction at the start of the
+// size bytes at code, and where in it its relative field lies.
+// Decoding is driven by tables of the opcodes of each opcode map, in
+// the 64-bit mode, and reads at most kMaxX86_64InstructionSize bytes;
+// it allocates nothing, so it can be called once per instruction of
+// large bodies of code. Legacy, REX, VEX, EVEX and XOP prefixes are
+// understood; opcodes that are invalid in 64-bit mode, and
+// instructions that do not end within size bytes, are not valid.
+X86_64Instruction DecodeX86_64Instruction(const uint8_t *const code,
+                                          const size_t size);
+
+// Returns the displacement held in the relative field of the x86-64
+// instruction at code, as decoded by DecodeX86_64Instruction, which
+// must have one: the distance of its target from the instruction's
+// end.
+int64_t X86_64RelativeDisplacement(const uint8_t *const code,
+                                   const X86_64Instruction &instruction);
+
+// Decodes the PC-relative field, if any, of the AArch64 instruction
+// whose little-endian encoding is instruction: that of a branch
+// (B, BL, B.cond, CBZ, CBNZ, TBZ, TBNZ), a literal load, ADR or ADRP.
+AArch64RelativeField DecodeAArch64RelativeField(const uint32_t instruction);
+
+#endif // BINARY_MATCHER_INSTRUCTION_DECODER_H
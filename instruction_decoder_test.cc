@@ -0,0 +1,139 @@
+#include "instruction_decoder.h"
+#include "test.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace {
+
+// Checks that the bytes of code decode to one instruction of the given
+// length whose relative field lies at the given offset and size.
+static void ExpectX86_64Instruction(const std::vector<uint8_t> &code,
+                                    const uint8_t length,
+                                    const uint8_t relative_offset,
+                                    const uint8_t relative_size)
+{
+  const X86_64Instruction kInstruction
+      = DecodeX86_64Instruction(code.data(), code.size());
+  EXPECT_EQ(kInstruction.length, length);
+  EXPECT_EQ(kInstruction.relative_size, relative_size);
+  if (relative_size) {
+    EXPECT_EQ(kInstruction.relative_offset, relative_offset);
+  }
+}
+
+// Checks that the bytes of code do not begin a valid instruction.
+static void ExpectInvalidX86_64(const std::vector<uint8_t> &code)
+{
+  EXPECT_EQ(DecodeX86_64Instruction(code.data(), code.size()).length, 0);
+}
+
+static void TestX86_64Lengths()
+{
+  ExpectX86_64Instruction({0x90}, 1, 0, 0);                    // nop
+  ExpectX86_64Instruction({0xc3}, 1, 0, 0);                    // ret
+  ExpectX86_64Instruction({0x66, 0x90}, 2, 0, 0);              // xchg ax
+  ExpectX86_64Instruction({0x48, 0x89, 0xe5}, 3, 0, 0);        // mov
+  ExpectX86_64Instruction({0xf3, 0x0f, 0x1e, 0xfa}, 4, 0, 0);  // endbr64
+  ExpectX86_64Instruction({0x48, 0x83, 0xec, 0x08}, 4, 0, 0);  // sub $8
+  // movabs $imm64, %rax
+  ExpectX86_64Instruction({0x48, 0xb8, 1, 2, 3, 4, 5, 6, 7, 8}, 10, 0, 0);
+  // lea (%rbx,%rbx,2), %eax
+  ExpectX86_64Instruction({0x8d, 0x04, 0x5b}, 3, 0, 0);
+  // nopw %cs:0(%rax,%rax,1)
+  ExpectX86_64Instruction(
+      {0x66, 0x2e, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00},
+      10, 0, 0);
+  // vpxor %xmm0, %xmm0, %xmm0 (VEX)
+  ExpectX86_64Instruction({0xc5, 0xf9, 0xef, 0xc0}, 4, 0, 0);
+}
+
+static void TestX86_64RelativeFields()
+{
+  ExpectX86_64Instruction({0xe8, 0, 0, 0, 0}, 5, 1, 4);        // call
+  ExpectX86_64Instruction({0xe9, 0, 0, 0, 0}, 5, 1, 4);        // jmp
+  ExpectX86_64Instruction({0xeb, 0x05}, 2, 1, 1);              // jmp rel8
+  ExpectX86_64Instruction({0x74, 0xfe}, 2, 1, 1);              // je rel8
+  ExpectX86_64Instruction({0x0f, 0x84, 0, 0, 0, 0}, 6, 2, 4);  // je rel32
+  // lea disp(%rip), %rdi
+  ExpectX86_64Instruction({0x48, 0x8d, 0x3d, 0xc0, 0x0e, 0, 0}, 7, 3, 4);
+  // jmp *disp(%rip)
+  ExpectX86_64Instruction({0xff, 0x25, 0xca, 0x2f, 0, 0}, 6, 2, 4);
+  // movl $imm32, disp(%rip), whose field is followed by an immediate
+  ExpectX86_64Instruction({0xc7, 0x05, 0x10, 0, 0, 0, 1, 0, 0, 0},
+                          10, 2, 4);
+  // vmovdqa disp(%rip), %xmm0 (VEX)
+  ExpectX86_64Instruction({0xc5, 0xf9, 0x6f, 0x05, 0, 0, 0, 0}, 8, 4, 4);
+}
+
+static void TestX86_64Invalid()
+{
+  ExpectInvalidX86_64({});
+  // Instructions that do not end within the bytes given.
+  ExpectInvalidX86_64({0xe8, 0, 0});
+  ExpectInvalidX86_64({0x48});
+  ExpectInvalidX86_64({0x0f});
+  // Opcodes that are invalid in 64-bit mode: push %es, daa.
+  ExpectInvalidX86_64({0x06});
+  ExpectInvalidX86_64({0x27});
+  // More than kMaxX86_64InstructionSize bytes.
+  std::vector<uint8_t> prefixed(kMaxX86_64InstructionSize, 0x66);
+  prefixed.push_back(0x90);
+  ExpectInvalidX86_64(prefixed);
+}
+
+static void TestX86_64RelativeDisplacement()
+{
+  const struct {
+    std::vector<uint8_t> code;
+    int64_t displacement;
+  } kCases[] = {
+    {{0xeb, 0xfe}, -2},
+    {{0xeb, 0x7f}, 127},
+    {{0xe8, 0xfb, 0xff, 0xff, 0xff}, -5},
+    {{0xe8, 0x00, 0x01, 0x00, 0x00}, 256},
+    {{0x0f, 0x84, 0x00, 0x00, 0x00, 0x80}, INT32_MIN},
+    {{0xc7, 0x05, 0x10, 0, 0, 0, 0xff, 0xff, 0xff, 0xff}, 16},
+  };
+  for (const auto &kCase : kCases) {
+    const X86_64Instruction kInstruction
+        = DecodeX86_64Instruction(kCase.code.data(), kCase.code.size());
+    EXPECT(kInstruction.relative_size != 0);
+    if (kInstruction.relative_size) {
+      EXPECT_EQ(X86_64RelativeDisplacement(kCase.code.data(), kInstruction),
+                kCase.displacement);
+    }
+  }
+}
+
+static void TestAArch64RelativeFields()
+{
+  // bl .+4 and b .-4
+  AArch64RelativeField field = DecodeAArch64RelativeField(0x94000001);
+  EXPECT_EQ(field.mask, 0x03ffffffU);
+  EXPECT_EQ(field.offset, 4);
+  EXPECT(!field.page);
+  field = DecodeAArch64RelativeField(0x17ffffff);
+  EXPECT_EQ(field.offset, -4);
+  // adrp x0, .+4096
+  field = DecodeAArch64RelativeField(0xb0000000);
+  EXPECT(field.mask != 0);
+  EXPECT_EQ(field.offset, 4096);
+  EXPECT(field.page);
+  // add x0, x0, #1 and ret have none.
+  EXPECT_EQ(DecodeAArch64RelativeField(0x91000400).mask, 0U);
+  EXPECT_EQ(DecodeAArch64RelativeField(0xd65f03c0).mask, 0U);
+}
+
+} // namespace
+
+int main()
+{
+  RUN_TEST(TestX86_64Lengths);
+  RUN_TEST(TestX86_64RelativeFields);
+  RUN_TEST(TestX86_64Invalid);
+  RUN_TEST(TestX86_64RelativeDisplacement);
+  RUN_TEST(TestAArch64RelativeFields);
+  return TestStatus();
+}
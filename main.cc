@@ -1,22 +1,167 @@
 #include "binary.h"
+#include "binary_cache.h"
+#include "diff/diff.h"
 #include "file.h"
+#include "status.h"
 
 #include <memory>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+// The environment variable naming the directory, if any, that parsed
+// binaries are cached in.
+const char *const kCacheVariable = "BINARY_MATCHER_CACHE";
+
+// The environment variable that, if set and not empty, lets binaries
+// of the same size and build-id be reported identical unread.
+const char *const kTrustBuildIdVariable = "BINARY_MATCHER_TRUST_BUILD_ID";
+
+// The environment variable that, if set and not empty, adds a
+// function by function comparison to each diff.
+const char *const kFunctionsVariable = "BINARY_MATCHER_FUNCTIONS";
+
+// The environment variable that, if set and not empty, normalizes the
+// places patched by relocations before binaries are compared.
+const char *const kNormalizeRelocationsVariable
+    = "BINARY_MATCHER_NORMALIZE_RELOCATIONS";
+
+// The argument separating the old binaries from the new in batch mode.
+const char *const kBatchSeparator = "--";
+
+// Prints how the program is run to stderr, as program.
+static void PrintUsage(const char *const program)
+{
+  fprintf(stderr,
+          "usage: %s BINARY\n"
+          "       %s OLD NEW\n"
+          "       %s OLD... %s NEW...\n",
+          program, program, program, kBatchSeparator);
+}
+
+// Reads the named binary, reporting why to stderr if it cannot.
+static std::unique_ptr<Binary> ReadBinary(const char *const name,
+                                          const BinaryCache *const cache)
+{
+  Result<Binary> binary = Binary::ReadFromFile(name, File::Options(), cache);
+  if (!binary.ok()) {
+    fprintf(stderr, "Could not parse %s successfully: %s\n",
+            name, binary.status().ToString().c_str());
+  }
+  return binary.release();
+}
+
+// Stores the binary in the cache, if there is one, reporting why to
+// stderr if it cannot. Binaries read from streams are skipped.
+static void CacheBinary(const Binary &binary, const BinaryCache *const cache)
+{
+  if (!cache || !binary.file()->identity()) {
+    return;
+  }
+  const Status kStatus = binary.StoreInCache(*cache);
+  if (!kStatus.ok()) {
+    fprintf(stderr, "Could not cache %s: %s\n",
+            binary.filename(), kStatus.ToString().c_str());
+  }
+}
+
+} // namespace
 
 int main(int argc, const char **argv)
 {
+  const char *const kCacheDirectory = getenv(kCacheVariable);
+  const std::unique_ptr<BinaryCache> cache(
+      kCacheDirectory && *kCacheDirectory
+      ? new BinaryCache(kCacheDirectory) : nullptr);
+
+  if (argc > 2) {
+    // Diff mode: compare the two named binaries, exiting with 0
+    // if they are identical and 1 otherwise, as diff(1) does.
+    // In batch mode, the old binaries named before kBatchSeparator are
+    // each compared with the new binary named after it that they pair
+    // with (see PairBinaries). All binaries are loaded at once.
+    std::vector<const char*> names;
+    size_t old_count = 1;
+    for (int i = 1; i < argc; i++) {
+      if (!strcmp(argv[i], kBatchSeparator)) {
+        old_count = names.size();
+      } else {
+        names.push_back(argv[i]);
+      }
+    }
+    const bool kBatch = names.size() != static_cast<size_t>(argc - 1);
+    if (!kBatch && names.size() != 2) {
+      // Only batch mode compares more than two binaries.
+      PrintUsage(argv[0]);
+      return 2;
+    }
+
+    std::vector<std::unique_ptr<Binary>> binaries(names.size());
+    Binary::ReadFromFiles(names, File::Options(),
+                          [&binaries, &names](const size_t i,
+                                              Result<Binary> binary) {
+      if (!binary.ok()) {
+        fprintf(stderr, "Could not parse %s successfully: %s\n",
+                names[i], binary.status().ToString().c_str());
+      }
+      binaries[i] = binary.release();
+    }, cache.get());
+    std::vector<const Binary*> old_binaries;
+    std::vector<const Binary*> new_binaries;
+    for (size_t i = 0; i < binaries.size(); i++) {
+      if (!binaries[i]) {
+        return 2;
+      }
+      (i < old_count ? old_binaries : new_binaries).push_back(
+          binaries[i].get());
+    }
+
+    DiffOptions options;
+    const char *const kTrustBuildIds = getenv(kTrustBuildIdVariable);
+    options.trust_build_ids = kTrustBuildIds && *kTrustBuildIds;
+    const char *const kFunctions = getenv(kFunctionsVariable);
+    options.functions = kFunctions && *kFunctions;
+    const char *const kNormalizeRelocations
+        = getenv(kNormalizeRelocationsVariable);
+    options.normalize_relocations
+        = kNormalizeRelocations && *kNormalizeRelocations;
+    const std::vector<BinaryPair> pairs
+        = kBatch ? PairBinaries(old_binaries, new_binaries)
+                 : std::vector<BinaryPair>{BinaryPair{0, 0}};
+    bool identical = true;
+    for (const BinaryPair &pair : pairs) {
+      if (pair.kOld == BinaryPair::kNone || pair.kNew == BinaryPair::kNone) {
+        const bool kOld = pair.kNew == BinaryPair::kNone;
+        printf("Only in %s: %s\n", kOld ? "old" : "new",
+               kOld ? old_binaries[pair.kOld]->filename()
+                    : new_binaries[pair.kNew]->filename());
+        identical = false;
+        continue;
+      }
+      const BinaryDiff diff = Diff(*old_binaries[pair.kOld],
+                                   *new_binaries[pair.kNew], options);
+      printf("%s", diff.ToString().c_str());
+      identical = identical && diff.Identical();
+    }
+    for (const std::unique_ptr<Binary> &binary : binaries) {
+      CacheBinary(*binary, cache.get());
+    }
+    return identical ? 0 : 1;
+  }
+
   const char *const kBinaryName = argc > 1 ? argv[1] : argv[0];
 
-  std::unique_ptr<Binary>
-      binary(Binary::ReadFromFile(kBinaryName));
+  const std::unique_ptr<Binary> binary(ReadBinary(kBinaryName, cache.get()));
 
   if (!binary) {
-    fprintf(stderr, "Could not parse %s successfully\n", kBinaryName);
+    return 1;
   }
 
   printf("%s", binary->ToString().c_str());
+  CacheBinary(*binary, cache.get());
 
   return 0;
 }
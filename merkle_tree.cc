@@ -0,0 +1,161 @@
+#include "binary_cache.h"
+#include "digest.h"
+#include "merkle_tree.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace {
+
+// The fewest chunks worth digesting on another thread.
+const size_t kChunkGrain = 16;
+
+// Returns the number of chunks that size bytes are split into. Even
+// no bytes have one, empty, chunk, so that every tree has a root.
+inline static uint64_t ChunkCount(const uint64_t size)
+{
+  return std::max<uint64_t>(1, (size + MerkleTree::kChunkSize - 1)
+                               / MerkleTree::kChunkSize);
+}
+
+} // namespace
+
+const size_t MerkleTree::kChunkSize;
+const size_t MerkleTree::kFanout;
+
+MerkleTree::MerkleTree()
+  : size_(0),
+    nodes_(1, ComputeDigest(nullptr, 0)),
+    level_starts_{0, 1} { }
+
+MerkleTree::MerkleTree(const uint8_t *const data, const size_t size,
+                       Arena *const arena)
+  : size_(size),
+    nodes_(ArenaAllocator<ContentDigest>(arena)),
+    level_starts_(LevelStarts(size, arena))
+{
+  // Size every level up front, so that each is filled in place.
+  nodes_.resize(level_starts_.back());
+
+  const size_t kChunks = static_cast<size_t>(ChunkCount(size));
+  ParallelForRange(kChunks, kChunkGrain,
+                   [this, data, size](const size_t begin, const size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      const size_t kOffset = std::min(i*kChunkSize, size);
+      nodes_[i] = ComputeDigest(data + kOffset,
+                                std::min(kChunkSize, size - kOffset));
+    }
+  });
+
+  // Upper levels are a small fraction of the tree, so are digested on
+  // the calling thread.
+  for (size_t level = 1; level + 1 < level_starts_.size(); level++) {
+    const uint64_t kBelow = level_starts_[level - 1];
+    const uint64_t kBelowSize = LevelSize(level - 1);
+    for (uint64_t i = 0; i < LevelSize(level); i++) {
+      const uint64_t kFirst = i*kFanout;
+      const uint64_t kCount = std::min<uint64_t>(kFanout, kBelowSize - kFirst);
+      nodes_[level_starts_[level] + i] = ComputeDigest(
+          reinterpret_cast<const uint8_t*>(&nodes_[kBelow + kFirst]),
+          kCount * sizeof(ContentDigest));
+    }
+  }
+}
+
+MerkleTree::MerkleTree(MerkleTree&&) = default;
+
+MerkleTree &MerkleTree::operator=(MerkleTree&&) = default;
+
+MerkleTree::~MerkleTree() { }
+
+uint64_t MerkleTree::size() const
+{
+  return size_;
+}
+
+ContentDigest MerkleTree::root() const
+{
+  return nodes_.back();
+}
+
+ArenaVector<uint64_t> MerkleTree::LevelStarts(const uint64_t size,
+                                              Arena *const arena)
+{
+  ArenaVector<uint64_t> level_starts{ArenaAllocator<uint64_t>(arena)};
+  uint64_t count = ChunkCount(size);
+  uint64_t total = 0;
+  for (;;) {
+    level_starts.push_back(total);
+    total += count;
+    if (count == 1) {
+      break;
+    }
+    count = (count + kFanout - 1) / kFanout;
+  }
+  level_starts.push_back(total);
+  return level_starts;
+}
+
+uint64_t MerkleTree::LevelSize(const size_t level) const
+{
+  return level_starts_[level + 1] - level_starts_[level];
+}
+
+std::vector<uint64_t>
+MerkleTree::DifferingChunks(const MerkleTree &other) const
+{
+  // A node covers the same chunks in both trees, so nodes are compared
+  // from the highest level that both trees have.
+  const size_t kLevel = std::min(level_starts_.size(),
+                                 other.level_starts_.size()) - 2;
+  const uint64_t kCount = std::min(LevelSize(kLevel),
+                                   other.LevelSize(kLevel));
+  std::vector<uint64_t> chunks;
+  for (uint64_t i = 0; i < kCount; i++) {
+    Descend(other, kLevel, i, &chunks);
+  }
+  return chunks;
+}
+
+void MerkleTree::Descend(const MerkleTree &other, const size_t level,
+                         const uint64_t i,
+                         std::vector<uint64_t> *const chunks) const
+{
+  if (nodes_[level_starts_[level] + i]
+      == other.nodes_[other.level_starts_[level] + i]) {
+    return;
+  }
+  if (!level) {
+    chunks->push_back(i);
+    return;
+  }
+  const uint64_t kEnd = std::min(
+      (i + 1)*kFanout,
+      std::min(LevelSize(level - 1), other.LevelSize(level - 1)));
+  for (uint64_t child = i*kFanout; child < kEnd; child++) {
+    Descend(other, level - 1, child, chunks);
+  }
+}
+
+void MerkleTree::Serialize(CacheWriter *const writer) const
+{
+  writer->WriteArray(nodes_);
+}
+
+MerkleTree MerkleTree::Load(CacheReader *const reader, const uint64_t size,
+                            Arena *const arena)
+{
+  MerkleTree tree;
+  tree.size_ = size;
+  tree.nodes_ = reader->ReadArray<ContentDigest>(arena);
+  // The shape of the tree follows from its size.
+  tree.level_starts_ = LevelStarts(size, arena);
+  if (tree.nodes_.size() != tree.level_starts_.back()) {
+    reader->Fail();
+    return MerkleTree();
+  }
+  return tree;
+}
@@ -0,0 +1,87 @@
+#ifndef BINARY_MATCHER_MERKLE_TREE_H
+#define BINARY_MATCHER_MERKLE_TREE_H
+
+#include "arena.h"
+#include "binary_cache.h"
+#include "digest.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Type that represents a Merkle tree over a sequence of bytes: the
+// digests of its fixed size chunks, then of each run of kFanout
+// digests of the level below, up to a single root.
+// Comparing two trees descends only into subtrees whose digests
+// differ, so finding the few chunks that differ between two large
+// inputs costs time in proportion to the number that do, and reads
+// none of the bytes.
+class MerkleTree {
+public:
+  // The number of bytes in each chunk but the last.
+  static const size_t kChunkSize = 1 << 16;
+
+  // The number of nodes that each node above the chunks digests.
+  static const size_t kFanout = 16;
+
+  // Constructs a tree of no bytes.
+  MerkleTree();
+
+  // Builds a tree over the size bytes at data, allocated from the
+  // arena. Chunks are digested concurrently on the default thread pool.
+  MerkleTree(const uint8_t *const data, const size_t size,
+             Arena *const arena);
+
+  // Trees are moved rather than copied.
+  MerkleTree(const MerkleTree&) = delete;
+  MerkleTree &operator=(const MerkleTree&) = delete;
+  MerkleTree(MerkleTree&&);
+  MerkleTree &operator=(MerkleTree&&);
+
+  ~MerkleTree();
+
+  // Returns the number of bytes the tree covers.
+  uint64_t size() const;
+
+  // Returns the digest at the root of the tree.
+  ContentDigest root() const;
+
+  // Returns the numbers, in ascending order, of the chunks covered by
+  // both trees whose digests differ. Bytes in a chunk that is not
+  // reported are identical in both inputs; bytes that only one input
+  // has are not reported.
+  std::vector<uint64_t> DifferingChunks(const MerkleTree &other) const;
+
+  // Appends the tree to writer, to be read back by Load.
+  void Serialize(CacheWriter *const writer) const;
+
+  // Reads a tree that Serialize wrote from reader, allocating it from
+  // the arena. Fails the reader unless it holds a tree over size bytes.
+  static MerkleTree Load(CacheReader *const reader, const uint64_t size,
+                         Arena *const arena);
+
+private:
+  // Returns the position of the first node of each level of a tree
+  // over size bytes, followed by the number of nodes, allocated from
+  // the arena.
+  static ArenaVector<uint64_t> LevelStarts(const uint64_t size,
+                                           Arena *const arena);
+
+  // Returns the number of nodes at the given level.
+  uint64_t LevelSize(const size_t level) const;
+
+  // Appends to chunks the differing chunks below node i of the given
+  // level, whose digest differs from that of other's node.
+  void Descend(const MerkleTree &other, const size_t level, const uint64_t i,
+               std::vector<uint64_t> *const chunks) const;
+
+  // The number of bytes the tree covers.
+  uint64_t size_;
+  // The nodes of every level, from the chunks up to the root.
+  ArenaVector<ContentDigest> nodes_;
+  // The position in nodes_ of the first node of each level, followed
+  // by the number of nodes.
+  ArenaVector<uint64_t> level_starts_;
+};
+
+#endif // BINARY_MATCHER_MERKLE_TREE_H
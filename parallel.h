@@ -0,0 +1,82 @@
+#ifndef BINARY_MATCHER_PARALLEL_H
+#define BINARY_MATCHER_PARALLEL_H
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stddef.h>
+#include <utility>
+#include <vector>
+
+// Ranges shorter than this are sorted on the calling thread.
+const size_t kParallelSortThreshold = 1 << 16;
+
+// Calls body(begin, end) over consecutive chunks [begin, end) that
+// together cover [0, count), on the default thread pool. No chunk is
+// split smaller than grain elements, so that ranges too short to be
+// worth splitting run on the calling thread as a single chunk.
+// Chunk boundaries depend only on count and grain, never on timing.
+template <typename Body>
+void ParallelForRange(const size_t count, const size_t grain,
+                      const Body &body)
+{
+  ThreadPool *const pool = ThreadPool::Default();
+  // A few chunks per thread balance uneven chunks without
+  // paying per-chunk overhead on tiny ones.
+  const size_t kChunks = std::max<size_t>(1, std::min(
+      count / std::max<size_t>(1, grain), 4*pool->concurrency()));
+  pool->ParallelFor(kChunks, [count, kChunks, &body](const size_t i) {
+    body(count * i / kChunks, count * (i + 1) / kChunks);
+  });
+}
+
+// Sorts the range [first, last) with compare, on the default thread
+// pool. The range is split into one chunk per thread, the chunks are
+// sorted concurrently, and sorted neighbours are then merged pairwise
+// in concurrent rounds.
+// As with std::sort, the order of elements that compare equal is
+// unspecified, so compare should be a total order where the result
+// must be deterministic.
+template <typename Iterator, typename Compare>
+void ParallelSort(const Iterator first, const Iterator last,
+                  const Compare compare)
+{
+  ThreadPool *const pool = ThreadPool::Default();
+  const size_t kSize = static_cast<size_t>(std::distance(first, last));
+  const size_t kThreads = pool->concurrency();
+  if (kSize < kParallelSortThreshold || kThreads == 1) {
+    std::sort(first, last, compare);
+    return;
+  }
+
+  // Split into chunks, recording the boundaries between them.
+  std::vector<Iterator> bounds;
+  for (size_t i = 0; i <= kThreads; i++) {
+    bounds.push_back(first + static_cast<std::ptrdiff_t>(kSize * i / kThreads));
+  }
+  pool->ParallelFor(kThreads, [&bounds, &compare](const size_t i) {
+    std::sort(bounds[i], bounds[i + 1], compare);
+  });
+
+  // Merge neighbouring chunks until one remains.
+  while (bounds.size() > 2) {
+    const size_t kPairs = (bounds.size() - 1) / 2;
+    pool->ParallelFor(kPairs, [&bounds, &compare](const size_t i) {
+      std::inplace_merge(bounds[2*i], bounds[2*i + 1], bounds[2*i + 2],
+                         compare);
+    });
+    std::vector<Iterator> merged;
+    for (size_t i = 0; i < kPairs; i++) {
+      merged.push_back(bounds[2*i]);
+    }
+    // An odd chunk out carries over to the next round.
+    if (bounds.size() % 2 == 0) {
+      merged.push_back(bounds[bounds.size() - 2]);
+    }
+    merged.push_back(bounds.back());
+    bounds = std::move(merged);
+  }
+}
+
+#endif // BINARY_MATCHER_PARALLEL_H
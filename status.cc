@@ -0,0 +1,61 @@
+#include "status.h"
+
+#include <string>
+#include <utility>
+
+namespace {
+
+// Converts a status code into a string.
+inline static const char *StatusCodeString(const Status::Code kCode)
+{
+  switch (kCode) {
+    case Status::Code::kOk: return "ok";
+    case Status::Code::kIoError: return "I/O error";
+    case Status::Code::kUnsupported: return "unsupported";
+    case Status::Code::kMalformed: return "malformed";
+    default: return "UNKNOWN";
+  }
+}
+
+} // namespace
+
+Status::Status()
+  : code_(Code::kOk),
+    message_() { }
+
+Status::Status(const Code code, std::string message)
+  : code_(code),
+    message_(std::move(message)) { }
+
+Status::Status(const Status&) = default;
+
+Status::Status(Status&&) = default;
+
+Status &Status::operator=(const Status&) = default;
+
+Status &Status::operator=(Status&&) = default;
+
+Status::~Status() { }
+
+bool Status::ok() const
+{
+  return code_ == Code::kOk;
+}
+
+Status::Code Status::code() const
+{
+  return code_;
+}
+
+const std::string &Status::message() const
+{
+  return message_;
+}
+
+std::string Status::ToString() const
+{
+  if (ok()) {
+    return StatusCodeString(code_);
+  }
+  return std::string(StatusCodeString(code_)) + ": " + message_;
+}
@@ -0,0 +1,119 @@
+#ifndef BINARY_MATCHER_STATUS_H
+#define BINARY_MATCHER_STATUS_H
+
+#include <memory>
+#include <string>
+#include <utility>
+
+// Type representing the outcome of an operation that can fail:
+// either success, or an error code with a message describing it.
+// Errors are returned to the caller rather than reported and acted
+// on where they occur, so that one bad input never ends the process.
+class Status {
+public:
+  // An enumeration of the kinds of failure.
+  enum class Code {
+    // The operation succeeded.
+    kOk,
+    // The operating system failed to open, stat or map a file.
+    kIoError,
+    // The file is not in a format that is handled.
+    kUnsupported,
+    // The file is in a handled format, but is corrupt or truncated.
+    kMalformed,
+  };
+
+  // Constructs a successful status.
+  Status();
+
+  // Constructs a failed status with the given code and message.
+  Status(const Code code, std::string message);
+
+  Status(const Status&);
+  Status(Status&&);
+  Status &operator=(const Status&);
+  Status &operator=(Status&&);
+  ~Status();
+
+  // Returns true if the status represents success.
+  bool ok() const;
+
+  // Returns the status's code.
+  Code code() const;
+
+  // Returns the message describing the failure, or "" on success.
+  const std::string &message() const;
+
+  // Constructs a string representation of the status, e.g.
+  // "malformed: section headers extend beyond the end of the file".
+  std::string ToString() const;
+
+private:
+  // The status's code.
+  Code code_;
+  // The message describing the failure.
+  std::string message_;
+};
+
+// Type holding either a value of type T, which it owns, or the
+// Status describing why the value could not be produced.
+template <typename T>
+class Result {
+public:
+  // Constructs a successful result holding value.
+  Result(std::unique_ptr<T> value)
+    : value_(std::move(value)),
+      status_() { }
+
+  // Constructs a failed result. status must not be ok.
+  Result(Status status)
+    : value_(),
+      status_(std::move(status)) { }
+
+  // Converts a result holding a type derived from T.
+  template <typename U>
+  Result(Result<U> &&other)
+    : value_(other.release()),
+      status_(other.status()) { }
+
+  // Results are moved rather than copied.
+  Result(const Result&) = delete;
+  Result &operator=(const Result&) = delete;
+  Result(Result&&);
+  Result &operator=(Result&&);
+
+  ~Result();
+
+  // Returns true if the result holds a value.
+  bool ok() const { return status_.ok(); }
+
+  // Returns the status of the result.
+  const Status &status() const { return status_; }
+
+  // Returns the value held, or nullptr if there is none.
+  T *get() const { return value_.get(); }
+
+  // Releases ownership of the value held to the caller.
+  std::unique_ptr<T> release() { return std::move(value_); }
+
+private:
+  // The value, if there is one.
+  std::unique_ptr<T> value_;
+  // Why there is no value, if there is none.
+  Status status_;
+};
+
+// The members below are defined out of line, and so are not inline,
+// because a result is often destroyed on a cold path where inlining
+// its destructor would not pay.
+
+template <typename T>
+Result<T>::Result(Result&&) = default;
+
+template <typename T>
+Result<T> &Result<T>::operator=(Result&&) = default;
+
+template <typename T>
+Result<T>::~Result() { }
+
+#endif // BINARY_MATCHER_STATUS_H
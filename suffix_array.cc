@@ -0,0 +1,209 @@
+#include "suffix_array.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace {
+
+// The text of the top level of recursion: the input bytes, each
+// shifted up by one, followed by a sentinel of 0 that sorts before
+// every other character.
+class ByteText {
+public:
+  ByteText(const uint8_t *const data, const size_t size)
+    : data_(data), size_(size) { }
+
+  int32_t operator[](const size_t i) const
+  {
+    return i < size_ ? data_[i] + 1 : 0;
+  }
+
+private:
+  const uint8_t *data_;
+  size_t size_;
+};
+
+// The text of deeper levels of recursion: the names of the LMS
+// substrings of the level above, ending in the sentinel's, 0.
+class NameText {
+public:
+  explicit NameText(const int32_t *const names) : names_(names) { }
+
+  int32_t operator[](const size_t i) const
+  {
+    return names_[i];
+  }
+
+private:
+  const int32_t *names_;
+};
+
+// Fills buckets with the start, or if end the end, of the bucket of
+// each character of the n characters of text, which are at most
+// max_char.
+template <typename Text>
+static void FindBuckets(const Text &text, const size_t n,
+                        std::vector<int32_t> *const buckets,
+                        const int32_t max_char, const bool end)
+{
+  buckets->assign(static_cast<size_t>(max_char) + 1, 0);
+  for (size_t i = 0; i < n; i++) {
+    (*buckets)[static_cast<size_t>(text[i])]++;
+  }
+  int32_t sum = 0;
+  for (int32_t &bucket : *buckets) {
+    sum += bucket;
+    bucket = end ? sum : sum - bucket;
+  }
+}
+
+// Returns true if position i is the leftmost of a run of S-type
+// suffixes (an LMS position), given the type of every suffix.
+inline static bool IsLms(const std::vector<bool> &s_type, const int32_t i)
+{
+  const size_t kI = static_cast<size_t>(i);
+  return i > 0 && s_type[kI] && !s_type[kI - 1];
+}
+
+// Sorts the L-type suffixes of text into sa from the sorted LMS
+// suffixes already in it, then the S-type suffixes from those.
+template <typename Text>
+static void InduceSort(const Text &text, const std::vector<bool> &s_type,
+                       int32_t *const sa, const size_t n,
+                       std::vector<int32_t> *const buckets,
+                       const int32_t max_char)
+{
+  FindBuckets(text, n, buckets, max_char, false);
+  for (size_t i = 0; i < n; i++) {
+    const int32_t j = sa[i] - 1;
+    if (j >= 0 && !s_type[static_cast<size_t>(j)]) {
+      sa[(*buckets)[static_cast<size_t>(text[static_cast<size_t>(j)])]++]
+          = j;
+    }
+  }
+  FindBuckets(text, n, buckets, max_char, true);
+  for (size_t i = n; i-- > 0;) {
+    const int32_t j = sa[i] - 1;
+    if (j >= 0 && s_type[static_cast<size_t>(j)]) {
+      sa[--(*buckets)[static_cast<size_t>(text[static_cast<size_t>(j)])]]
+          = j;
+    }
+  }
+}
+
+// Builds into sa the suffix array of the n characters of text, which
+// are at most max_char and end with a unique, smallest sentinel.
+// The names of the reduced problem, and its suffix array, share sa.
+template <typename Text>
+static void SaIs(const Text &text, int32_t *const sa, const size_t n,
+                 const int32_t max_char)
+{
+  if (n == 1) {
+    sa[0] = 0;
+    return;
+  }
+
+  // Classify each suffix as S-type (smaller than the next) or L-type.
+  std::vector<bool> s_type(n);
+  s_type[n - 1] = true;
+  for (size_t i = n - 1; i-- > 0;) {
+    s_type[i] = text[i] < text[i + 1]
+                || (text[i] == text[i + 1] && s_type[i + 1]);
+  }
+
+  // Sort the LMS substrings by inducing from their unsorted positions.
+  std::vector<int32_t> buckets;
+  FindBuckets(text, n, &buckets, max_char, true);
+  for (size_t i = 0; i < n; i++) {
+    sa[i] = -1;
+  }
+  for (size_t i = 1; i < n; i++) {
+    if (IsLms(s_type, static_cast<int32_t>(i))) {
+      sa[--buckets[static_cast<size_t>(text[i])]] = static_cast<int32_t>(i);
+    }
+  }
+  InduceSort(text, s_type, sa, n, &buckets, max_char);
+
+  // Gather the sorted LMS substrings, then name each, giving equal
+  // substrings equal names, in the upper half of sa by position.
+  size_t lms_count = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (IsLms(s_type, sa[i])) {
+      sa[lms_count++] = sa[i];
+    }
+  }
+  for (size_t i = lms_count; i < n; i++) {
+    sa[i] = -1;
+  }
+  int32_t names = 0;
+  int32_t previous = -1;
+  for (size_t i = 0; i < lms_count; i++) {
+    const int32_t kPosition = sa[i];
+    bool differs = previous < 0;
+    for (size_t d = 0; !differs; d++) {
+      const size_t kA = static_cast<size_t>(kPosition) + d;
+      const size_t kB = static_cast<size_t>(previous) + d;
+      if (text[kA] != text[kB] || s_type[kA] != s_type[kB]) {
+        differs = true;
+      } else if (d > 0 && (IsLms(s_type, static_cast<int32_t>(kA))
+                           || IsLms(s_type, static_cast<int32_t>(kB)))) {
+        break;
+      }
+    }
+    if (differs) {
+      names++;
+      previous = kPosition;
+    }
+    sa[lms_count + static_cast<size_t>(kPosition) / 2] = names - 1;
+  }
+  for (size_t i = n, j = n; i-- > lms_count;) {
+    if (sa[i] >= 0) {
+      sa[--j] = sa[i];
+    }
+  }
+
+  // Sort the LMS suffixes: directly if every name is unique, and
+  // otherwise by recursing on the string of names.
+  int32_t *const reduced = sa + n - lms_count;
+  if (static_cast<size_t>(names) < lms_count) {
+    SaIs(NameText(reduced), sa, lms_count, names - 1);
+  } else {
+    for (size_t i = 0; i < lms_count; i++) {
+      sa[reduced[i]] = static_cast<int32_t>(i);
+    }
+  }
+
+  // Place the sorted LMS suffixes at the ends of their buckets, and
+  // induce the order of every other suffix from them.
+  for (size_t i = 1, j = 0; i < n; i++) {
+    if (IsLms(s_type, static_cast<int32_t>(i))) {
+      reduced[j++] = static_cast<int32_t>(i);
+    }
+  }
+  for (size_t i = 0; i < lms_count; i++) {
+    sa[i] = reduced[sa[i]];
+  }
+  for (size_t i = lms_count; i < n; i++) {
+    sa[i] = -1;
+  }
+  FindBuckets(text, n, &buckets, max_char, true);
+  for (size_t i = lms_count; i-- > 0;) {
+    const int32_t j = sa[i];
+    sa[i] = -1;
+    sa[--buckets[static_cast<size_t>(text[static_cast<size_t>(j)])]] = j;
+  }
+  InduceSort(text, s_type, sa, n, &buckets, max_char);
+}
+
+} // namespace
+
+std::vector<int32_t> BuildSuffixArray(const uint8_t *const data,
+                                      const size_t size)
+{
+  // The sentinel's suffix sorts first; it is dropped from the result.
+  std::vector<int32_t> sa(size + 1);
+  SaIs(ByteText(data, size), sa.data(), size + 1, UINT8_MAX + 1);
+  sa.erase(sa.begin());
+  return sa;
+}
@@ -0,0 +1,25 @@
+#ifndef BINARY_MATCHER_SUFFIX_ARRAY_H
+#define BINARY_MATCHER_SUFFIX_ARRAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// The most bytes that a suffix array can be built over: positions
+// must fit in an int32_t alongside the terminating sentinel.
+const size_t kMaxSuffixArrayInput = INT32_MAX - 1;
+
+// The number of bytes of memory, per byte of input, that building a
+// suffix array takes at most: the array itself, plus the type of each
+// suffix at each level of recursion.
+const size_t kSuffixArrayBytesPerByte = 5;
+
+// Builds the suffix array of the size bytes at data, which must be
+// at most kMaxSuffixArrayInput, by induced sorting (SA-IS) in time
+// linear in size. Returns the positions of the suffixes of data in
+// lexicographic order, where a suffix sorts before any longer suffix
+// that it is a prefix of. The bytes are read in place.
+std::vector<int32_t> BuildSuffixArray(const uint8_t *const data,
+                                      const size_t size);
+
+#endif // BINARY_MATCHER_SUFFIX_ARRAY_H
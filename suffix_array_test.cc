@@ -0,0 +1,81 @@
+#include "suffix_array.h"
+#include "test.h"
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace {
+
+// Builds the suffix array of data by sorting its suffixes directly.
+static std::vector<int32_t> NaiveSuffixArray(const std::vector<uint8_t> &data)
+{
+  std::vector<int32_t> suffixes(data.size());
+  for (size_t i = 0; i < suffixes.size(); i++) {
+    suffixes[i] = static_cast<int32_t>(i);
+  }
+  std::sort(suffixes.begin(), suffixes.end(),
+            [&data](const int32_t a, const int32_t b) {
+    return std::lexicographical_compare(data.begin() + a, data.end(),
+                                        data.begin() + b, data.end());
+  });
+  return suffixes;
+}
+
+// Checks that the suffix array built of data is the one sorting finds.
+static void ExpectSuffixArray(const std::vector<uint8_t> &data)
+{
+  EXPECT(BuildSuffixArray(data.data(), data.size())
+         == NaiveSuffixArray(data));
+}
+
+static void TestEdgeCases()
+{
+  ExpectSuffixArray(std::vector<uint8_t>());
+  ExpectSuffixArray(std::vector<uint8_t>{42});
+  ExpectSuffixArray(std::vector<uint8_t>{0, 0});
+  ExpectSuffixArray(std::vector<uint8_t>{255, 0, 255});
+  ExpectSuffixArray(std::vector<uint8_t>(1000, 7));
+  const char kBanana[] = "banana";
+  ExpectSuffixArray(std::vector<uint8_t>(kBanana, kBanana + 6));
+}
+
+// Checks inputs of many sizes over small alphabets, whose repeats
+// drive the recursion of induced sorting deepest, and over all bytes.
+static void TestRandom()
+{
+  uint64_t state = 0x9e3779b97f4a7c15ULL;
+  for (const unsigned kAlphabet : {2U, 3U, 4U, 256U}) {
+    for (size_t size = 1; size <= 300; size += 7) {
+      ExpectSuffixArray(RandomValues<uint8_t>(size, kAlphabet, &state));
+    }
+    ExpectSuffixArray(RandomValues<uint8_t>(20000, kAlphabet, &state));
+  }
+}
+
+// Checks periodic inputs, whose suffixes share long prefixes.
+static void TestPeriodic()
+{
+  uint64_t state = 1;
+  for (const size_t kPeriod : {1U, 2U, 5U, 64U}) {
+    const std::vector<uint8_t> kUnit
+        = RandomValues<uint8_t>(kPeriod, 256, &state);
+    std::vector<uint8_t> data;
+    while (data.size() < 5000) {
+      data.insert(data.end(), kUnit.begin(), kUnit.end());
+    }
+    data.push_back(static_cast<uint8_t>(NextRandom(&state)));
+    ExpectSuffixArray(data);
+  }
+}
+
+} // namespace
+
+int main()
+{
+  RUN_TEST(TestEdgeCases);
+  RUN_TEST(TestRandom);
+  RUN_TEST(TestPeriodic);
+  return TestStatus();
+}
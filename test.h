@@ -0,0 +1,63 @@
+#ifndef BINARY_MATCHER_TEST_H
+#define BINARY_MATCHER_TEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+// A minimal harness for the *_test.cc programs that build.sh builds.
+// Each test is a function that makes checks with EXPECT; a program's
+// main runs its tests with RUN_TEST and returns TestStatus().
+
+// The number of checks that have failed so far.
+static int test_failures = 0;
+
+// Checks that condition holds, reporting where it does not.
+#define EXPECT(condition) \
+  do { \
+    if (!(condition)) { \
+      fprintf(stderr, "%s:%d: expected %s\n", __FILE__, __LINE__, \
+              #condition); \
+      test_failures++; \
+    } \
+  } while (0)
+
+// Checks that a and b compare equal.
+#define EXPECT_EQ(a, b) EXPECT((a) == (b))
+
+// Returns the next of a deterministic sequence of pseudo-random
+// numbers (xorshift64), so that failures reproduce.
+inline uint64_t NextRandom(uint64_t *const state)
+{
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+// Returns size pseudo-random values, each among the first alphabet.
+template <typename Value>
+std::vector<Value> RandomValues(const size_t size, const uint64_t alphabet,
+                                uint64_t *const state)
+{
+  std::vector<Value> values(size);
+  for (Value &value : values) {
+    value = static_cast<Value>(NextRandom(state) % alphabet);
+  }
+  return values;
+}
+
+// Runs the test function test, reporting whether its checks passed.
+#define RUN_TEST(test) \
+  do { \
+    const int kFailuresBefore = test_failures; \
+    test(); \
+    fprintf(stderr, "%s %s\n", \
+            test_failures == kFailuresBefore ? "PASS" : "FAIL", #test); \
+  } while (0)
+
+// The exit status of a test program: 0 if every check passed.
+#define TestStatus() (test_failures ? 1 : 0)
+
+#endif // BINARY_MATCHER_TEST_H
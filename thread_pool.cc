@@ -0,0 +1,149 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <thread>
+#include <utility>
+
+namespace {
+
+// State shared between the threads taking part in one ParallelFor.
+// Helpers may be dequeued after the loop has finished, so the state
+// is reference counted rather than living on the caller's stack.
+struct Loop {
+  Loop(const size_t count, const std::function<void(size_t)> *const body)
+    : kCount(count),
+      kBody(body),
+      next(0),
+      done(0),
+      mutex(),
+      finished() { }
+
+  Loop(const Loop&) = delete;
+  Loop &operator=(const Loop&) = delete;
+
+  // The number of iterations.
+  const size_t kCount;
+  // The body of the loop. Only called while iterations remain, so
+  // never after the caller has returned.
+  const std::function<void(size_t)> *const kBody;
+  // The next iteration to be claimed.
+  std::atomic<size_t> next;
+  // The number of iterations completed.
+  std::atomic<size_t> done;
+  // Guards the wait for the last iteration.
+  std::mutex mutex;
+  // Signalled when the last iteration completes.
+  std::condition_variable finished;
+};
+
+// Claims and runs iterations of loop until none remain.
+inline static void RunLoop(Loop *const loop)
+{
+  for (;;) {
+    const size_t kIteration = loop->next++;
+    if (kIteration >= loop->kCount) {
+      return;
+    }
+    (*loop->kBody)(kIteration);
+    if (++loop->done == loop->kCount) {
+      std::lock_guard<std::mutex> lock(loop->mutex);
+      loop->finished.notify_all();
+    }
+  }
+}
+
+} // namespace
+
+ThreadPool::ThreadPool(const size_t threads)
+  : mutex_(),
+    ready_(),
+    tasks_(),
+    stopping_(false),
+    workers_()
+{
+  for (size_t i = 0; i < threads; i++) {
+    workers_.emplace_back([this] { Work(); });
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  ready_.notify_all();
+  for (std::thread &worker : workers_) {
+    worker.join();
+  }
+}
+
+ThreadPool *ThreadPool::Default()
+{
+  static ThreadPool pool(
+      std::max(1U, std::thread::hardware_concurrency()) - 1);
+  return &pool;
+}
+
+size_t ThreadPool::concurrency() const
+{
+  return workers_.size() + 1;
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+  if (workers_.empty()) {
+    task();
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  ready_.notify_one();
+}
+
+void ThreadPool::ParallelFor(const size_t count,
+                             const std::function<void(size_t)> &body)
+{
+  if (count <= 1 || workers_.empty()) {
+    for (size_t i = 0; i < count; i++) {
+      body(i);
+    }
+    return;
+  }
+
+  std::shared_ptr<Loop> loop = std::make_shared<Loop>(count, &body);
+  const size_t kHelpers = std::min(count - 1, workers_.size());
+  for (size_t i = 0; i < kHelpers; i++) {
+    Submit([loop] { RunLoop(loop.get()); });
+  }
+  RunLoop(loop.get());
+
+  // Wait for iterations that helpers claimed to complete.
+  std::unique_lock<std::mutex> lock(loop->mutex);
+  loop->finished.wait(lock, [&loop] { return loop->done == loop->kCount; });
+}
+
+void ThreadPool::Work()
+{
+  for (;;) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ready_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
@@ -0,0 +1,63 @@
+#ifndef BINARY_MATCHER_THREAD_POOL_H
+#define BINARY_MATCHER_THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stddef.h>
+#include <thread>
+#include <vector>
+
+// Class that owns a fixed set of worker threads, which run tasks
+// submitted to the pool in the order they were submitted.
+// Threads blocked waiting on a ParallelFor execute its work
+// themselves, so ParallelFor may safely be called from a task
+// running on the pool.
+class ThreadPool {
+public:
+  // Constructs a pool of the given number of worker threads.
+  // A pool of zero threads runs all work on the calling thread.
+  explicit ThreadPool(const size_t threads);
+
+  // Delete copy constructor and assignment.
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool &operator=(const ThreadPool&) = delete;
+
+  // Waits for queued tasks to finish, then joins the workers.
+  ~ThreadPool();
+
+  // Returns the process-wide pool, which has one worker per hardware
+  // thread, less one for the thread that calls into it.
+  static ThreadPool *Default();
+
+  // Returns the number of threads that can run work concurrently,
+  // counting the calling thread.
+  size_t concurrency() const;
+
+  // Queues task to run on a worker thread.
+  void Submit(std::function<void()> task);
+
+  // Calls body(i) for each i in [0, count), spread over the pool
+  // and the calling thread, and returns once every call has.
+  // Calls are made in no particular order.
+  void ParallelFor(const size_t count,
+                   const std::function<void(size_t)> &body);
+
+private:
+  // The loop that each worker thread runs.
+  void Work();
+
+  // Guards tasks_ and stopping_.
+  std::mutex mutex_;
+  // Signalled when a task is queued or the pool is stopping.
+  std::condition_variable ready_;
+  // Tasks that no worker has yet started.
+  std::deque<std::function<void()>> tasks_;
+  // Set when the pool is being destroyed.
+  bool stopping_;
+  // The worker threads.
+  std::vector<std::thread> workers_;
+};
+
+#endif // BINARY_MATCHER_THREAD_POOL_H